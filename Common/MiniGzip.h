@@ -0,0 +1,203 @@
+// MiniGzip.h
+// Small, dependency-free gzip (RFC 1952) writer used by the manifest tools to publish
+// pre-compressed "*.json.gz" variants next to the plain JSON files.
+//
+// Notes:
+// - Header-only and C++11 so it can be included by every tool project (ManifestOld does not
+//   build as C++17).
+// - Encoder is greedy LZ77 (32 KB window, hash chains) with the fixed Huffman tables from
+//   RFC 1951. Manifests are repetitive ASCII JSON, so this gets most of what zlib would,
+//   without pulling in a third-party library.
+// - Output is deterministic: MTIME is written as 0 and no file name is stored, so the same
+//   input always produces byte-identical .gz files.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace minigzip
+{
+    inline uint32_t Crc32(const unsigned char* data, size_t size)
+    {
+        static uint32_t table[256];
+        static bool tableReady = false;
+        if (!tableReady)
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                table[i] = c;
+            }
+            tableReady = true;
+        }
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    namespace detail
+    {
+        struct BitWriter
+        {
+            std::string& out;
+            uint32_t bitBuf = 0;
+            int bitCount = 0;
+
+            explicit BitWriter(std::string& o) : out(o) {}
+
+            // Values are packed LSB-first, as deflate requires.
+            void Put(uint32_t value, int count)
+            {
+                bitBuf |= value << bitCount;
+                bitCount += count;
+                while (bitCount >= 8)
+                {
+                    out.push_back((char)(bitBuf & 0xFF));
+                    bitBuf >>= 8;
+                    bitCount -= 8;
+                }
+            }
+            // Huffman codes are defined MSB-first, so they are bit-reversed before packing.
+            void PutCode(uint32_t code, int length)
+            {
+                uint32_t rev = 0;
+                for (int i = 0; i < length; ++i)
+                {
+                    rev = (rev << 1) | (code & 1);
+                    code >>= 1;
+                }
+                Put(rev, length);
+            }
+            void Flush()
+            {
+                if (bitCount > 0)
+                    out.push_back((char)(bitBuf & 0xFF));
+                bitBuf = 0;
+                bitCount = 0;
+            }
+        };
+
+        inline void PutFixedLiteral(BitWriter& bw, int sym)
+        {
+            if (sym < 144)      bw.PutCode(0x30 + sym, 8);
+            else if (sym < 256) bw.PutCode(0x190 + (sym - 144), 9);
+            else if (sym < 280) bw.PutCode(sym - 256, 7);
+            else                bw.PutCode(0xC0 + (sym - 280), 8);
+        }
+
+        inline void PutMatch(BitWriter& bw, int length, int distance)
+        {
+            static const int kLenBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+            static const int kLenExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+            static const int kDistBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+            static const int kDistExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+            int li = 28;
+            while (li > 0 && kLenBase[li] > length) --li;
+            PutFixedLiteral(bw, 257 + li);
+            if (kLenExtra[li]) bw.Put((uint32_t)(length - kLenBase[li]), kLenExtra[li]);
+
+            int di = 29;
+            while (di > 0 && kDistBase[di] > distance) --di;
+            bw.PutCode((uint32_t)di, 5);
+            if (kDistExtra[di]) bw.Put((uint32_t)(distance - kDistBase[di]), kDistExtra[di]);
+        }
+    }
+
+    // Raw deflate stream (single fixed-Huffman block).
+    inline std::string DeflateFixed(const std::string& input)
+    {
+        const int kWindow = 32768;
+        const int kMinMatch = 3;
+        const int kMaxMatch = 258;
+        const int kMaxChain = 128;
+        const int kHashBits = 15;
+
+        const unsigned char* in = (const unsigned char*)input.data();
+        const int n = (int)input.size();
+
+        std::string out;
+        out.reserve(input.size() / 3 + 64);
+        detail::BitWriter bw(out);
+        bw.Put(1, 1);   // BFINAL
+        bw.Put(1, 2);   // BTYPE = 01 (fixed Huffman)
+
+        std::vector<int> head((size_t)1 << kHashBits, -1);
+        std::vector<int> prev((size_t)(n > 0 ? n : 1), -1);
+        auto hashAt = [&](int p) -> uint32_t {
+            return ((uint32_t)in[p] * 2654435761u ^ ((uint32_t)in[p + 1] << 8) ^ ((uint32_t)in[p + 2] << 16)) >> (32 - kHashBits);
+        };
+        auto insert = [&](int p) {
+            if (p + kMinMatch > n) return;
+            const uint32_t h = hashAt(p);
+            prev[p] = head[h];
+            head[h] = p;
+        };
+
+        int pos = 0;
+        while (pos < n)
+        {
+            int bestLen = 0;
+            int bestDist = 0;
+            if (pos + kMinMatch <= n)
+            {
+                const int maxLen = (n - pos) < kMaxMatch ? (n - pos) : kMaxMatch;
+                int cand = head[hashAt(pos)];
+                int chain = kMaxChain;
+                while (cand >= 0 && pos - cand <= kWindow && chain-- > 0)
+                {
+                    if (in[cand + bestLen] == in[pos + bestLen])
+                    {
+                        int len = 0;
+                        while (len < maxLen && in[cand + len] == in[pos + len]) ++len;
+                        if (len > bestLen)
+                        {
+                            bestLen = len;
+                            bestDist = pos - cand;
+                            if (len == maxLen) break;
+                        }
+                    }
+                    cand = prev[cand];
+                }
+            }
+
+            if (bestLen >= kMinMatch)
+            {
+                detail::PutMatch(bw, bestLen, bestDist);
+                for (int k = 0; k < bestLen; ++k)
+                    insert(pos + k);
+                pos += bestLen;
+            }
+            else
+            {
+                detail::PutFixedLiteral(bw, in[pos]);
+                insert(pos);
+                ++pos;
+            }
+        }
+        detail::PutFixedLiteral(bw, 256);   // end of block
+        bw.Flush();
+        return out;
+    }
+
+    // Complete .gz member: header (no name, MTIME 0), deflate data, CRC-32 and ISIZE trailer.
+    inline std::string GzipCompress(const std::string& input)
+    {
+        std::string out;
+        const unsigned char header[10] = { 0x1F, 0x8B, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0x0B /* NTFS */ };
+        out.append((const char*)header, sizeof(header));
+        out += DeflateFixed(input);
+
+        const uint32_t crc = Crc32((const unsigned char*)input.data(), input.size());
+        const uint32_t isize = (uint32_t)(input.size() & 0xFFFFFFFFu);
+        for (int i = 0; i < 4; ++i) out.push_back((char)((crc >> (8 * i)) & 0xFF));
+        for (int i = 0; i < 4; ++i) out.push_back((char)((isize >> (8 * i)) & 0xFF));
+        return out;
+    }
+}
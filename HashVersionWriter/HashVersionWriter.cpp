@@ -7,13 +7,13 @@
 // - No C++17 required
 
 #include <windows.h>
-#include <bcrypt.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 
-#pragma comment(lib, "bcrypt.lib")
+#include "../Sha256Lib/Sha256.h"
+
 #pragma comment(lib, "version.lib")
 
 static std::string Trim(const std::string& s)
@@ -66,83 +66,6 @@ static bool GetExeFileVersion(const std::wstring& exePath, std::string& outVersi
     return true;
 }
 
-static bool ComputeSHA256(const std::wstring& filePath, std::string& outHash)
-{
-    BCRYPT_ALG_HANDLE hAlg = nullptr;
-    BCRYPT_HASH_HANDLE hHash = nullptr;
-    DWORD hashObjectSize = 0, dataSize = 0;
-    DWORD hashLen = 0;
-
-    if (BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0) != 0)
-        return false;
-
-    if (BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH,
-        (PUCHAR)&hashObjectSize, sizeof(DWORD), &dataSize, 0) != 0)
-    {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return false;
-    }
-
-    if (BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH,
-        (PUCHAR)&hashLen, sizeof(DWORD), &dataSize, 0) != 0)
-    {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return false;
-    }
-
-    std::vector<BYTE> hashObject(hashObjectSize);
-    std::vector<BYTE> hash(hashLen);
-
-    if (BCryptCreateHash(hAlg, &hHash, hashObject.data(),
-        hashObjectSize, nullptr, 0, 0) != 0)
-    {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return false;
-    }
-
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file)
-        return false;
-
-    std::vector<char> buffer(64 * 1024);
-    while (file.good())
-    {
-        file.read(buffer.data(), buffer.size());
-        std::streamsize read = file.gcount();
-        if (read > 0)
-        {
-            if (BCryptHashData(hHash,
-                (PUCHAR)buffer.data(),
-                (ULONG)read, 0) != 0)
-            {
-                BCryptDestroyHash(hHash);
-                BCryptCloseAlgorithmProvider(hAlg, 0);
-                return false;
-            }
-        }
-    }
-
-    if (BCryptFinishHash(hHash, hash.data(), hashLen, 0) != 0)
-    {
-        BCryptDestroyHash(hHash);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return false;
-    }
-
-    BCryptDestroyHash(hHash);
-    BCryptCloseAlgorithmProvider(hAlg, 0);
-
-    static const char hex[] = "0123456789abcdef";
-    outHash.clear();
-    for (BYTE b : hash)
-    {
-        outHash.push_back(hex[b >> 4]);
-        outHash.push_back(hex[b & 0xF]);
-    }
-
-    return true;
-}
-
 int main()
 {
     const std::wstring exePath = L"MapPackSyncTool.exe";
@@ -162,7 +85,7 @@ int main()
     }
 
     std::string sha;
-    if (!ComputeSHA256(exePath, sha))
+    if (!sha256lib::HashFileHex(exePath, sha))
     {
         std::cerr << "ERROR: Failed to compute SHA-256.\n";
         return 1;
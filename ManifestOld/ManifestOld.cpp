@@ -1,8 +1,10 @@
 // ManifestOld.cpp
 // Generates a JSON manifest for files under "resources_override" next to this EXE.
-// This variant does NOT compute SHA-256 (all BCrypt / hashing removed).
+// This variant does NOT compute per-file SHA-256; only the manifest itself is hashed, for the
+// head file.
 //
-// Output file: mappack_manifest_old.json
+// Output files: mappack_manifest_old.json, mappack_manifest_old.json.gz and
+// mappack_manifest_old.sha256
 //
 // Notes:
 // - This file intentionally avoids std::filesystem so it builds even if the project
@@ -19,6 +21,9 @@
 #include <string>
 #include <vector>
 
+#include "../Common/MiniGzip.h"
+#include "../Sha256Lib/Sha256.h"
+
 // ----------------------------
 // Small helpers
 // ----------------------------
@@ -172,6 +177,16 @@ static void EnumerateFilesRecursive(
     FindClose(hFind);
 }
 
+static bool WriteFileBytesW(const std::wstring& pathW, const std::string& bytes)
+{
+    std::ofstream out(WideToUtf8(pathW), std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out.write(bytes.data(), (std::streamsize)bytes.size());
+    out.close();
+    return !out.fail();
+}
+
 // ----------------------------
 // Main
 // ----------------------------
@@ -202,31 +217,52 @@ int wmain()
         return _wcsicmp(a.relPath.c_str(), b.relPath.c_str()) < 0;
         });
 
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"files\": [\n";
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const std::string rel = NormalizeRelPath(files[i].relPath);
+
+        json << "    { \"path\": \"" << JsonEscape(rel) << "\" }";
+        if (i + 1 < files.size())
+            json << ",";
+        json << "\n";
+    }
+
+    json << "  ]\n";
+    json << "}\n";
+
+    const std::string outStr = json.str();
+
     const std::wstring outPathW = JoinPathW(exeDir, L"mappack_manifest_old.json");
-    std::ofstream out(WideToUtf8(outPathW), std::ios::binary);
-    if (!out)
+    if (!WriteFileBytesW(outPathW, outStr))
     {
         MessageBoxW(nullptr, L"Failed to open output file for writing:\n\nmappack_manifest_old.json",
             L"Manifest generator", MB_ICONERROR | MB_OK);
         return 2;
     }
 
-    out << "{\n";
-    out << "  \"files\": [\n";
-
-    for (size_t i = 0; i < files.size(); ++i)
+    // Pre-compressed twin, used by the sync client only when it inflates to the sha256 in
+    // mappack_manifest_old.sha256 (written below); otherwise it downloads the .json.
+    if (!WriteFileBytesW(outPathW + L".gz", minigzip::GzipCompress(outStr)))
     {
-        const std::string rel = NormalizeRelPath(files[i].relPath);
-
-        out << "    { \"path\": \"" << JsonEscape(rel) << "\" }";
-        if (i + 1 < files.size())
-            out << ",";
-        out << "\n";
+        MessageBoxW(nullptr, L"Failed to open output file for writing:\n\nmappack_manifest_old.json.gz",
+            L"Manifest generator", MB_ICONERROR | MB_OK);
+        return 2;
     }
 
-    out << "  ]\n";
-    out << "}\n";
-
-    out.close();
+    // Head file: the SHA-256 of the manifest just written. A client whose MapPack 4.0 clean-up
+    // finished against this manifest skips the download and the clean-up while it matches.
+    // Always upload it with the manifest.
+    std::string sha;
+    if (!sha256lib::HashBytesHex(outStr.data(), outStr.size(), sha)
+        || !WriteFileBytesW(JoinPathW(exeDir, L"mappack_manifest_old.sha256"), sha + "\n"))
+    {
+        MessageBoxW(nullptr, L"Failed to write output file:\n\nmappack_manifest_old.sha256",
+            L"Manifest generator", MB_ICONERROR | MB_OK);
+        return 2;
+    }
     return 0;
 }
\ No newline at end of file
@@ -1,15 +1,20 @@
 #define NOMINMAX
 #include <windows.h>
-#include <bcrypt.h>
-#pragma comment(lib, "bcrypt.lib")
 
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <thread>
+
+#include "../Common/MiniGzip.h"
+#include "../Sha256Lib/Sha256.h"
 
 namespace fs = std::filesystem;
 
@@ -43,70 +48,275 @@ static std::string json_escape(const std::string& s) {
     return out;
 }
 
-static std::string bytes_to_hex_lower(const std::vector<unsigned char>& bytes) {
-    static const char* kHex = "0123456789abcdef";
-    std::string s(bytes.size() * 2, '\0');
-    for (size_t i = 0; i < bytes.size(); ++i) {
-        s[i * 2 + 0] = kHex[(bytes[i] >> 4) & 0xF];
-        s[i * 2 + 1] = kHex[(bytes[i] >> 0) & 0xF];
+struct Entry { std::string path; std::string hash; long long size = -1; };   // size -1: not recorded (older manifests)
+
+static std::string json_unescape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 >= s.size()) { out += s[i]; continue; }
+        switch (s[++i]) {
+        case 'r': out += '\r'; break;
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        default:  out += s[i]; break;   // \\ and \"
+        }
     }
-    return s;
+    return out;
 }
 
-static bool sha256_file_bcrypt(const fs::path& filePath, std::string& outHex) {
-    outHex.clear();
-
-    BCRYPT_ALG_HANDLE hAlg = nullptr;
-    BCRYPT_HASH_HANDLE hHash = nullptr;
-
-    NTSTATUS st = BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
-    if (st != 0) return false;
+// Reads back a manifest previously written by this tool (one "key": value per line).
+// Anything else (hand-edited files) is rejected so no delta is produced from it.
+static bool read_previous_manifest(const fs::path& file, std::vector<Entry>& out) {
+    out.clear();
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return false;
+    const std::string kPath = "\"path\": \"";
+    const std::string kHash = "\"sha256\": \"";
+    const std::string kSize = "\"size\": ";
+    std::string line, path;
+    while (std::getline(in, line)) {
+        size_t b = line.find_first_not_of(" \t");
+        if (b == std::string::npos) continue;
+        size_t e = line.find_last_of('"');
+        if (line.compare(b, kPath.size(), kPath) == 0 && e > b + kPath.size() - 1) {
+            path = json_unescape(line.substr(b + kPath.size(), e - b - kPath.size()));
+        }
+        else if (line.compare(b, kHash.size(), kHash) == 0 && e > b + kHash.size() - 1) {
+            if (path.empty()) return false;
+            out.push_back({ path, line.substr(b + kHash.size(), e - b - kHash.size()) });
+            path.clear();
+        }
+        else if (line.compare(b, kSize.size(), kSize) == 0) {
+            const char* v = line.c_str() + b + kSize.size();
+            char* end = nullptr;
+            const long long n = std::strtoll(v, &end, 10);
+            if (out.empty() || end == v || n < 0) return false;
+            out.back().size = n;
+        }
+    }
+    return !out.empty() && path.empty();
+}
 
-    DWORD objLen = 0, cbData = 0, hashLen = 0;
-    st = BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&objLen, sizeof(objLen), &cbData, 0);
-    if (st != 0) { BCryptCloseAlgorithmProvider(hAlg, 0); return false; }
+static void write_entry_array(std::ostringstream& json, const char* name, const std::vector<Entry>& list, bool last) {
+    json << "  \"" << name << "\": [\n";
+    for (size_t i = 0; i < list.size(); ++i) {
+        json << "    { \"path\": \"" << json_escape(list[i].path) << "\", \"sha256\": \"" << list[i].hash << "\"";
+        if (list[i].size >= 0) json << ", \"size\": " << list[i].size;
+        json << " }";
+        if (i + 1 < list.size()) json << ",";
+        json << "\n";
+    }
+    json << (last ? "  ]\n" : "  ],\n");
+}
 
-    st = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&hashLen, sizeof(hashLen), &cbData, 0);
-    if (st != 0) { BCryptCloseAlgorithmProvider(hAlg, 0); return false; }
+// Writes mappack_manifest_deltas/<fromSha>.json describing how to get from the previous
+// manifest to the new one. Older deltas are left in place so clients can walk the chain.
+static bool write_manifest_delta(const fs::path& deltaDir, const std::string& fromSha, const std::string& toSha,
+    const std::vector<Entry>& prev, const std::vector<Entry>& next, size_t& outChanges) {
+    std::map<std::string, Entry> before;
+    for (const auto& e : prev) before[e.path] = e;
+
+    std::vector<Entry> added, changed, removed;
+    for (const auto& e : next) {
+        auto it = before.find(e.path);
+        if (it == before.end()) added.push_back(e);
+        else {
+            if (it->second.hash != e.hash || it->second.size != e.size) changed.push_back(e);
+            before.erase(it);
+        }
+    }
+    for (const auto& kv : before) removed.push_back(kv.second);
+    outChanges = added.size() + changed.size() + removed.size();
 
-    std::vector<unsigned char> hashObj(objLen);
-    std::vector<unsigned char> hash(hashLen);
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"from\": \"" << fromSha << "\",\n";
+    json << "  \"to\": \"" << toSha << "\",\n";
+    write_entry_array(json, "added", added, false);
+    write_entry_array(json, "changed", changed, false);
+    write_entry_array(json, "removed", removed, true);
+    json << "}\n";
 
-    st = BCryptCreateHash(hAlg, &hHash, hashObj.data(), (ULONG)hashObj.size(), nullptr, 0, 0);
-    if (st != 0) { BCryptCloseAlgorithmProvider(hAlg, 0); return false; }
+    std::error_code ec;
+    fs::create_directories(deltaDir, ec);
+    const std::string outStr = json.str();
+    std::ofstream out(deltaDir / (fromSha + ".json"), std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(outStr.data(), (std::streamsize)outStr.size());
+    return (bool)out;
+}
 
-    std::ifstream in(filePath, std::ios::binary);
-    if (!in) {
-        BCryptDestroyHash(hHash);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        return false;
+// Incremental-mode sidecar (mappack_manifest.meta, next to the manifest; not uploaded).
+// Records the size and last-write time each manifest hash was computed from, so the next
+// --incremental run can reuse the hash of any file whose metadata did not move.
+// Format: header line, then "<size>\t<lastWriteTicks>\t<manifest path>" per file.
+static const char* kMetaHeader = "ManifestSha256Meta 1";
+
+struct FileStamp { long long size = -1; long long mtime = 0; };
+
+static bool read_meta_sidecar(const fs::path& file, std::map<std::string, FileStamp>& out) {
+    out.clear();
+    std::ifstream in(file, std::ios::binary);
+    std::string line;
+    if (!in || !std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line != kMetaHeader) return false;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const size_t t1 = line.find('\t');
+        const size_t t2 = (t1 == std::string::npos) ? std::string::npos : line.find('\t', t1 + 1);
+        if (t2 == std::string::npos) return false;
+        char* end = nullptr;
+        FileStamp s;
+        s.size = std::strtoll(line.c_str(), &end, 10);
+        if (end != line.c_str() + t1 || s.size < 0) return false;
+        s.mtime = std::strtoll(line.c_str() + t1 + 1, &end, 10);
+        if (end != line.c_str() + t2) return false;
+        out[line.substr(t2 + 1)] = s;
     }
+    return true;
+}
 
-    std::vector<unsigned char> buf(1024 * 1024);
-    while (in) {
-        in.read((char*)buf.data(), (std::streamsize)buf.size());
-        std::streamsize got = in.gcount();
-        if (got > 0) {
-            st = BCryptHashData(hHash, buf.data(), (ULONG)got, 0);
-            if (st != 0) {
-                BCryptDestroyHash(hHash);
-                BCryptCloseAlgorithmProvider(hAlg, 0);
-                return false;
-            }
-        }
+static bool write_meta_sidecar(const fs::path& file, const std::vector<Entry>& entries, const std::map<std::string, FileStamp>& stamps) {
+    std::ostringstream meta;
+    meta << kMetaHeader << "\n";
+    for (const auto& e : entries) {
+        auto it = stamps.find(e.path);
+        if (it == stamps.end()) continue;
+        meta << it->second.size << "\t" << it->second.mtime << "\t" << e.path << "\n";
     }
+    const std::string outStr = meta.str();
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(outStr.data(), (std::streamsize)outStr.size());
+    return (bool)out;
+}
 
-    st = BCryptFinishHash(hHash, hash.data(), (ULONG)hash.size(), 0);
+// Pack bundles (--pack): small files are also published concatenated into a few large
+// mappack_packs/<sha256 of pack>.pack files, so the sync client can fetch many of them with a
+// handful of range requests instead of one GET each. mappack_packs/index.json maps each blob
+// sha256 to its pack, offset and size. The manifest itself is unchanged, and clients without
+// pack support (or servers without range support) keep using per-file GETs.
+// - A pack is named by its content and never rewritten, so it can be cached as immutable.
+// - Cut points depend only on the blobs themselves: once a pack is past half the target size it
+//   ends after the first blob whose sha256 starts with 00-03 (forced at twice the target). One
+//   changed file therefore normally changes only the pack holding it.
+// - Upload the .pack files before index.json; the client verifies every blob it splits out.
+struct PackedFile { std::string hash; long long offset = 0; long long size = 0; };
+struct Pack { std::string name; long long size = 0; std::vector<PackedFile> files; };
+
+static bool read_file_bytes(const fs::path& file, std::string& out) {
+    out.clear();
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return false;
+    out.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
 
-    BCryptDestroyHash(hHash);
-    BCryptCloseAlgorithmProvider(hAlg, 0);
+static bool write_file_atomic(const fs::path& file, const std::string& bytes) {
+    fs::path tmp = file;
+    tmp += L".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec) fs::remove(tmp, ec);
+    return !ec;
+}
 
-    if (st != 0) return false;
+static bool pack_cut_point(const std::string& hash) {
+    return hash.size() >= 2 && hash[0] == '0' && hash[1] >= '0' && hash[1] <= '3';
+}
+
+// Packs every distinct blob of at most maxFileBytes (entries sorted by path), writes the packs
+// that do not exist yet and removes the ones no longer referenced.
+static bool write_packs(const fs::path& packDir, const std::vector<Entry>& entries, const std::map<std::string, fs::path>& diskPaths,
+    long long maxFileBytes, long long targetBytes, std::vector<Pack>& outPacks, std::wstring& outErr) {
+    outPacks.clear();
+    std::error_code ec;
+    fs::create_directories(packDir, ec);
+
+    std::set<std::string> seen;
+    std::string buf;
+    Pack cur;
+    auto flush = [&]() -> bool {
+        if (cur.files.empty()) return true;
+        std::string sha;
+        if (!sha256lib::HashBytesHex(buf.data(), buf.size(), sha)) { outErr = L"sha256 failed for a pack"; return false; }
+        cur.name = sha + ".pack";
+        cur.size = (long long)buf.size();
+        const fs::path file = packDir / cur.name;
+        std::error_code fec;
+        const bool present = fs::exists(file, fec) && (long long)fs::file_size(file, fec) == cur.size && !fec;
+        if (!present && !write_file_atomic(file, buf)) { outErr = L"Cannot write pack file:\n  " + file.wstring(); return false; }
+        outPacks.push_back(std::move(cur));
+        cur = Pack{};
+        buf.clear();
+        return true;
+    };
+
+    for (const auto& e : entries) {
+        if (e.size < 0 || e.size > maxFileBytes || !seen.insert(e.hash).second) continue;
+        auto dp = diskPaths.find(e.path);
+        std::string bytes, sha;
+        if (dp == diskPaths.end() || !read_file_bytes(dp->second, bytes)) { outErr = L"Cannot read file for packing:\n  " + (dp == diskPaths.end() ? fs::path() : dp->second).wstring(); return false; }
+        // The file may have been edited since it was hashed; a pack must never disagree with the manifest.
+        if (!sha256lib::HashBytesHex(bytes.data(), bytes.size(), sha) || sha != e.hash || (long long)bytes.size() != e.size) {
+            outErr = L"File changed while packing (re-run):\n  " + dp->second.wstring();
+            return false;
+        }
+        cur.files.push_back({ e.hash, (long long)buf.size(), (long long)bytes.size() });
+        buf += bytes;
+        const long long have = (long long)buf.size();
+        if (have >= targetBytes * 2 || (have >= targetBytes / 2 && pack_cut_point(e.hash))) {
+            if (!flush()) return false;
+        }
+    }
+    if (!flush()) return false;
 
-    outHex = bytes_to_hex_lower(hash);
+    std::set<std::wstring> keep;
+    for (const auto& p : outPacks) keep.insert(fs::path(p.name).wstring());
+    for (auto it = fs::directory_iterator(packDir, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        const fs::path p = it->path();
+        const std::wstring ext = p.extension().wstring();
+        if ((ext == L".pack" && keep.find(p.filename().wstring()) == keep.end()) || ext == L".tmp") {
+            std::error_code rec;
+            fs::remove(p, rec);
+        }
+    }
     return true;
 }
 
+static std::string pack_index_json(const std::vector<Pack>& packs) {
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"packs\": [\n";
+    for (size_t p = 0; p < packs.size(); ++p) {
+        json << "    {\n";
+        json << "      \"name\": \"" << packs[p].name << "\",\n";
+        json << "      \"size\": " << packs[p].size << ",\n";
+        json << "      \"files\": [\n";
+        const auto& files = packs[p].files;
+        for (size_t f = 0; f < files.size(); ++f) {
+            json << "        { \"sha256\": \"" << files[f].hash << "\", \"offset\": " << files[f].offset << ", \"size\": " << files[f].size << " }";
+            if (f + 1 < files.size()) json << ",";
+            json << "\n";
+        }
+        json << "      ]\n";
+        json << "    }";
+        if (p + 1 < packs.size()) json << ",";
+        json << "\n";
+    }
+    json << "  ]\n";
+    json << "}\n";
+    return json.str();
+}
+
 static fs::path get_exe_directory() {
     wchar_t buf[MAX_PATH]{};
     DWORD n = GetModuleFileNameW(nullptr, buf, MAX_PATH);
@@ -114,17 +324,50 @@ static fs::path get_exe_directory() {
     return p.parent_path();
 }
 
-int wmain() {
+int wmain(int argc, wchar_t* argv[]) {
     // Run-from-here behavior:
     // - Assume exe is located in the mappack3.6 folder (or run from it).
     // - Use exe directory as "root".
+    // - Optional: --delta also writes mappack_manifest_deltas\<previous sha256>.json against the
+    //   mappack_manifest.json being replaced. Upload the deltas folder along with the manifest.
+    // - Optional: --incremental reuses the previous manifest's hash for every file whose size and
+    //   last-write time match mappack_manifest.meta (written on every run); the rest are re-hashed.
+    // - Optional: --threads N (default: one per CPU) hashing threads.
+    // - Optional: --pack also writes mappack_packs\ (pack files + index.json) holding every file up
+    //   to --pack-max-file-kb (default 256) in packs of about --pack-size-mb (default 16). Upload
+    //   the folder along with the manifest.
     fs::path baseDir = get_exe_directory();
 
+    bool writeDelta = false;
+    bool incremental = false;
+    bool writePacks = false;
+    long long packMaxFileKb = 256;
+    long long packSizeMb = 16;
+    unsigned threadCount = std::thread::hardware_concurrency();
+    for (int a = 1; a < argc; ++a) {
+        if (_wcsicmp(argv[a], L"--delta") == 0 || _wcsicmp(argv[a], L"/delta") == 0) writeDelta = true;
+        else if (_wcsicmp(argv[a], L"--incremental") == 0 || _wcsicmp(argv[a], L"/incremental") == 0) incremental = true;
+        else if ((_wcsicmp(argv[a], L"--threads") == 0 || _wcsicmp(argv[a], L"/threads") == 0) && a + 1 < argc) {
+            threadCount = (unsigned)std::wcstoul(argv[++a], nullptr, 10);
+        }
+        else if (_wcsicmp(argv[a], L"--pack") == 0 || _wcsicmp(argv[a], L"/pack") == 0) writePacks = true;
+        else if ((_wcsicmp(argv[a], L"--pack-max-file-kb") == 0 || _wcsicmp(argv[a], L"/pack-max-file-kb") == 0) && a + 1 < argc) {
+            packMaxFileKb = (long long)std::wcstoul(argv[++a], nullptr, 10);
+        }
+        else if ((_wcsicmp(argv[a], L"--pack-size-mb") == 0 || _wcsicmp(argv[a], L"/pack-size-mb") == 0) && a + 1 < argc) {
+            packSizeMb = (long long)std::wcstoul(argv[++a], nullptr, 10);
+        }
+    }
+    if (threadCount == 0) threadCount = 1;
+    if (packMaxFileKb <= 0) packMaxFileKb = 256;
+    if (packSizeMb <= 0) packSizeMb = 16;
+
     // Required input folder:
     fs::path resourcesOverride = baseDir / L"resources_override";
 
     // Output file in baseDir:
     fs::path outJson = baseDir / L"mappack_manifest.json";
+    fs::path outMeta = baseDir / L"mappack_manifest.meta";
 
     std::error_code ec;
     if (!fs::exists(resourcesOverride, ec) || !fs::is_directory(resourcesOverride, ec)) {
@@ -133,8 +376,34 @@ int wmain() {
         return 2;
     }
 
-    struct Entry { std::string path; std::string hash; };
+    // Previous manifest (delta base, incremental hash source) must be read before it is overwritten.
+    std::vector<Entry> prevEntries;
+    std::string prevSha;
+    const bool havePrev = (writeDelta || incremental) && fs::exists(outJson, ec) && read_previous_manifest(outJson, prevEntries);
+    if (writeDelta) {
+        if (!havePrev || !sha256lib::HashFileHex(outJson.wstring(), prevSha)) {
+            std::wcerr << L"WARNING: --delta given but no readable previous manifest; no delta written.\n";
+            prevSha.clear();
+        }
+    }
+    std::map<std::string, Entry> prevByPath;
+    std::map<std::string, FileStamp> prevStamps;
+    if (incremental) {
+        if (havePrev && read_meta_sidecar(outMeta, prevStamps)) {
+            for (const auto& e : prevEntries) prevByPath[e.path] = e;
+        }
+        else {
+            std::wcerr << L"WARNING: --incremental given but no previous manifest/metadata; hashing every file.\n";
+            prevStamps.clear();
+        }
+    }
+
     std::vector<Entry> entries;
+    std::vector<sha256lib::FileJob> jobs;
+    std::vector<size_t> jobEntry;   // jobs[i] hashes entries[jobEntry[i]]
+    std::map<std::string, FileStamp> stamps;
+    std::map<std::string, fs::path> diskPaths;   // manifest path -> file, for --pack
+    size_t reused = 0;
 
     // We want "resources_override/..." paths in manifest
     const std::string prefix = "resources_override/";
@@ -154,14 +423,50 @@ int wmain() {
         std::string relUtf8 = to_utf8(rel.generic_wstring()); // forward slashes
         std::string manifestPath = prefix + relUtf8;
 
-        std::string h;
-        if (!sha256_file_bcrypt(p, h)) {
-            std::wcerr << L"ERROR: sha256 failed for:\n  " << p.wstring() << L"\n";
-            return 1; // fail fast
+        // Size and time come from the directory enumeration; no extra open per file.
+        const std::uintmax_t size = it->file_size(ec);
+        if (ec) {
+            std::wcerr << L"ERROR: size query failed for:\n  " << p.wstring() << L"\n";
+            return 1;
+        }
+        const auto mtime = it->last_write_time(ec);
+        if (ec) {
+            std::wcerr << L"ERROR: time query failed for:\n  " << p.wstring() << L"\n";
+            return 1;
         }
+        FileStamp stamp{ (long long)size, (long long)mtime.time_since_epoch().count() };
+        stamps[manifestPath] = stamp;
+        if (writePacks) diskPaths[manifestPath] = p;
+
+        Entry e{ manifestPath, std::string(), (long long)size };
+        auto st = prevStamps.find(manifestPath);
+        auto pe = prevByPath.find(manifestPath);
+        if (st != prevStamps.end() && pe != prevByPath.end() && st->second.size == stamp.size && st->second.mtime == stamp.mtime
+            && (pe->second.size < 0 || pe->second.size == stamp.size) && pe->second.hash.size() == 64) {
+            e.hash = pe->second.hash;
+            ++reused;
+        }
+        else {
+            sha256lib::FileJob job;
+            job.path = p.wstring();
+            jobs.push_back(std::move(job));
+            jobEntry.push_back(entries.size());
+        }
+        entries.push_back(std::move(e));
+    }
 
-        entries.push_back({ manifestPath, h });
+    if (sha256lib::HashFilesHex(jobs, threadCount, true) != 0) {
+        // Jobs are claimed in order, so the first !ok one really failed (the rest were skipped).
+        for (const auto& job : jobs) {
+            if (job.ok) continue;
+            std::wcerr << L"ERROR: sha256 failed for:\n  " << job.path << L"\n";
+            break;
+        }
+        return 1; // fail fast
     }
+    for (size_t i = 0; i < jobs.size(); ++i) entries[jobEntry[i]].hash = std::move(jobs[i].hexLower);
+    std::wcout << L"Hashed " << jobs.size() << L" files (" << reused << L" unchanged, reused) on "
+        << (std::max)(1u, (std::min)(threadCount, (unsigned)jobs.size())) << L" threads.\n";
 
     // Deterministic sort
     std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
@@ -174,7 +479,8 @@ int wmain() {
     for (size_t i = 0; i < entries.size(); ++i) {
         json << "    {\n";
         json << "      \"path\": \"" << json_escape(entries[i].path) << "\",\n";
-        json << "      \"sha256\": \"" << entries[i].hash << "\"\n";
+        json << "      \"sha256\": \"" << entries[i].hash << "\",\n";
+        json << "      \"size\": " << entries[i].size << "\n";
         json << "    }";
         if (i + 1 < entries.size()) json << ",";
         json << "\n";
@@ -193,5 +499,80 @@ int wmain() {
     out.close();
 
     std::wcout << L"Wrote " << entries.size() << L" entries to:\n  " << outJson.wstring() << L"\n";
+
+    // A missing or stale sidecar only costs the next --incremental run a full re-hash.
+    if (!write_meta_sidecar(outMeta, entries, stamps)) {
+        std::wcerr << L"WARNING: Cannot write metadata sidecar:\n  " << outMeta.wstring() << L"\n";
+    }
+
+    // Head file: the SHA-256 of the manifest just written. Clients holding a cached manifest read
+    // this first and only fetch deltas (or nothing) when it moved. Always upload it with the manifest.
+    std::string newSha;
+    if (!sha256lib::HashFileHex(outJson.wstring(), newSha)) {
+        std::wcerr << L"ERROR: sha256 failed for:\n  " << outJson.wstring() << L"\n";
+        return 1;
+    }
+    {
+        fs::path outHead = baseDir / L"mappack_manifest.sha256";
+        std::ofstream head(outHead, std::ios::binary | std::ios::trunc);
+        if (!head) {
+            std::wcerr << L"ERROR: Cannot write output file:\n  " << outHead.wstring() << L"\n";
+            return 2;
+        }
+        head << newSha << "\n";
+    }
+
+    if (!prevSha.empty() && prevSha != newSha) {
+        const fs::path deltaDir = baseDir / L"mappack_manifest_deltas";
+        size_t changes = 0;
+        if (!write_manifest_delta(deltaDir, prevSha, newSha, prevEntries, entries, changes)) {
+            std::wcerr << L"ERROR: Cannot write delta into:\n  " << deltaDir.wstring() << L"\n";
+            return 2;
+        }
+        std::wcout << L"Wrote delta (" << changes << L" changes) to:\n  " << (deltaDir / (prevSha + ".json")).wstring() << L"\n";
+    }
+    else if (writeDelta && !prevSha.empty()) {
+        std::wcout << L"Manifest unchanged; no delta written.\n";
+    }
+
+    // Pre-compressed twin. The sync client tries it only when it has read mappack_manifest.sha256,
+    // and uses it only if the inflated bytes hash to that head; otherwise it takes the .json.
+    fs::path outGz = outJson;
+    outGz += L".gz";
+    const std::string gzStr = minigzip::GzipCompress(outStr);
+    std::ofstream gz(outGz, std::ios::binary | std::ios::trunc);
+    if (!gz) {
+        std::wcerr << L"ERROR: Cannot write output file:\n  " << outGz.wstring() << L"\n";
+        return 2;
+    }
+    gz.write(gzStr.data(), (std::streamsize)gzStr.size());
+    gz.close();
+
+    std::wcout << L"Wrote " << gzStr.size() << L" bytes (gzip) to:\n  " << outGz.wstring() << L"\n";
+
+    if (writePacks) {
+        const fs::path packDir = baseDir / L"mappack_packs";
+        std::vector<Pack> packs;
+        std::wstring packErr;
+        if (!write_packs(packDir, entries, diskPaths, packMaxFileKb * 1024, packSizeMb * 1024 * 1024, packs, packErr)) {
+            std::wcerr << L"ERROR: " << packErr << L"\n";
+            return 2;
+        }
+        const std::string indexStr = pack_index_json(packs);
+        // No .gz twin: the client only uses one against a published sha256, and the index has none.
+        const fs::path outIndex = packDir / L"index.json";
+        if (!write_file_atomic(outIndex, indexStr)) {
+            std::wcerr << L"ERROR: Cannot write output file:\n  " << outIndex.wstring() << L"\n";
+            return 2;
+        }
+        size_t packedFiles = 0;
+        long long packedBytes = 0;
+        for (const auto& pk : packs) {
+            packedFiles += pk.files.size();
+            packedBytes += pk.size;
+        }
+        std::wcout << L"Wrote " << packs.size() << L" packs (" << packedFiles << L" files, " << packedBytes << L" bytes) to:\n  "
+            << packDir.wstring() << L"\n";
+    }
     return 0;
 }
@@ -0,0 +1,921 @@
+/*
+MapPackSyncBench (synthetic benchmarks for the MapPackSyncTool hot paths)
+Usage
+- MapPackSyncBench generate <dir> [--files N] [--min-kb K] [--max-kb K] [--dirs D]
+                            [--dup-pct P] [--local-pct P] [--stale-pct P] [--seed S]
+	Writes a synthetic MapPack under <dir>\remote (files + mappack_manifest.json, exactly as
+	ManifestSha256 serializes it) and a partially synced install under <dir>\install: local-pct
+	of the files present, stale-pct of those with one byte changed (same size, so only the hash
+	can tell), dup-pct of all paths sharing content with an earlier one.
+- MapPackSyncBench micro <dir> [--iterations N] [--csv <file>] [--label L]
+	ParseAndValidateManifest, ParseManifestRaw, NormalizeManifestRelStrict, IsPathExcluded (50 exclusions),
+	Sha256FileHexLower over every remote file, and ScanLocalTree of the install.
+- MapPackSyncBench sync <dir> [--latency-ms L] [--workers W] [--iterations N] [--csv <file>] [--label L]
+	Serves <dir>\remote from a loopback HTTP/1.1 server (keep-alive, single Range requests, L ms
+	added before every response) and runs DownloadAndUpdateFiles end to end against a fresh copy
+	of <dir>\install per iteration. The sync log of the last iteration goes to <dir>\bench_sync.log.
+- MapPackSyncBench resume <dir>
+	Check (exit code 1 on failure): keeps half of the largest remote file as an interrupted
+	download and verifies that the next download resumes it with a single Range request.
+Notes
+- MapPackSyncTool.cpp is compiled into this exe (MAPPACKSYNCTOOL_NO_WINMAIN), so every benchmark
+  runs the shipping code, not a copy of it. Nothing here touches the tool's INI besides what the
+  shared code reads on its own (the per-root hash index is NOT used; every local file is hashed).
+- Results go to the console and, with --csv, are appended to a CSV file (header written when the
+  file is new) so runs from different builds can be compared; --label tags the rows.
+- Hashing and scanning run with a warm file cache right after "generate"; reboot or use a larger
+  data set than RAM for cold-cache numbers.
+*/
+
+#define MAPPACKSYNCTOOL_NO_WINMAIN
+#include "../MapPackSyncTool/MapPackSyncTool.cpp"
+
+#include <ws2tcpip.h>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+#pragma comment(lib, "ws2_32.lib")
+
+// --------------------------------------------------
+// Command line + small helpers
+// --------------------------------------------------
+struct BenchArgs
+{
+	std::wstring mode;
+	fs::path dir;
+	std::vector<std::wstring> rest;   // "--name value" pairs
+};
+static bool BenchArgString(const BenchArgs& a, const wchar_t* name, std::wstring& out)
+{
+	for (size_t i = 0; i + 1 < a.rest.size(); ++i)
+	{
+		if (a.rest[i] == name)
+		{
+			out = a.rest[i + 1];
+			return true;
+		}
+	}
+	return false;
+}
+static long long BenchArgInt(const BenchArgs& a, const wchar_t* name, long long def, long long lo, long long hi)
+{
+	std::wstring s;
+	if (!BenchArgString(a, name, s))
+		return def;
+	wchar_t* end = nullptr;
+	const long long v = wcstoll(s.c_str(), &end, 10);
+	if (!end || *end != L'\0')
+		return def;
+	return (std::max)(lo, (std::min)(hi, v));
+}
+static bool BenchReadFile(const fs::path& p, std::string& out)
+{
+	out.clear();
+	std::ifstream f(p, std::ios::binary);
+	if (!f)
+		return false;
+	f.seekg(0, std::ios::end);
+	const std::streamoff n = f.tellg();
+	if (n < 0)
+		return false;
+	out.resize((size_t)n);
+	f.seekg(0, std::ios::beg);
+	return n == 0 || (bool)f.read(&out[0], n);
+}
+static bool BenchWriteFile(const fs::path& p, const std::string& bytes)
+{
+	std::error_code ec;
+	fs::create_directories(p.parent_path(), ec);
+	std::ofstream f(p, std::ios::binary | std::ios::trunc);
+	if (!f)
+		return false;
+	f.write(bytes.data(), (std::streamsize)bytes.size());
+	return (bool)f;
+}
+static std::string BenchRandomBytes(unsigned long long seed, size_t size)
+{
+	std::mt19937_64 rng(seed);
+	std::string s(size, '\0');
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		const unsigned long long v = rng();
+		memcpy(&s[i], &v, 8);
+	}
+	if (i < size)
+	{
+		const unsigned long long v = rng();
+		memcpy(&s[i], &v, size - i);
+	}
+	return s;
+}
+static double BenchNowMs()
+{
+	LARGE_INTEGER t{};
+	QueryPerformanceCounter(&t);
+	return PerfTicksToMs(t.QuadPart);
+}
+
+// --------------------------------------------------
+// Results
+// - One row per benchmark: best and mean wall time over the iterations, throughput from best.
+// --------------------------------------------------
+struct BenchResult
+{
+	std::string name;
+	unsigned long long items = 0;
+	unsigned long long bytes = 0;
+	int iterations = 0;
+	double bestMs = 0.0;
+	double meanMs = 0.0;
+	std::string extra;   // "key=value;..." benchmark-specific
+};
+template <typename Fn>
+static BenchResult BenchTime(const char* name, int iterations, unsigned long long items, unsigned long long bytes, Fn&& fn)
+{
+	BenchResult r;
+	r.name = name;
+	r.items = items;
+	r.bytes = bytes;
+	r.iterations = iterations;
+	double total = 0.0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		const double t0 = BenchNowMs();
+		fn();
+		const double ms = BenchNowMs() - t0;
+		total += ms;
+		if (i == 0 || ms < r.bestMs)
+			r.bestMs = ms;
+	}
+	r.meanMs = iterations > 0 ? total / iterations : 0.0;
+	return r;
+}
+static void BenchReport(const BenchResult& r, const std::wstring& csvPath, const std::string& label)
+{
+	const double secs = r.bestMs / 1000.0;
+	const double itemsPerSec = secs > 0.0 ? (double)r.items / secs : 0.0;
+	const double mbPerSec = secs > 0.0 ? ((double)r.bytes / (1024.0 * 1024.0)) / secs : 0.0;
+	printf("%-28s best %10.3f ms  mean %10.3f ms  %12.0f items/s", r.name.c_str(), r.bestMs, r.meanMs, itemsPerSec);
+	if (r.bytes > 0)
+		printf("  %9.1f MB/s", mbPerSec);
+	if (!r.extra.empty())
+		printf("  [%s]", r.extra.c_str());
+	printf("\n");
+	if (csvPath.empty())
+		return;
+
+	std::error_code ec;
+	const bool isNew = !fs::exists(csvPath, ec);
+	std::ofstream f(fs::path(csvPath), std::ios::binary | std::ios::app);
+	if (!f)
+	{
+		printf("WARNING: cannot append to CSV file %s\n", WideToUtf8(csvPath).c_str());
+		return;
+	}
+	if (isNew)
+		f << "time,label,benchmark,items,bytes,iterations,best_ms,mean_ms,items_per_s,mb_per_s,extra\n";
+
+	const std::time_t now = std::time(nullptr);
+	std::tm tmLocal{};
+	localtime_s(&tmLocal, &now);
+	char when[32]{};
+	strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", &tmLocal);
+	char nums[160]{};
+	sprintf_s(nums, "%llu,%llu,%d,%.3f,%.3f,%.1f,%.2f", r.items, r.bytes, r.iterations, r.bestMs, r.meanMs, itemsPerSec, mbPerSec);
+	f << when << ',' << label << ',' << r.name << ',' << nums << ',' << r.extra << "\n";
+}
+
+// --------------------------------------------------
+// generate
+// - Paths look like the real pack: resources_override/mappack/resources/dNNN/fNNNNNN.dat.
+// - Sizes are uniform in [min-kb, max-kb]; content is seeded so a rerun with the same options
+//   produces the same tree (and the same manifest hash).
+// --------------------------------------------------
+struct BenchGenOptions
+{
+	size_t files = 2000;
+	size_t minKb = 4;
+	size_t maxKb = 512;
+	size_t dirs = 40;
+	int dupPct = 5;
+	int localPct = 70;
+	int stalePct = 10;
+	unsigned long long seed = 1;
+};
+static std::string BenchFileRel(size_t i, size_t dirs)
+{
+	char buf[96]{};
+	sprintf_s(buf, "resources_override/mappack/resources/d%03zu/f%06zu.dat", i % dirs, i);
+	return buf;
+}
+static int BenchGenerate(const BenchArgs& a)
+{
+	BenchGenOptions o;
+	o.files = (size_t)BenchArgInt(a, L"--files", (long long)o.files, 1, 10000000);
+	o.minKb = (size_t)BenchArgInt(a, L"--min-kb", (long long)o.minKb, 0, 1024 * 1024);
+	o.maxKb = (size_t)BenchArgInt(a, L"--max-kb", (long long)o.maxKb, (long long)o.minKb, 1024 * 1024);
+	o.dirs = (size_t)BenchArgInt(a, L"--dirs", (long long)o.dirs, 1, 100000);
+	o.dupPct = (int)BenchArgInt(a, L"--dup-pct", o.dupPct, 0, 100);
+	o.localPct = (int)BenchArgInt(a, L"--local-pct", o.localPct, 0, 100);
+	o.stalePct = (int)BenchArgInt(a, L"--stale-pct", o.stalePct, 0, 100);
+	o.seed = (unsigned long long)BenchArgInt(a, L"--seed", (long long)o.seed, 0, LLONG_MAX);
+
+	const fs::path remote = a.dir / "remote";
+	const fs::path install = a.dir / "install";
+	std::error_code ec;
+	fs::remove_all(remote, ec);
+	fs::remove_all(install, ec);
+	if (!BenchWriteFile(install / "istaria.exe", std::string()))
+	{
+		printf("ERROR: cannot write under %s\n", PathToUtf8(install).c_str());
+		return 1;
+	}
+
+	std::mt19937_64 rng(o.seed);
+	std::vector<unsigned long long> contentSeeds(o.files);
+	std::vector<size_t> sizes(o.files);
+	std::map<std::string, ManifestFileInfo> manifest;
+	unsigned long long totalBytes = 0, localFiles = 0, staleFiles = 0, dupFiles = 0;
+	for (size_t i = 0; i < o.files; ++i)
+	{
+		if (i > 0 && (int)(rng() % 100) < o.dupPct)
+		{
+			const size_t j = (size_t)(rng() % i);
+			contentSeeds[i] = contentSeeds[j];
+			sizes[i] = sizes[j];
+			++dupFiles;
+		}
+		else
+		{
+			contentSeeds[i] = rng();
+			sizes[i] = (size_t)(o.minKb * 1024 + rng() % ((o.maxKb - o.minKb) * 1024 + 1));
+		}
+		std::string bytes = BenchRandomBytes(contentSeeds[i], sizes[i]);
+		const std::string rel = BenchFileRel(i, o.dirs);
+		ManifestFileInfo info;
+		info.size = (long long)bytes.size();
+		if (!Sha256BytesHexLower(bytes.data(), bytes.size(), info.sha256)
+			|| !BenchWriteFile(remote / Utf8ToWide(rel), bytes))
+		{
+			printf("ERROR: cannot write %s\n", rel.c_str());
+			return 1;
+		}
+		manifest.emplace(rel, std::move(info));
+		totalBytes += bytes.size();
+
+		if ((int)(rng() % 100) < o.localPct)
+		{
+			if (!bytes.empty() && (int)(rng() % 100) < o.stalePct)
+			{
+				bytes.back() = (char)(bytes.back() ^ 0x5A);
+				++staleFiles;
+			}
+			if (!BenchWriteFile(install / Utf8ToWide(rel), bytes))
+			{
+				printf("ERROR: cannot write install copy of %s\n", rel.c_str());
+				return 1;
+			}
+			++localFiles;
+		}
+	}
+	if (!BenchWriteFile(remote / "mappack_manifest.json", SerializeManifestCanonical(manifest)))
+	{
+		printf("ERROR: cannot write mappack_manifest.json\n");
+		return 1;
+	}
+	printf("Generated %zu files (%s, %llu duplicate content) in %s\n", o.files, PerfFormatBytes(totalBytes).c_str(), dupFiles, PathToUtf8(remote).c_str());
+	printf("Install copy: %llu files present, %llu of them stale, in %s\n", localFiles, staleFiles, PathToUtf8(install).c_str());
+	return 0;
+}
+
+// --------------------------------------------------
+// micro
+// --------------------------------------------------
+static bool BenchLoadManifest(const fs::path& dir, std::string& text, std::vector<ManifestRawEntry>& raw)
+{
+	std::string err;
+	if (!BenchReadFile(dir / "remote" / "mappack_manifest.json", text))
+	{
+		printf("ERROR: %s\\remote\\mappack_manifest.json not found (run \"generate\" first)\n", PathToUtf8(dir).c_str());
+		return false;
+	}
+	if (!ParseManifestRaw(text, raw, &err))
+	{
+		printf("ERROR: manifest parse failed: %s\n", err.c_str());
+		return false;
+	}
+	return true;
+}
+static int BenchMicro(const BenchArgs& a)
+{
+	const int iterations = (int)BenchArgInt(a, L"--iterations", 5, 1, 100000);
+	std::wstring csv, labelW;
+	BenchArgString(a, L"--csv", csv);
+	BenchArgString(a, L"--label", labelW);
+	const std::string label = WideToUtf8(labelW);
+
+	std::string text;
+	std::vector<ManifestRawEntry> raw;
+	if (!BenchLoadManifest(a.dir, text, raw))
+		return 1;
+	std::vector<ManifestEntry> workList;
+	StringArena arena;
+	std::string err;
+	if (!ParseAndValidateManifest(text, workList, arena, err))
+	{
+		printf("ERROR: %s\n", err.c_str());
+		return 1;
+	}
+	printf("Manifest: %zu entries, %s\n\n", raw.size(), PerfFormatBytes(text.size()).c_str());
+
+	{
+		std::vector<ManifestEntry> out;
+		StringArena outArena;
+		BenchResult r = BenchTime("ParseAndValidateManifest", iterations, workList.size(), text.size(), [&]() {
+			(void)ParseAndValidateManifest(text, out, outArena, err);
+		});
+		r.extra = "arena_chunks=" + std::to_string(outArena.chunks.size());
+		BenchReport(r, csv, label);
+	}
+	{
+		std::vector<ManifestRawEntry> out;
+		BenchResult r = BenchTime("ParseManifestRaw", iterations, raw.size(), text.size(), [&]() {
+			(void)ParseManifestRaw(text, out, &err);
+		});
+		BenchReport(r, csv, label);
+	}
+	{
+		size_t bad = 0;
+		std::string rel;
+		BenchResult r = BenchTime("NormalizeManifestRelStrict", iterations, raw.size(), 0, [&]() {
+			for (const auto& e : raw)
+			{
+				if (!NormalizeManifestRelStrict(e.path, rel, nullptr))
+					++bad;
+			}
+		});
+		r.extra = "rejected=" + std::to_string(bad / (size_t)iterations);
+		BenchReport(r, csv, label);
+	}
+	{
+		// Exclusions shaped like real ones: a few folders and many single files, some matching.
+		const fs::path installRoot = fs::absolute(a.dir / "install");
+		ExclusionMatcher matcher;
+		for (size_t k = 0; k < 50; ++k)
+		{
+			char dirRel[32]{};
+			sprintf_s(dirRel, "resources/d%03zu", k / 10);
+			const std::string rel = (k % 10 == 0) ? std::string(dirRel) : std::string(workList[(k * 7919) % workList.size()].relPath);
+			matcher.Add(NormalizeExclusionPathForCompare(MakeDestPath(installRoot, rel)));
+		}
+		std::vector<fs::path> targets;
+		targets.reserve(workList.size());
+		for (const auto& e : workList)
+			targets.push_back(MakeDestPath(installRoot, e.relPath));
+		size_t hits = 0;
+		BenchResult r = BenchTime("IsPathExcluded", iterations, targets.size(), 0, [&]() {
+			for (const auto& p : targets)
+			{
+				if (IsPathExcluded(matcher, p))
+					++hits;
+			}
+		});
+		r.extra = "exclusions=50;hits=" + std::to_string(hits / (size_t)iterations);
+		BenchReport(r, csv, label);
+	}
+	{
+		std::vector<fs::path> files;
+		unsigned long long bytes = 0;
+		for (const auto& e : workList)
+		{
+			files.push_back(a.dir / "remote" / Utf8ToWide(std::string(e.remotePath)));
+			bytes += e.size > 0 ? (unsigned long long)e.size : 0ull;
+		}
+		size_t mismatches = 0;
+		std::string hex;
+		BenchResult r = BenchTime("Sha256FileHexLower", iterations, files.size(), bytes, [&]() {
+			for (size_t i = 0; i < files.size(); ++i)
+			{
+				if (!Sha256FileHexLower(files[i], hex) || hex != workList[i].Sha256Hex())
+					++mismatches;
+			}
+		});
+		r.extra = "single_thread;mismatches=" + std::to_string(mismatches / (size_t)iterations);
+		BenchReport(r, csv, label);
+	}
+	{
+		size_t entries = 0;
+		std::atomic_bool never{ false };
+		CancelToken cancel{ &never };
+		BenchResult r = BenchTime("ScanLocalTree", iterations, 0, 0, [&]() {
+			LocalTreeSnapshot tree;
+			(void)ScanLocalTree(a.dir / "install" / "resources_override", tree, cancel);
+			entries = tree.fileCount + tree.dirCount;
+		});
+		r.items = entries;
+		BenchReport(r, csv, label);
+	}
+	return 0;
+}
+
+// --------------------------------------------------
+// Loopback HTTP server
+// - Just enough HTTP/1.1 for WinHTTP: GET, keep-alive, one byte range per request (206/416),
+//   an ETag so If-Range resumes stay valid. Multi-range requests get the whole body (200),
+//   which the pack fetcher treats as "no multipart support". Missing files are 404, so the
+//   optional pack index and mirror lists simply do not exist.
+// - One thread per connection; WinHTTP opens at most DownloadWorkers of them.
+// --------------------------------------------------
+class BenchHttpServer
+{
+public:
+	bool Start(const fs::path& root, int latencyMs)
+	{
+		root_ = root;
+		latencyMs_ = latencyMs;
+		listen_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (listen_ == INVALID_SOCKET)
+			return false;
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		int len = sizeof(addr);
+		if (bind(listen_, (sockaddr*)&addr, sizeof(addr)) != 0
+			|| listen(listen_, SOMAXCONN) != 0
+			|| getsockname(listen_, (sockaddr*)&addr, &len) != 0)
+		{
+			closesocket(listen_);
+			listen_ = INVALID_SOCKET;
+			return false;
+		}
+		port_ = ntohs(addr.sin_port);
+		acceptThread_ = std::thread([this]() { AcceptLoop(); });
+		return true;
+	}
+	void Stop()
+	{
+		if (listen_ != INVALID_SOCKET)
+		{
+			closesocket(listen_);
+			listen_ = INVALID_SOCKET;
+		}
+		if (acceptThread_.joinable())
+			acceptThread_.join();
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			for (SOCKET s : clients_)
+				shutdown(s, SD_BOTH);
+			threads.swap(threads_);
+		}
+		for (auto& t : threads)
+			t.join();
+	}
+	~BenchHttpServer() { Stop(); }
+	std::string BaseUrl() const { return "http://127.0.0.1:" + std::to_string(port_); }
+	unsigned long long Requests() const { return requests_.load(); }
+	unsigned long long Connections() const { return connections_.load(); }
+	unsigned long long PartialResponses() const { return partials_.load(); }
+	unsigned long long BodyBytesSent() const { return bodyBytes_.load(); }
+	// Strong ETag the server sends for `file` (size + last write time).
+	static std::string EtagOf(const fs::path& file, size_t size)
+	{
+		std::error_code ec;
+		const auto stamp = fs::last_write_time(file, ec).time_since_epoch().count();
+		return "\"" + std::to_string(size) + "-" + std::to_string((long long)stamp) + "\"";
+	}
+
+private:
+	void AcceptLoop()
+	{
+		for (;;)
+		{
+			SOCKET s = accept(listen_, nullptr, nullptr);
+			if (s == INVALID_SOCKET)
+				return;
+			BOOL noDelay = TRUE;
+			setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+			connections_.fetch_add(1);
+			std::lock_guard<std::mutex> guard(lock_);
+			clients_.push_back(s);
+			threads_.emplace_back([this, s]() { Serve(s); });
+		}
+	}
+	static bool SendAll(SOCKET s, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			const int n = send(s, data, (int)(std::min)(size, (size_t)(1 << 20)), 0);
+			if (n <= 0)
+				return false;
+			data += n;
+			size -= (size_t)n;
+		}
+		return true;
+	}
+	static std::string HeaderValue(const std::string& head, const char* name)
+	{
+		const std::string want = std::string("\r\n") + name + ":";
+		for (size_t pos = 0; (pos = head.find("\r\n", pos)) != std::string::npos; pos += 2)
+		{
+			if (head.size() - pos >= want.size() && EqualIcaseAscii(head.substr(pos, want.size()), want))
+			{
+				const size_t start = pos + want.size();
+				const size_t end = head.find("\r\n", start);
+				std::string v = head.substr(start, end == std::string::npos ? std::string::npos : end - start);
+				while (!v.empty() && (v.front() == ' ' || v.front() == '\t')) v.erase(v.begin());
+				while (!v.empty() && (v.back() == ' ' || v.back() == '\t')) v.pop_back();
+				return v;
+			}
+		}
+		return std::string();
+	}
+	// Request target -> file under root_; false for anything that could leave it.
+	bool ResolveTarget(const std::string& target, fs::path& out) const
+	{
+		std::string p = target.substr(0, target.find('?'));
+		std::string decoded;
+		for (size_t i = 0; i < p.size(); ++i)
+		{
+			if (p[i] == '%' && i + 2 < p.size() && isxdigit((unsigned char)p[i + 1]) && isxdigit((unsigned char)p[i + 2]))
+			{
+				decoded.push_back((char)strtol(p.substr(i + 1, 2).c_str(), nullptr, 16));
+				i += 2;
+			}
+			else
+				decoded.push_back(p[i]);
+		}
+		while (!decoded.empty() && decoded.front() == '/') decoded.erase(decoded.begin());
+		if (decoded.empty() || decoded.find("..") != std::string::npos || decoded.find(':') != std::string::npos || decoded.find('\\') != std::string::npos)
+			return false;
+		out = root_ / Utf8ToWide(decoded);
+		return true;
+	}
+	void Serve(SOCKET s)
+	{
+		std::string buf;
+		char chunk[16 * 1024];
+		for (;;)
+		{
+			size_t headEnd;
+			while ((headEnd = buf.find("\r\n\r\n")) == std::string::npos)
+			{
+				const int n = recv(s, chunk, sizeof(chunk), 0);
+				if (n <= 0 || buf.size() > 64 * 1024)
+				{
+					CloseClient(s);
+					return;
+				}
+				buf.append(chunk, (size_t)n);
+			}
+			const std::string head = buf.substr(0, headEnd + 2);
+			buf.erase(0, headEnd + 4);
+			if (!Respond(s, head))
+			{
+				CloseClient(s);
+				return;
+			}
+		}
+	}
+	bool Respond(SOCKET s, const std::string& head)
+	{
+		requests_.fetch_add(1);
+		if (latencyMs_ > 0)
+			Sleep((DWORD)latencyMs_);
+
+		const size_t sp1 = head.find(' ');
+		const size_t sp2 = sp1 == std::string::npos ? std::string::npos : head.find(' ', sp1 + 1);
+		const std::string method = head.substr(0, sp1);
+		const bool keepAlive = !EqualIcaseAscii(HeaderValue(head, "Connection"), "close");
+		auto sendStatus = [&](const char* status) {
+			const std::string r = std::string("HTTP/1.1 ") + status + "\r\nContent-Length: 0\r\n" + (keepAlive ? "" : "Connection: close\r\n") + "\r\n";
+			return SendAll(s, r.data(), r.size()) && keepAlive;
+		};
+		if (sp2 == std::string::npos || (method != "GET" && method != "HEAD"))
+			return sendStatus("400 Bad Request");
+
+		fs::path file;
+		std::string body;
+		if (!ResolveTarget(head.substr(sp1 + 1, sp2 - sp1 - 1), file) || !BenchReadFile(file, body))
+			return sendStatus("404 Not Found");
+
+		const std::string etag = EtagOf(file, body.size());
+
+		// Single "bytes=a-b", "bytes=a-" or "bytes=-n"; If-Range with another validator = whole body.
+		unsigned long long first = 0, last = body.empty() ? 0 : body.size() - 1;
+		bool partial = false;
+		const std::string range = HeaderValue(head, "Range");
+		const std::string ifRange = HeaderValue(head, "If-Range");
+		if (!range.empty() && range.compare(0, 6, "bytes=") == 0 && range.find(',') == std::string::npos
+			&& (ifRange.empty() || ifRange == etag))
+		{
+			const std::string spec = range.substr(6);
+			const size_t dash = spec.find('-');
+			if (dash == std::string::npos)
+				return sendStatus("416 Range Not Satisfiable");
+			const std::string a = spec.substr(0, dash), b = spec.substr(dash + 1);
+			if (a.empty())
+			{
+				const unsigned long long n = strtoull(b.c_str(), nullptr, 10);
+				if (n == 0 || body.empty())
+					return sendStatus("416 Range Not Satisfiable");
+				first = n >= body.size() ? 0 : body.size() - n;
+			}
+			else
+			{
+				first = strtoull(a.c_str(), nullptr, 10);
+				if (!b.empty())
+					last = (std::min)(last, (unsigned long long)strtoull(b.c_str(), nullptr, 10));
+			}
+			if (first >= body.size() || first > last)
+				return sendStatus("416 Range Not Satisfiable");
+			partial = true;
+		}
+
+		const unsigned long long count = body.empty() ? 0 : last - first + 1;
+		std::string r = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+		r += "Content-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\nETag: " + etag + "\r\n";
+		r += "Content-Length: " + std::to_string(count) + "\r\n";
+		if (partial)
+			r += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(body.size()) + "\r\n";
+		if (!keepAlive)
+			r += "Connection: close\r\n";
+		r += "\r\n";
+		if (!SendAll(s, r.data(), r.size()))
+			return false;
+		if (method == "GET" && count > 0 && !SendAll(s, body.data() + first, (size_t)count))
+			return false;
+		if (partial)
+			partials_.fetch_add(1);
+		if (method == "GET")
+			bodyBytes_.fetch_add(count);
+		return keepAlive;
+	}
+	void CloseClient(SOCKET s)
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		auto it = std::find(clients_.begin(), clients_.end(), s);
+		if (it != clients_.end())
+			clients_.erase(it);
+		closesocket(s);
+	}
+
+	fs::path root_;
+	int latencyMs_ = 0;
+	SOCKET listen_ = INVALID_SOCKET;
+	unsigned short port_ = 0;
+	std::thread acceptThread_;
+	std::mutex lock_;                  // guards clients_ and threads_
+	std::vector<SOCKET> clients_;      // open connections (shut down by Stop)
+	std::vector<std::thread> threads_;
+	std::atomic<unsigned long long> requests_{ 0 };
+	std::atomic<unsigned long long> connections_{ 0 };
+	std::atomic<unsigned long long> partials_{ 0 };     // 206 replies
+	std::atomic<unsigned long long> bodyBytes_{ 0 };    // GET body bytes sent
+};
+
+// --------------------------------------------------
+// sync
+// - The loopback server is the only mirror, so every file GET, range resume and the (missing)
+//   pack index go through the shipping WinHTTP code paths.
+// - Each iteration starts from a fresh copy of the install, with no hash index, so the local
+//   check hashes every present file exactly as a first sync would.
+// --------------------------------------------------
+static int BenchSync(const BenchArgs& a)
+{
+	const int latencyMs = (int)BenchArgInt(a, L"--latency-ms", 0, 0, 10000);
+	const int workers = (int)BenchArgInt(a, L"--workers", AppConstants::kDefaultDownloadWorkers, 1, AppConstants::kMaxDownloadWorkers);
+	const int iterations = (int)BenchArgInt(a, L"--iterations", 3, 1, 1000);
+	std::wstring csv, labelW;
+	BenchArgString(a, L"--csv", csv);
+	BenchArgString(a, L"--label", labelW);
+	const std::string label = WideToUtf8(labelW);
+
+	ManifestData md;
+	std::vector<ManifestRawEntry> raw;
+	std::string err;
+	if (!BenchLoadManifest(a.dir, md.manifestText, raw))
+		return 1;
+	if (!ParseAndValidateManifest(md.manifestText, md.workList, md.arena, err)
+		|| !Sha256BytesHexLower(md.manifestText.data(), md.manifestText.size(), md.manifestSha256Lower))
+	{
+		printf("ERROR: %s\n", err.c_str());
+		return 1;
+	}
+
+	BenchHttpServer server;
+	if (!server.Start(a.dir / "remote", latencyMs))
+	{
+		printf("ERROR: cannot listen on 127.0.0.1 (WSA %d)\n", WSAGetLastError());
+		return 1;
+	}
+	const std::string base = server.BaseUrl();
+	{
+		MirrorHost h;
+		h.base = base;
+		std::lock_guard<std::mutex> guard(g_mirrors.lock);
+		g_mirrors.hosts.assign(1, h);
+	}
+	printf("Serving %s at %s (latency %d ms), %d workers\n\n", PathToUtf8(a.dir / "remote").c_str(), base.c_str(), latencyMs, workers);
+
+	SyncConfig cfg;
+	cfg.remoteHost = base;
+	cfg.remoteRootPath = kRemoteRootPath;
+	cfg.manifestUrl = JoinUrl(base, kManifestPath);
+	cfg.localBase = fs::absolute(a.dir / "run");
+	cfg.localSyncRoot = cfg.localBase / "resources_override" / "mappack";
+	cfg.downloadWorkers = workers;
+
+	std::atomic_bool never{ false };
+	CancelToken cancel{ &never };
+	LogCapture capture;
+	t_logCapture = &capture;
+
+	BenchResult r;
+	r.name = "DownloadAndUpdateFiles";
+	r.items = md.workList.size();
+	r.iterations = iterations;
+	double totalMs = 0.0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		std::error_code ec;
+		fs::remove_all(cfg.localBase, ec);
+		fs::copy(a.dir / "install", cfg.localBase, fs::copy_options::recursive, ec);
+		if (ec)
+		{
+			printf("ERROR: cannot copy the install to %s: %s\n", PathToUtf8(cfg.localBase).c_str(), ec.message().c_str());
+			return 1;
+		}
+		{
+			std::lock_guard<std::mutex> guard(capture.lock);
+			capture.text.clear();
+		}
+
+		HashIndex cachedIndex, freshIndex;
+		cachedIndex.rootKey = freshIndex.rootKey = NormalizeExclusionPathForCompare(cfg.localSyncRoot);
+		LocalTreeSnapshot tree;
+		SyncCounters counts;
+		PerfRunBegin();
+		const unsigned long long requestsBefore = server.Requests();
+		const unsigned long long connectionsBefore = server.Connections();
+		const double t0 = BenchNowMs();
+		if (ScanLocalTree(cfg.localBase / "resources_override", tree, cancel))
+			DownloadAndUpdateFiles(cfg, md, md.workList, cachedIndex, freshIndex, tree, counts, cancel);
+		const double ms = BenchNowMs() - t0;
+		totalMs += ms;
+		if (i == 0 || ms < r.bestMs)
+			r.bestMs = ms;
+
+		std::vector<uint32_t> us;
+		{
+			std::lock_guard<std::mutex> guard(g_perf.lock);
+			us = g_perf.requestUs;
+		}
+		double p50 = 0.0;
+		if (!us.empty())
+		{
+			std::nth_element(us.begin(), us.begin() + us.size() / 2, us.end());
+			p50 = us[us.size() / 2] / 1000.0;
+		}
+		r.bytes = g_perf.bytesReceived.load();
+		char extra[256]{};
+		sprintf_s(extra, "downloaded=%zu;updated=%zu;unchanged=%zu;failed=%zu;requests=%llu;connections=%llu;p50_headers_ms=%.2f;hashed_mb=%.1f",
+			counts.downloaded.load(), counts.updated.load(), counts.unchanged.load(), counts.failed.load(),
+			server.Requests() - requestsBefore, server.Connections() - connectionsBefore, p50,
+			(double)g_perf.bytesHashed.load() / (1024.0 * 1024.0));
+		r.extra = extra;
+		printf("  iteration %d: %.1f ms  [%s]\n", i + 1, ms, extra);
+	}
+	r.meanMs = totalMs / iterations;
+	t_logCapture = nullptr;
+	server.Stop();
+
+	{
+		std::lock_guard<std::mutex> guard(capture.lock);
+		(void)BenchWriteFile(a.dir / "bench_sync.log", capture.text);
+	}
+	printf("\n");
+	BenchReport(r, csv, label);
+	return 0;
+}
+
+// --------------------------------------------------
+// resume
+// - Check, not a benchmark (exit code 1 on failure): the first half of the largest remote file is
+//   left as its <sha256>.part with the server's ETag recorded, exactly what an interrupted
+//   download keeps. DownloadUrlToFileVerifySha256 must then fetch only the rest with one ranged
+//   request and produce the verified file.
+// --------------------------------------------------
+static int BenchResume(const BenchArgs& a)
+{
+	std::string manifestText;
+	std::vector<ManifestRawEntry> raw;
+	if (!BenchLoadManifest(a.dir, manifestText, raw))
+		return 1;
+	const ManifestRawEntry* pick = nullptr;
+	for (const auto& e : raw)
+	{
+		if (!pick || e.size > pick->size)
+			pick = &e;
+	}
+	if (!pick || pick->size < 2)
+	{
+		printf("ERROR: no remote file of at least 2 bytes (run \"generate\" with --min-kb 1)\n");
+		return 1;
+	}
+	const fs::path remoteFile = a.dir / "remote" / Utf8ToWide(pick->path);
+	std::string bytes;
+	if (!BenchReadFile(remoteFile, bytes))
+	{
+		printf("ERROR: cannot read %s\n", PathToUtf8(remoteFile).c_str());
+		return 1;
+	}
+
+	BenchHttpServer server;
+	if (!server.Start(a.dir / "remote", 0))
+	{
+		printf("ERROR: cannot listen on 127.0.0.1 (WSA %d)\n", WSAGetLastError());
+		return 1;
+	}
+
+	const fs::path runDir = fs::absolute(a.dir / "resume");
+	const fs::path partialDir = runDir / kPartialDownloadDirName;
+	const fs::path dest = runDir / "out.dat";
+	std::error_code ec;
+	fs::remove_all(runDir, ec);
+	const std::string sha = ToLowerAsciiCopy(pick->sha256);
+	const fs::path part = PartialDownloadPath(partialDir, sha);
+	const size_t kept = bytes.size() / 2;
+	if (!BenchWriteFile(part, bytes.substr(0, kept))
+		|| !WritePartialDownloadValidator(part, BenchHttpServer::EtagOf(remoteFile, bytes.size())))
+	{
+		printf("ERROR: cannot write %s\n", PathToUtf8(part).c_str());
+		return 1;
+	}
+
+	std::atomic_bool never{ false };
+	CancelToken cancel{ &never };
+	LogCapture capture;
+	t_logCapture = &capture;
+	std::string err;
+	long http = 0;
+	const bool ok = DownloadUrlToFileVerifySha256(JoinUrl(server.BaseUrl(), "/" + pick->path), dest, sha, partialDir,
+		(long long)bytes.size(), cancel, &err, &http);
+	t_logCapture = nullptr;
+	server.Stop();
+
+	std::string got;
+	const bool matches = ok && BenchReadFile(dest, got) && got == bytes;
+	const bool resumed = server.PartialResponses() == 1 && server.BodyBytesSent() == bytes.size() - kept;
+	printf("resume %s: kept %zu of %zu bytes, HTTP %ld, 206 replies %llu, body bytes sent %llu\n", pick->path.c_str(),
+		kept, bytes.size(), http, server.PartialResponses(), server.BodyBytesSent());
+	if (!ok)
+		printf("FAIL: download failed: %s\n", err.c_str());
+	else if (!matches)
+		printf("FAIL: the resulting file does not match the remote file\n");
+	else if (!resumed)
+		printf("FAIL: the kept bytes were not resumed (the whole file was downloaded again)\n");
+	else
+		printf("OK\n");
+	return (matches && resumed) ? 0 : 1;
+}
+
+static void BenchUsage()
+{
+	printf("MapPackSyncBench generate <dir> [--files N] [--min-kb K] [--max-kb K] [--dirs D] [--dup-pct P] [--local-pct P] [--stale-pct P] [--seed S]\n");
+	printf("MapPackSyncBench micro <dir> [--iterations N] [--csv <file>] [--label L]\n");
+	printf("MapPackSyncBench sync <dir> [--latency-ms L] [--workers W] [--iterations N] [--csv <file>] [--label L]\n");
+	printf("MapPackSyncBench resume <dir>\n");
+}
+
+int wmain(int argc, wchar_t** argv)
+{
+	if (argc < 3)
+	{
+		BenchUsage();
+		return 2;
+	}
+	BenchArgs a;
+	a.mode = argv[1];
+	a.dir = argv[2];
+	for (int i = 3; i < argc; ++i)
+		a.rest.push_back(argv[i]);
+
+	WSADATA wsa{};
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+	{
+		printf("ERROR: WSAStartup failed\n");
+		return 1;
+	}
+	ScopeExit wsaCleanup{ []() { WSACleanup(); } };
+
+	if (a.mode == L"generate") return BenchGenerate(a);
+	if (a.mode == L"micro") return BenchMicro(a);
+	if (a.mode == L"sync") return BenchSync(a);
+	if (a.mode == L"resume") return BenchResume(a);
+	BenchUsage();
+	return 2;
+}
@@ -3,17 +3,49 @@ MapPackSyncTool (manifest-driven sync)
 High-level behavior
 - User selects an Istaria installation folder (must contain istaria.exe).
 - Tool syncs remote resources_override\mappack\resources content into: <selected>\resources_override\mappack\resources
-- Remote source is described by a JSON manifest (mappack_manifest.json) containing SHA-256 hashes.
+- Remote source is described by a JSON manifest (mappack_manifest.json) containing SHA-256 hashes
+  (and, from newer ManifestSha256 builds, file sizes).
 - For each file:
+	- If the manifest has a size and the local size differs: download without hashing.
 	- If local exists and SHA-256 matches manifest: skip.
-	- Otherwise download to a temp file, hash while downloading, verify SHA-256,
-	  then replace destination.
+	- Otherwise download to a partial file, hash while downloading, verify SHA-256,
+	  then replace destination. Interrupted downloads resume with Range/If-Range.
 Safety invariants
 1) Manifest MUST be downloaded and parsed successfully before any delete occurs.
 2) Downloads are verified against manifest SHA-256 before replacing local files.
 Notes
 - UI remains responsive: sync runs on a worker thread; UI updates use PostMessage.
-- This file is intentionally kept as a single translation unit for easy building.
+- The output box shows only the newest part of the log; the full log is kept as UTF-8 (spilled to
+  a temp file past a few MB) and Copy Log / Save Log stream from that store.
+- Per-file check/download runs on a small bounded worker pool ([Preferences] DownloadWorkers),
+  largest files first; [Preferences] MaxDownloadKBps optionally caps total download bandwidth.
+- Paths with identical content (same sha256) are downloaded once; the rest are filled from the
+  verified local copy (or hard-linked, [Preferences] DedupHardLinks), including matching files
+  already on disk.
+- When ManifestSha256 --pack published mappack_packs/index.json, small missing files are fetched
+  in batches with (multi-)range requests against the pack files and verified one by one; the
+  per-file GET stays the fallback.
+- File downloads can come from mirror hosts ([Preferences] MirrorHosts and/or mappack_mirrors.txt),
+  probed and ranked at startup, with per-request failover. The manifest always comes from
+  kRemoteHost, so integrity stays anchored there.
+- MapPackSyncTool.exe /sync <folder>... [/quiet] [/json-report <file>] syncs several installs
+  without any window: one manifest download, concurrent per-folder syncs, exit code per outcome.
+- On NTFS (elevated), the local tree comes from the snapshot saved by the last clean sync plus the
+  folders the USN change journal reports as changed; otherwise the install is scanned.
+- Between full passes ([Preferences] FullVerifyDays, ForceFullVerify) a sync only checks the
+  entries whose sha256 differs from the last manifest applied to that install (per-root hash index).
+- The startup manifest check keeps the parsed manifest for the next Sync (while the published
+  sha256 still matches) and, when it changed, prefetches the changed files for the last used
+  folder at background priority ([Preferences] BackgroundPrefetch).
+- The MapPack 4.0 clean-up is skipped for an install once a pass left nothing to do, while the
+  published mappack_manifest_old.sha256 still matches the manifest that pass used.
+- When a delta chain is published, the manifest is rebuilt from the last applied copy and
+  verified against mappack_manifest.sha256; otherwise the full manifest is downloaded.
+- [Preferences] PerfSummary logs per-phase timings, bytes hashed/downloaded, HTTP latency
+  percentiles and connection reuse after Sync/Remove; the same data is emitted as TraceLogging
+  events (provider "MapPackSyncTool") for WPR/WPA.
+- This file is intentionally kept as a single translation unit for easy building; SHA-256
+  comes from the Sha256Lib static library (project reference in MapPackSyncTool.sln).
 */
 
 // We will update version numbers in the .rc file. Version numbers are no longer hard-coded in this file.
@@ -27,6 +59,7 @@ Notes
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <winver.h>
+#include <winioctl.h>  // FSCTL_*_USN_JOURNAL
 #pragma comment(lib, "Version.lib")
 #include <wincrypt.h>
 #include <softpub.h>
@@ -34,8 +67,6 @@ Notes
 #include <tlhelp32.h>
 #include <cwchar>
 #include <cwctype>
-#include <bcrypt.h>
-#pragma comment(lib, "bcrypt.lib")
 #include <shlobj.h>
 #include <shellapi.h>
 #include <richedit.h>
@@ -50,13 +81,23 @@ Notes
 #include <string>
 #include <string_view>
 #include <vector>
+#include <map>
 #include <unordered_set>
+#include <unordered_map>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <cstring>     // memcpy
 #include <cstdint>
 #include <functional>  // std::function
 #include <memory>      // std::unique_ptr
+#include <winsock2.h>  // SOCKADDR_STORAGE (WINHTTP_CONNECTION_INFO)
 #include <winhttp.h>
+// EventSetInformation is Win8+; 2 = look it up at runtime so the exe still loads on Vista/7.
+#define TLG_HAVE_EVENT_SET_INFORMATION 2
+#include <TraceLoggingProvider.h>
+#include "../Sha256Lib/Sha256.h"
 
 // ------------------------------------------------------------
 // Version helper: read FileVersion from VERSIONINFO resource
@@ -163,6 +204,55 @@ namespace AppConstants
 	static constexpr unsigned long long kMaxSyncedFileDownloadBytes = 512ull * 1024ull * 1024ull;  // individual manifest files -512MB max
 	static constexpr unsigned long long kMaxUpdateExeDownloadBytes = 10ull * 1024ull * 1024ull;    // application update EXE - 10MB max
 
+	// Parallel sync downloads. Most MapPack files are small, so a fresh install is bound by
+	// request round-trips rather than bandwidth; a few concurrent workers hide that latency.
+	// Overridable via [Preferences] DownloadWorkers in the INI (clamped to 1..kMaxDownloadWorkers).
+	static constexpr int kDefaultDownloadWorkers = 6;
+	static constexpr int kMaxDownloadWorkers = 16;
+	static constexpr int kMaxSyncPoolWorkers = 16;   // hash + download pool threads (hashing scales with cores)
+
+	// Optional global download cap, [Preferences] MaxDownloadKBps in the INI (0 = unlimited).
+	static constexpr int kMaxDownloadKBpsLimit = 1000000;
+
+	// Incremental sync: only manifest entries that changed since the last applied manifest are
+	// checked, with a full pass at least every [Preferences] FullVerifyDays (0 = every sync).
+	static constexpr int kDefaultFullVerifyDays = 7;
+	static constexpr int kMaxFullVerifyDays = 365;
+
+	// Download I/O: each pool thread reuses kDownloadPipelineDepth page-aligned chunks, so the
+	// network read of one chunk overlaps the disk write of the previous ones.
+	static constexpr DWORD kDownloadChunkBytes = 256u * 1024u;
+	static constexpr int kDownloadPipelineDepth = 4;
+
+	// Remove/Uninstall: parallel deletes (metadata-bound, so a few more than the download width).
+	static constexpr int kRemoveWorkers = 8;
+
+	// Change journal replay reads at most this many journal bytes (USNs are byte offsets) before a
+	// full scan is cheaper; records come in kUsnReadBufferBytes batches.
+	static constexpr unsigned long long kMaxUsnReplayBytes = 64ull * 1024ull * 1024ull;
+	static constexpr DWORD kUsnReadBufferBytes = 64u * 1024u;
+
+	// Startup manifest check: Sync reuses its parsed manifest for this long (if the published
+	// sha256 still matches). A new manifest prefetches at most kMaxPrefetchBytes of changed files.
+	static constexpr ULONGLONG kStartupManifestMaxAgeMs = 60ull * 60ull * 1000ull;
+	static constexpr unsigned long long kMaxPrefetchBytes = 256ull * 1024ull * 1024ull;
+
+	// Log store: UTF-8 kept in memory before spilling to a temp file, and the read-back chunk.
+	// The output box shows at most kOutputViewMaxChars and trims back to kOutputViewKeepChars.
+	static constexpr size_t kLogStoreMemoryBytes = 4u * 1024u * 1024u;
+	static constexpr DWORD kLogStoreReadChunkBytes = 1u * 1024u * 1024u;
+	static constexpr LONG kOutputViewMaxChars = 1024 * 1024;
+	static constexpr LONG kOutputViewKeepChars = 768 * 1024;
+
+	// Manifest deltas: longer chains than this are not worth walking; fetch the full manifest instead.
+	static constexpr int kMaxManifestDeltaChain = 32;
+
+	// Pack bundles: blobs closer than the gap share one byte range (the unused bytes are cheaper
+	// than another range); one request carries at most this many ranges and bytes.
+	static constexpr unsigned long long kPackRangeGapBytes = 64ull * 1024ull;
+	static constexpr unsigned long long kPackMaxRequestBytes = 8ull * 1024ull * 1024ull;
+	static constexpr size_t kPackMaxRangesPerRequest = 64;
+
 	// We are defining this twice because WinHttp expects wide
 	static constexpr const char* kUserAgent = "MapPackSyncTool by Cegaiel";
 	static constexpr const wchar_t* kUserAgentW = L"MapPackSyncTool by Cegaiel";
@@ -177,6 +267,12 @@ static constexpr const char* kRemoteHost = "https://istaria-mappack.s3.us-west-2
 static constexpr const char* kRemoteRootPath = "/resources_override/";
 static constexpr const char* kManifestPath = "/mappack_manifest.json";
 static constexpr const char* kManifestOldPath = "/mappack_manifest_old.json";
+static constexpr const char* kManifestHeadPath = "/mappack_manifest.sha256";          // SHA-256 of the current mappack_manifest.json
+static constexpr const char* kManifestOldHeadPath = "/mappack_manifest_old.sha256";   // SHA-256 of mappack_manifest_old.json
+static constexpr const char* kManifestDeltaDirPath = "/mappack_manifest_deltas/";     // <fromSha256>.json, written by ManifestSha256 --delta
+static constexpr const char* kPackDirPath = "/mappack_packs/";                         // <sha256>.pack bundles, written by ManifestSha256 --pack
+static constexpr const char* kPackIndexPath = "/mappack_packs/index.json";             // blob sha256 -> pack, offset, size
+static constexpr const char* kMirrorListPath = "/mappack_mirrors.txt";                  // optional: one mirror base URL per line
 static constexpr const wchar_t* kUpdateExeUrl = L"https://istaria-mappack.s3.us-west-2.amazonaws.com/MapPackSyncTool.exe";
 static constexpr const wchar_t* kUpdateVersionUrl = L"https://istaria-mappack.s3.us-west-2.amazonaws.com/version.txt";
 static constexpr const wchar_t* kMainExeFileName = L"MapPackSyncTool.exe";
@@ -270,6 +366,17 @@ struct unique_heap_wstr
 	wchar_t* release() { wchar_t* tmp = p; p = nullptr; return tmp; }
 	explicit operator bool() const { return p != nullptr; }
 };
+struct unique_hfind
+{
+	HANDLE h = INVALID_HANDLE_VALUE;
+	unique_hfind() = default;
+	explicit unique_hfind(HANDLE handle) : h(handle) {}
+	unique_hfind(const unique_hfind&) = delete;
+	unique_hfind& operator=(const unique_hfind&) = delete;
+	~unique_hfind() { if (h != INVALID_HANDLE_VALUE) FindClose(h); }
+	HANDLE get() const { return h; }
+	explicit operator bool() const { return h != INVALID_HANDLE_VALUE; }
+};
 
 // --------------------------------------------------
 // Main window state (UI handles + worker-thread coordination)
@@ -281,6 +388,7 @@ enum class WorkerKind
 	Remove,
 };
 
+struct ManifestData;
 struct AppState
 {
 	HWND hMainWnd = nullptr;
@@ -321,6 +429,14 @@ struct AppState
 	std::atomic_bool isUpdateRunning{ false };
 	HANDLE hManifestCheckThread = nullptr;
 	std::atomic_bool isManifestCheckRunning{ false };
+	// Manifest downloaded by the startup check, reused by Sync while it is current (TakeStartupManifest).
+	std::mutex startupManifestLock;                       // guards the fields below
+	std::shared_ptr<const ManifestData> startupManifest;
+	ULONGLONG startupManifestTick = 0;
+	HANDLE hPrefetchThread = nullptr;                     // background prefetch; see StopBackgroundPrefetch
+	std::atomic_bool prefetchCancel{ false };
+	HANDLE hMirrorProbeThread = nullptr;                  // startup mirror probe; UI thread only, see StopMirrorProbe
+	std::atomic_bool mirrorProbeCancel{ false };
 	bool logActionsArmed = false;
 };
 static AppState* g_state = nullptr;
@@ -347,6 +463,7 @@ static bool GetApplicationDirectory(fs::path& outAppDir, std::wstring* outErr);
 static void TrimInPlace(std::wstring& s);
 static void StripSurroundingQuotes(std::wstring& s);
 static std::wstring Utf8ToWide(const std::string& s);
+static std::string WideToUtf8(const std::wstring& ws);
 static bool TryUtf8ToWideStrict(const char* data, size_t size, std::wstring& out);
 static bool RelaunchSelfElevated(HWND owner, const std::wstring& parameters);
 static bool IsCurrentProcessElevated();
@@ -355,8 +472,11 @@ static void ReleaseSingleInstanceMutex();
 static void ShowAboutSystemInfoDialog(HWND owner);
 static void ShowPreferencesDialog(HWND owner);
 static void ShowExclusionsDialog(HWND owner);
-static bool IsPathExcluded(const fs::path& path);
-static bool IsExcludedOrContainsExcludedPath(const fs::path& dir);
+static void StopBackgroundPrefetch(AppState* st);
+static void StopMirrorProbe(AppState* st);
+struct ExclusionMatcher;
+static bool IsPathExcluded(const ExclusionMatcher& exclusions, const fs::path& path);
+static bool IsExcludedOrContainsExcludedPath(const ExclusionMatcher& exclusions, const fs::path& dir);
 
 // --------------------------------------------------
 // Settings persistence (portable INI next to EXE)
@@ -373,6 +493,19 @@ static const wchar_t* kIniKeyManifestSha256 = L"LastSyncedManifestSha256";
 static const wchar_t* kIniSectionPreferences = L"Preferences";
 static const wchar_t* kIniKeyExclusionCount = L"ExclusionCount";
 static const wchar_t* kIniKeyExclusionPrefix = L"Exclusion";
+static const wchar_t* kIniKeyDownloadWorkers = L"DownloadWorkers";
+static const wchar_t* kIniKeyForceFullVerify = L"ForceFullVerify";
+static const wchar_t* kIniKeyFullVerifyDays = L"FullVerifyDays";
+static const wchar_t* kIniKeyMaxDownloadKBps = L"MaxDownloadKBps";
+static const wchar_t* kIniKeyDedupHardLinks = L"DedupHardLinks";
+static const wchar_t* kIniKeyMirrorHosts = L"MirrorHosts";
+static const wchar_t* kIniKeyPerfSummary = L"PerfSummary";
+static const wchar_t* kIniKeyBackgroundPrefetch = L"BackgroundPrefetch";
+static const wchar_t* kHashIndexFileName = L"MapPackSyncTool.hashindex";   // legacy single-root name; see GetHashIndexPath()
+static const wchar_t* kHttpCacheDirName = L"MapPackSyncTool_cache";
+static const wchar_t* kPartialDownloadDirName = L"MapPackSyncTool_partial";   // under the install folder
+static const wchar_t* kManifestCacheFileName = L"MapPackSyncTool.manifest.json";   // last applied manifest (delta base)
+static const wchar_t* kMirrorListCacheFileName = L"MapPackSyncTool.mirrors.txt";   // last fetched mappack_mirrors.txt
 // Should I ever come out with new Terms of Use, then increment below line by one number.
 // This will show user latest terms and force them to Accept the latest terms of use again; Hence updating [License] TermsVersion in the .ini file.
 static constexpr int kCurrentTermsVersion = 1;
@@ -655,6 +788,85 @@ static bool IniWriteLastSyncedManifestInfo(const std::string& sha256Lower, std::
 	return true;
 }
 
+static int IniReadDownloadWorkers()
+{
+	const std::wstring iniPath = GetSettingsIniPath();
+	int n = (int)GetPrivateProfileIntW(kIniSectionPreferences, kIniKeyDownloadWorkers, AppConstants::kDefaultDownloadWorkers, iniPath.c_str());
+	if (n < 1) n = 1;
+	if (n > AppConstants::kMaxDownloadWorkers) n = AppConstants::kMaxDownloadWorkers;
+	return n;
+}
+
+static int IniReadMaxDownloadKBps()
+{
+	const std::wstring iniPath = GetSettingsIniPath();
+	int n = (int)GetPrivateProfileIntW(kIniSectionPreferences, kIniKeyMaxDownloadKBps, 0, iniPath.c_str());
+	if (n < 0) n = 0;
+	if (n > AppConstants::kMaxDownloadKBpsLimit) n = AppConstants::kMaxDownloadKBpsLimit;
+	return n;
+}
+
+static bool IniReadForceFullVerify()
+{
+	const std::wstring iniPath = GetSettingsIniPath();
+	return GetPrivateProfileIntW(kIniSectionPreferences, kIniKeyForceFullVerify, 0, iniPath.c_str()) != 0;
+}
+
+static bool IniWriteForceFullVerify(bool enabled, std::wstring* outErr = nullptr)
+{
+	return IniWriteStringVerified(kIniSectionPreferences, kIniKeyForceFullVerify, enabled ? L"1" : L"0", outErr);
+}
+
+static int IniReadFullVerifyDays()
+{
+	const std::wstring iniPath = GetSettingsIniPath();
+	int n = (int)GetPrivateProfileIntW(kIniSectionPreferences, kIniKeyFullVerifyDays, AppConstants::kDefaultFullVerifyDays, iniPath.c_str());
+	if (n < 0) n = 0;
+	if (n > AppConstants::kMaxFullVerifyDays) n = AppConstants::kMaxFullVerifyDays;
+	return n;
+}
+
+static bool IniReadDedupHardLinks()
+{
+	const std::wstring iniPath = GetSettingsIniPath();
+	return GetPrivateProfileIntW(kIniSectionPreferences, kIniKeyDedupHardLinks, 0, iniPath.c_str()) != 0;
+}
+
+static bool IniWriteDedupHardLinks(bool enabled, std::wstring* outErr = nullptr)
+{
+	return IniWriteStringVerified(kIniSectionPreferences, kIniKeyDedupHardLinks, enabled ? L"1" : L"0", outErr);
+}
+
+static bool IniReadPerfSummary()
+{
+	const std::wstring iniPath = GetSettingsIniPath();
+	return GetPrivateProfileIntW(kIniSectionPreferences, kIniKeyPerfSummary, 0, iniPath.c_str()) != 0;
+}
+
+static bool IniWritePerfSummary(bool enabled, std::wstring* outErr = nullptr)
+{
+	return IniWriteStringVerified(kIniSectionPreferences, kIniKeyPerfSummary, enabled ? L"1" : L"0", outErr);
+}
+
+static bool IniReadBackgroundPrefetch()
+{
+	const std::wstring iniPath = GetSettingsIniPath();
+	return GetPrivateProfileIntW(kIniSectionPreferences, kIniKeyBackgroundPrefetch, 1, iniPath.c_str()) != 0;
+}
+
+static bool IniWriteBackgroundPrefetch(bool enabled, std::wstring* outErr = nullptr)
+{
+	return IniWriteStringVerified(kIniSectionPreferences, kIniKeyBackgroundPrefetch, enabled ? L"1" : L"0", outErr);
+}
+
+// Comma separated mirror base URLs; see the Mirror hosts section.
+static std::wstring IniReadMirrorHosts()
+{
+	wchar_t buf[4096]{};
+	const std::wstring iniPath = GetSettingsIniPath();
+	GetPrivateProfileStringW(kIniSectionPreferences, kIniKeyMirrorHosts, L"", buf, (DWORD)_countof(buf), iniPath.c_str());
+	return std::wstring(buf);
+}
 
 static std::wstring NormalizeExclusionPathForCompare(const fs::path& input)
 {
@@ -754,54 +966,108 @@ static bool IniWriteExclusions(const std::vector<fs::path>& paths, std::wstring*
 	return true;
 }
 
-static bool IsPathEqualOrChildOf(const std::wstring& child, const std::wstring& parent)
+// --------------------------------------------------
+// Exclusion matcher
+// - Built once per run from the INI list (each exclusion normalized once), then shared by
+//   every phase through SyncConfig instead of re-reading the INI for every path.
+// - Path-component trie over the normalized (lowercase, canonical) exclusions, so a lookup
+//   walks the target's components once: O(path length), independent of the exclusion count.
+// - With no exclusions (the common case) lookups return immediately without normalizing.
+// - An entry matches itself and everything below it, whatever its level: an excluded folder
+//   keeps its whole subtree, and a drive or share root ("C:\") keeps everything on it. The
+//   Exclusions dialog states this next to the list.
+// --------------------------------------------------
+struct ExclusionMatcher
 {
-	if (child.empty() || parent.empty())
-		return false;
-	if (child == parent)
-		return true;
-	if (child.size() <= parent.size())
-		return false;
-	if (child.compare(0, parent.size(), parent) != 0)
-		return false;
-	const wchar_t next = child[parent.size()];
-	return next == L'\\' || next == L'/';
-}
+	struct Node
+	{
+		std::unordered_map<std::wstring, size_t> children;   // component -> node index
+		bool terminal = false;                               // an exclusion ends here
+	};
+	std::vector<Node> nodes;   // nodes[0] is the root once anything was added
 
-static bool IsPathExcluded(const fs::path& path)
-{
-	const std::wstring target = NormalizeExclusionPathForCompare(path);
-	if (target.empty())
-		return false;
+	bool Empty() const { return nodes.size() <= 1; }
 
-	const std::vector<fs::path> exclusions = IniReadExclusions();
-	for (const fs::path& ex : exclusions)
+	template <typename Fn>
+	static void ForEachComponent(const std::wstring& s, Fn&& fn)
 	{
-		const std::wstring cmp = NormalizeExclusionPathForCompare(ex);
-		if (cmp.empty())
-			continue;
-		if (IsPathEqualOrChildOf(target, cmp))
+		size_t start = 0;
+		while (start <= s.size())
+		{
+			size_t end = s.find_first_of(L"\\/", start);
+			if (end == std::wstring::npos) end = s.size();
+			if (end > start && !fn(s.substr(start, end - start)))
+				return;
+			start = end + 1;
+		}
+	}
+	void Add(const std::wstring& normalized)
+	{
+		if (normalized.empty()) return;
+		if (nodes.empty()) nodes.emplace_back();
+		size_t cur = 0;
+		ForEachComponent(normalized, [&](std::wstring&& comp) {
+			auto it = nodes[cur].children.find(comp);
+			if (it != nodes[cur].children.end())
+			{
+				cur = it->second;
+				return true;
+			}
+			const size_t next = nodes.size();
+			nodes[cur].children.emplace(std::move(comp), next);
+			nodes.emplace_back();
+			cur = next;
+			return true;
+		});
+		if (cur != 0) nodes[cur].terminal = true;
+	}
+	// Walks the normalized target. Returns true as soon as an exclusion equals the target or
+	// one of its ancestors. outReachedEnd = every component matched, i.e. at least one
+	// exclusion lies at or below the target (every trie node leads to a terminal).
+	bool Walk(const std::wstring& target, bool& outReachedEnd) const
+	{
+		outReachedEnd = false;
+		if (Empty() || target.empty()) return false;
+		size_t cur = 0;
+		bool hit = false;
+		bool fellOff = false;
+		ForEachComponent(target, [&](std::wstring&& comp) {
+			auto it = nodes[cur].children.find(comp);
+			if (it == nodes[cur].children.end()) { fellOff = true; return false; }
+			cur = it->second;
+			if (nodes[cur].terminal) { hit = true; return false; }
 			return true;
+		});
+		outReachedEnd = !hit && !fellOff && cur != 0;
+		return hit;
 	}
-	return false;
+};
+
+static ExclusionMatcher LoadExclusionMatcher()
+{
+	ExclusionMatcher m;
+	for (const fs::path& ex : IniReadExclusions())
+		m.Add(NormalizeExclusionPathForCompare(ex));
+	return m;
 }
 
-static bool IsExcludedOrContainsExcludedPath(const fs::path& dir)
+static bool IsPathExcluded(const ExclusionMatcher& exclusions, const fs::path& path)
 {
-	const std::wstring target = NormalizeExclusionPathForCompare(dir);
-	if (target.empty())
+	if (exclusions.Empty())
 		return false;
+	const std::wstring target = NormalizeExclusionPathForCompare(path);
+	bool reachedEnd = false;
+	return exclusions.Walk(target, reachedEnd);
+}
 
-	const std::vector<fs::path> exclusions = IniReadExclusions();
-	for (const fs::path& ex : exclusions)
-	{
-		const std::wstring cmp = NormalizeExclusionPathForCompare(ex);
-		if (cmp.empty())
-			continue;
-		if (IsPathEqualOrChildOf(target, cmp) || IsPathEqualOrChildOf(cmp, target))
-			return true;
-	}
-	return false;
+// Directory is excluded itself, or some exclusion lives inside it (so it must be kept).
+static bool IsExcludedOrContainsExcludedPath(const ExclusionMatcher& exclusions, const fs::path& dir)
+{
+	if (exclusions.Empty())
+		return false;
+	const std::wstring target = NormalizeExclusionPathForCompare(dir);
+	bool reachedEnd = false;
+	return exclusions.Walk(target, reachedEnd) || reachedEnd;
 }
 
 
@@ -944,12 +1210,13 @@ static constexpr UINT WM_APP_UI_EVENT = WM_APP + 2;
 
 enum class UiEventKind : int
 {
-	LogAppendW = 1,
+	LogAppendW = 1,     // wake-up only; the text is queued in g_logQueue
 	ProgressMarqueeOn,
 	ProgressMarqueeOff,
 	ProgressInit,       // u1 = total
 	ProgressSet,        // u1 = pos
 	ProgressTextW,      // text = progress label
+	ProgressPollStart,  // start polling g_progress on the UI refresh timer
 	WorkerDone,
 	UpdateResultPtr,    // ptr = UpdateResult*
 	ManifestCheckResultPtr // ptr = ManifestCheckResult*
@@ -1002,6 +1269,154 @@ static bool PostUiText(UiEventKind kind, std::wstring text)
 	return PostUiEvent(ev);
 }
 // --------------------------------------------------
+// Log queue (worker threads -> UI thread)
+// - Log() appends to one pending buffer. Only the first line after a drain posts a
+//   LogAppendW wake-up, so a burst of thousands of lines costs a handful of messages.
+// - The UI thread drains the whole buffer with a single RichEdit append, at most once per
+//   kLogFlushIntervalMs (sooner when kLogFlushMaxChars is already pending).
+// - Every other UI event, and reading/clearing the output, drains first, so log lines keep
+//   their exact order relative to progress updates, worker-done and Copy/Save.
+// - A wake-up that cannot be posted (queue full, window going away) is drained on the spot when
+//   Log() runs on the UI thread, else retried for up to kLogWakeRetries x kLogWakeRetryMs; past
+//   that the next Log() tries again and WM_DESTROY drains whatever is still queued.
+// --------------------------------------------------
+struct LogQueue
+{
+	std::mutex lock;
+	std::wstring pending;
+	bool wakePosted = false;       // a LogAppendW event or flush timer is outstanding
+	ULONGLONG lastFlushTick = 0;   // UI thread only
+};
+static LogQueue g_logQueue;
+// Headless batch (/sync): each install folder logs into its own capture instead of the queue.
+// Set per thread; the download pool and pack fetch threads take over their creator's.
+struct LogCapture
+{
+	std::mutex lock;
+	std::string text;   // UTF-8, in Log() order
+};
+static thread_local LogCapture* t_logCapture = nullptr;
+static constexpr UINT_PTR kLogFlushTimerId = 0x4C47;   // 'LG'
+static constexpr ULONGLONG kLogFlushIntervalMs = 50;
+static constexpr size_t kLogFlushMaxChars = 256 * 1024;
+static constexpr int kLogWakeRetries = 20;
+static constexpr DWORD kLogWakeRetryMs = 5;
+static void FlushPendingLog(AppState* st);
+// --------------------------------------------------
+// Log store (UI thread)
+// - The full text of the output box, kept as UTF-8 rather than in the RichEdit. Once the
+//   in-memory part reaches kLogStoreMemoryBytes it is appended to a delete-on-close temp file,
+//   so a long verbose sync keeps at most that much log in RAM.
+// - The RichEdit is only a view of the newest kOutputViewMaxChars: OutputAppendTextW drops the
+//   oldest lines from the top, so appending and scrolling cost the same at any log length.
+// - Copy Log / Save Log stream the whole log from here (LogStoreForEachChunk).
+// --------------------------------------------------
+struct LogStore
+{
+	std::string tail;                     // UTF-8 after the spilled part
+	unique_handle spill;                  // temp file holding the first spilledBytes
+	unsigned long long spilledBytes = 0;
+	bool spillUnavailable = false;        // temp file could not be created; stay in memory
+};
+static LogStore g_logStore;
+
+static void LogStoreClear()
+{
+	g_logStore.spill.reset();
+	g_logStore.spilledBytes = 0;
+	g_logStore.spillUnavailable = false;
+	std::string().swap(g_logStore.tail);
+}
+static bool LogStoreEmpty()
+{
+	return g_logStore.spilledBytes == 0 && g_logStore.tail.empty();
+}
+// Moves the in-memory part to the temp file. On any failure the text just stays in memory.
+static void LogStoreSpill()
+{
+	LogStore& s = g_logStore;
+	if (s.spillUnavailable)
+		return;
+	if (!s.spill)
+	{
+		wchar_t dir[MAX_PATH + 1]{};
+		wchar_t name[MAX_PATH + 1]{};
+		if (!GetTempPathW((DWORD)_countof(dir), dir) || !GetTempFileNameW(dir, L"mps", 0, name))
+		{
+			s.spillUnavailable = true;
+			return;
+		}
+		s.spill.reset(CreateFileW(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr));
+		if (!s.spill)
+		{
+			DeleteFileW(name);
+			s.spill.reset();
+			s.spillUnavailable = true;
+			return;
+		}
+	}
+	OVERLAPPED ov{};
+	ov.Offset = (DWORD)(s.spilledBytes & 0xFFFFFFFFull);
+	ov.OffsetHigh = (DWORD)(s.spilledBytes >> 32);
+	DWORD written = 0;
+	if (!WriteFile(s.spill.get(), s.tail.data(), (DWORD)s.tail.size(), &written, &ov) || written != s.tail.size())
+		return;   // a short write is overwritten by the next attempt at the same offset
+	s.spilledBytes += written;
+	s.tail.clear();
+}
+static void LogStoreAppend(std::wstring_view text)
+{
+	if (text.empty()) return;
+	g_logStore.tail += WideToUtf8(std::wstring(text));
+	if (g_logStore.tail.size() >= AppConstants::kLogStoreMemoryBytes)
+		LogStoreSpill();
+}
+// Length of the longest prefix that does not end inside a UTF-8 sequence.
+static size_t Utf8CompletePrefixLength(const char* data, size_t size)
+{
+	size_t lead = size;
+	while (lead > 0 && size - lead < 3 && ((unsigned char)data[lead - 1] & 0xC0) == 0x80)
+		--lead;
+	if (lead == 0)
+		return size;
+	const unsigned char c = (unsigned char)data[lead - 1];
+	const size_t need = (c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : (c >= 0xC0) ? 2 : 1;
+	return (size - (lead - 1) >= need) ? size : lead - 1;
+}
+// Calls fn(data, size) over the whole log in order, in chunks that end on a UTF-8 character
+// boundary. False if fn stops early or the temp file cannot be read back.
+static bool LogStoreForEachChunk(const std::function<bool(const char*, size_t)>& fn)
+{
+	const LogStore& s = g_logStore;
+	if (s.spilledBytes > 0)
+	{
+		std::vector<char> buf((size_t)AppConstants::kLogStoreReadChunkBytes + 4);
+		size_t carry = 0;
+		unsigned long long offset = 0;
+		while (offset < s.spilledBytes)
+		{
+			const DWORD want = (DWORD)(std::min)((unsigned long long)AppConstants::kLogStoreReadChunkBytes, s.spilledBytes - offset);
+			OVERLAPPED ov{};
+			ov.Offset = (DWORD)(offset & 0xFFFFFFFFull);
+			ov.OffsetHigh = (DWORD)(offset >> 32);
+			DWORD got = 0;
+			if (!ReadFile(s.spill.get(), buf.data() + carry, want, &got, &ov) || got != want)
+				return false;
+			offset += got;
+			const size_t have = carry + got;
+			const size_t cut = Utf8CompletePrefixLength(buf.data(), have);
+			if (cut > 0 && !fn(buf.data(), cut))
+				return false;
+			carry = have - cut;
+			memmove(buf.data(), buf.data() + cut, carry);
+		}
+		if (carry > 0 && !fn(buf.data(), carry))
+			return false;
+	}
+	return s.tail.empty() || fn(s.tail.data(), s.tail.size());
+}
+// --------------------------------------------------
 // PROGRESS BAR (FIXED: dynamic marquee style toggle)
 // --------------------------------------------------
 // ============================================================
@@ -1030,9 +1445,8 @@ namespace helpers
 	static void SetProgressVisible(AppState* st, bool visible);
 	static void SetStatusText(AppState* st, std::wstring_view text);
 
-	static std::wstring GetOutputTextW_Impl(AppState* st);
-	static std::wstring GetOutputTextW(AppState* st);
-	static std::wstring GetOutputTextW();
+	static bool IsOutputLogEmpty(AppState* st);
+	static bool ForEachOutputLogChunk(AppState* st, const std::function<bool(const char*, size_t)>& fn);
 
 	static void OutputAppendTextW(AppState* st, std::wstring_view text);
 	static void OutputSetTextW(AppState* st, std::wstring_view text, bool scrollTop);
@@ -1140,31 +1554,49 @@ namespace helpers
 	// --------------------------------------------------
 	// UI output helpers (main thread)
 	// --------------------------------------------------
-	static std::wstring GetOutputTextW_Impl(AppState* st)
+	// Copy/Save read the log store, not the (trimmed) RichEdit; both drain lines still queued
+	// by workers first.
+	static bool IsOutputLogEmpty(AppState* st)
 	{
-		if (!st || !st->hOutput) return L"";
-		const int len = GetWindowTextLengthW(st->hOutput);
-		if (len <= 0) return L"";
-
-		std::wstring buf;
-		buf.resize((size_t)len);
-		GetWindowTextW(st->hOutput, buf.data(), len + 1);
-		return buf;
+		FlushPendingLog(st);
+		return LogStoreEmpty();
 	}
 
-	// Back-compat wrapper used by existing call sites.
-	static std::wstring GetOutputTextW(AppState* st)
+	static bool ForEachOutputLogChunk(AppState* st, const std::function<bool(const char*, size_t)>& fn)
 	{
-		return GetOutputTextW_Impl(st);
+		FlushPendingLog(st);
+		return LogStoreForEachChunk(fn);
 	}
 
-	static std::wstring GetOutputTextW()
+	static const wchar_t* const kOutputViewTrimmedNote =
+		L"[Older lines are not shown here to keep the log responsive. Copy Log and Save Log include the full log.]\r\n";
+
+	// Once the view passes kOutputViewMaxChars, whole lines are dropped from the top back to
+	// kOutputViewKeepChars and a one-line note takes their place (replaced on every trim).
+	static void TrimOutputView(AppState* st)
 	{
-		return GetOutputTextW_Impl(g_state);
+		GETTEXTLENGTHEX gtl{ GTL_NUMCHARS | GTL_PRECISE, 1200 };
+		const LONG len = (LONG)SendMessageW(st->hOutput, EM_GETTEXTLENGTHEX, (WPARAM)&gtl, 0);
+		if (len <= AppConstants::kOutputViewMaxChars)
+			return;
+		const LONG cut = len - AppConstants::kOutputViewKeepChars;
+		const LONG cutLine = (LONG)SendMessageW(st->hOutput, EM_EXLINEFROMCHAR, 0, (LPARAM)cut);
+		LONG cutEnd = (LONG)SendMessageW(st->hOutput, EM_LINEINDEX, (WPARAM)(cutLine + 1), 0);
+		if (cutEnd <= 0)
+			cutEnd = cut;   // one huge line: cut mid-line rather than not at all
+
+		SendMessageW(st->hOutput, WM_SETREDRAW, FALSE, 0);
+		CHARRANGE cr{ 0, cutEnd };
+		SendMessageW(st->hOutput, EM_EXSETSEL, 0, (LPARAM)&cr);
+		SendMessageW(st->hOutput, EM_REPLACESEL, FALSE, (LPARAM)kOutputViewTrimmedNote);
+		const LONG end = (LONG)SendMessageW(st->hOutput, EM_GETTEXTLENGTHEX, (WPARAM)&gtl, 0);
+		cr = { end, end };
+		SendMessageW(st->hOutput, EM_EXSETSEL, 0, (LPARAM)&cr);
+		SendMessageW(st->hOutput, WM_SETREDRAW, TRUE, 0);
+		InvalidateRect(st->hOutput, nullptr, TRUE);
+		SendMessageW(st->hOutput, EM_SCROLLCARET, 0, 0);
 	}
 
-
-
 	static void OutputAppendTextW(AppState* st, std::wstring_view text)
 	{
 		AssertUiThread(st);
@@ -1172,12 +1604,15 @@ namespace helpers
 		if (!st || !st->hOutput) return;
 		if (text.empty()) return;
 
+		LogStoreAppend(text);
+
 		const LRESULT len = SendMessageW(st->hOutput, WM_GETTEXTLENGTH, 0, 0);
 		SendMessageW(st->hOutput, EM_SETSEL, (WPARAM)len, (LPARAM)len);
 
 		std::wstring tmp(text);
 		SendMessageW(st->hOutput, EM_REPLACESEL, FALSE, (LPARAM)tmp.c_str());
 		SendMessageW(st->hOutput, EM_SCROLLCARET, 0, 0);
+		TrimOutputView(st);
 
 		UpdateLogActionButtonsEnabled(st);
 	}
@@ -1196,6 +1631,8 @@ namespace helpers
 
 		if (!st || !st->hOutput) return;
 
+		LogStoreClear();
+		LogStoreAppend(text);
 		SetTextCtl(st->hOutput, text);
 
 		if (scrollTop)
@@ -1463,6 +1900,7 @@ namespace helpers
 
 	static void ClearOutput(AppState* st)
 	{
+		FlushPendingLog(st);   // lines logged before the clear must not reappear after it
 		OutputSetTextW(st, L"", false);
 	}
 	static void ClearOutput()
@@ -1585,16 +2023,25 @@ namespace helpers
 		AssertUiThread(st);
 		if (!st || !st->hMainWnd) return UiFail(0, L"Internal error: window handle is missing.");
 
-		std::wstring textW = GetOutputTextW(st);
-		if (textW.empty())
+		if (IsOutputLogEmpty(st))
 			return UiFail(0, L"Log is empty. Nothing to Copy!");
 
+		// Two passes over the log store: size the clipboard block, then convert straight into it.
+		size_t wideChars = 0;
+		const bool sized = ForEachOutputLogChunk(st, [&wideChars](const char* data, size_t size) {
+			const int n = MultiByteToWideChar(CP_UTF8, 0, data, (int)size, nullptr, 0);
+			wideChars += (n > 0) ? (size_t)n : 0;
+			return true;
+		});
+		if (!sized)
+			return UiFail(GetLastError(), L"Failed to read the log.");
+
 		if (!OpenClipboard(st->hMainWnd))
 			return UiFail(GetLastError(), L"Failed to open the clipboard.");
 
 		EmptyClipboard();
 
-		const size_t bytes = (textW.size() + 1) * sizeof(wchar_t);
+		const size_t bytes = (wideChars + 1) * sizeof(wchar_t);
 		HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, bytes);
 		if (!hMem)
 		{
@@ -1612,8 +2059,25 @@ namespace helpers
 			return UiFail(err, L"Failed to lock clipboard memory.");
 		}
 
-		memcpy(pMem, textW.c_str(), bytes);
+		wchar_t* dst = static_cast<wchar_t*>(pMem);
+		size_t at = 0;
+		const bool converted = LogStoreForEachChunk([dst, wideChars, &at](const char* data, size_t size) {
+			if (at >= wideChars)
+				return false;   // cchWideChar 0 would only measure
+			const int n = MultiByteToWideChar(CP_UTF8, 0, data, (int)size, dst + at, (int)(wideChars - at));
+			if (n <= 0)
+				return false;
+			at += (size_t)n;
+			return true;
+		});
+		dst[at] = L'\0';
 		GlobalUnlock(hMem);
+		if (!converted)
+		{
+			GlobalFree(hMem);
+			CloseClipboard();
+			return UiFail(0, L"Failed to read the log.");
+		}
 
 		if (!SetClipboardData(CF_UNICODETEXT, hMem))
 		{
@@ -1659,8 +2123,7 @@ namespace helpers
 	static void SaveOutputToFile(AppState* st)
 	{
 		if (!st || !st->hMainWnd) return;
-		std::wstring textW = GetOutputTextW(st);
-		if (textW.empty())
+		if (IsOutputLogEmpty(st))
 		{
 			MessageBoxW(st->hMainWnd, L"Log is empty. Nothing to Save!", L"Save Log", MB_OK | MB_ICONINFORMATION);
 			return;
@@ -1730,10 +2193,20 @@ namespace helpers
 			return;
 		}
 
-		// Write UTF-16LE with BOM so Notepad opens it reliably.
+		// Write UTF-16LE with BOM so Notepad opens it reliably, converting the log store chunk by chunk.
 		const unsigned char bom[2] = { 0xFF, 0xFE };
 		f.write((const char*)bom, 2);
-		f.write((const char*)textW.data(), (std::streamsize)textW.size() * (std::streamsize)sizeof(wchar_t));
+		std::wstring wide;
+		const bool written = ForEachOutputLogChunk(st, [&f, &wide](const char* data, size_t size) {
+			wide.resize(size);   // UTF-8 never takes fewer bytes than UTF-16 code units
+			const int n = MultiByteToWideChar(CP_UTF8, 0, data, (int)size, wide.data(), (int)wide.size());
+			if (n <= 0)
+				return false;
+			f.write((const char*)wide.data(), (std::streamsize)n * (std::streamsize)sizeof(wchar_t));
+			return (bool)f;
+		});
+		if (!written)
+			MessageBoxW(st->hMainWnd, L"Failed to write the log file.", L"Save Log", MB_OK | MB_ICONERROR);
 	}
 
 	static void SaveOutputToFile()
@@ -1953,12 +2426,74 @@ static std::string PathToUtf8(const fs::path& p)
 {
 	return WideToUtf8(p.wstring());
 }
-// Thread-safe log: posts to main thread
+// Thread-safe log: queues for the main thread (see "Log queue" above)
 static void Log(const std::string& textUtf8)
 {
-	// Thread-safe log: post a unified UI event carrying wide text.
+	if (LogCapture* capture = t_logCapture)
+	{
+		std::lock_guard<std::mutex> guard(capture->lock);
+		capture->text += textUtf8;
+		return;
+	}
+	// Convert outside the lock; the critical section is just an append.
 	std::wstring ws = Utf8ToWide(textUtf8);
-	PostUiText(UiEventKind::LogAppendW, std::move(ws));
+	if (ws.empty()) return;
+	bool needWake = false;
+	{
+		std::lock_guard<std::mutex> guard(g_logQueue.lock);
+		g_logQueue.pending += ws;
+		needWake = !g_logQueue.wakePosted;
+		g_logQueue.wakePosted = true;
+	}
+	if (!needWake)
+		return;
+	for (int attempt = 0; !PostUiSimple(UiEventKind::LogAppendW); ++attempt)
+	{
+		AppState* st = g_state;
+		if (st && st->hOutput && st->uiThreadId == GetCurrentThreadId())
+		{
+			FlushPendingLog(st);
+			return;
+		}
+		if (attempt >= kLogWakeRetries || !st || !st->hMainWnd)
+		{
+			// No window yet (or it is gone): let the next Log() retry the wake-up.
+			std::lock_guard<std::mutex> guard(g_logQueue.lock);
+			g_logQueue.wakePosted = false;
+			return;
+		}
+		Sleep(kLogWakeRetryMs);
+	}
+}
+// UI thread: appends everything queued so far in one RichEdit operation.
+static void FlushPendingLog(AppState* st)
+{
+	std::wstring batch;
+	{
+		std::lock_guard<std::mutex> guard(g_logQueue.lock);
+		batch.swap(g_logQueue.pending);
+		g_logQueue.wakePosted = false;
+	}
+	g_logQueue.lastFlushTick = GetTickCount64();
+	if (st && st->hMainWnd) KillTimer(st->hMainWnd, kLogFlushTimerId);
+	if (!batch.empty())
+		AppendToOutputW(st, batch);
+}
+// UI thread: LogAppendW wake-up. Drains now, or defers to the flush timer when the last
+// drain was very recent so that fast bursts are rendered in larger batches.
+static void ScheduleLogFlush(AppState* st, HWND hwnd)
+{
+	const ULONGLONG elapsed = GetTickCount64() - g_logQueue.lastFlushTick;
+	size_t pendingChars = 0;
+	{
+		std::lock_guard<std::mutex> guard(g_logQueue.lock);
+		pendingChars = g_logQueue.pending.size();
+	}
+	if (elapsed >= kLogFlushIntervalMs || pendingChars >= kLogFlushMaxChars
+		|| !SetTimer(hwnd, kLogFlushTimerId, (UINT)(kLogFlushIntervalMs - elapsed), nullptr))
+	{
+		FlushPendingLog(st);
+	}
 }
 static void LogSeparator(char ch = '_', size_t count = 150)
 {
@@ -1994,7 +2529,7 @@ static void PostProgressSet(size_t pos)
 {
 	PostUiSimple(UiEventKind::ProgressSet, pos);
 }
-static std::wstring MakeProgressFileLabel(const wchar_t* verb, size_t index1, size_t total, const std::string& relUtf8, const std::string* remoteUtf8 = nullptr)
+static std::wstring MakeProgressFileLabel(const wchar_t* verb, size_t index1, size_t total, const std::string& relUtf8, const std::string* remoteUtf8 = nullptr, int percentOverride = -1)
 {
 	// Build a progress label that reliably shows the filename.
 	// We put the filename FIRST (right after the X/Y counter) so it stays visible even when the control is narrow.
@@ -2009,7 +2544,8 @@ static std::wstring MakeProgressFileLabel(const wchar_t* verb, size_t index1, si
 	if (nameW.empty()) nameW = L"(unknown)";
 
 	int pct = 0;
-	if (total > 0) pct = (int)((long long)index1 * 100LL / (long long)total);
+	if (percentOverride >= 0) pct = percentOverride;   // e.g. byte-weighted sync progress
+	else if (total > 0) pct = (int)((long long)index1 * 100LL / (long long)total);
 
 	std::wstring msg = std::wstring(verb) + L" " + std::to_wstring(index1) + L"/" + std::to_wstring(total)
 		+ L" ( " + std::to_wstring(pct) + L"% ): " + nameW;
@@ -2017,6 +2553,162 @@ static std::wstring MakeProgressFileLabel(const wchar_t* verb, size_t index1, si
 	// (Intentionally showing filename only; full/relative paths can be long and get clipped.)
 	return msg;
 }
+// --------------------------------------------------
+// Progress reporter (worker -> UI, polled)
+// - Per-entry progress is published through atomics only: no string building and no
+//   window messages per file. The UI thread samples it at kProgressPollIntervalMs.
+// - The label is a pointer to the caller's entry name; Begin/End and the UI snapshot take
+//   the lock, so the pointer is never read after End() returns.
+// - End() posts the final bar position and label as regular progress events, so whatever
+//   the worker posts next (e.g. "Sync complete") lands after them.
+// - Workers report into *t_progress: g_progress (the one the window polls) unless the run set
+//   its own, as each headless batch folder does. Pool threads take over their creator's.
+// --------------------------------------------------
+struct ProgressReporter
+{
+	std::mutex lock;                           // Begin/End vs. UI snapshot
+	bool active = false;
+	const wchar_t* verb = L"File";
+	size_t total = 0;
+	unsigned long long totalBytes = 0;         // > 0: bar weighted by manifest bytes
+	ULONGLONG startTick = 0;
+
+	std::atomic<size_t> done{ 0 };
+	std::atomic<unsigned long long> bytesDone{ 0 };   // manifest bytes of finished entries
+	std::atomic<unsigned long long> netBytes{ 0 };    // bytes received from the network
+	std::atomic<const std::string_view*> label{ nullptr };
+
+	// UI thread only: rate window for files/s and MB/s.
+	ULONGLONG rateTick = 0;
+	size_t rateDone = 0;
+	unsigned long long rateBytes = 0;
+	double filesPerSec = 0.0;
+	double mbPerSec = 0.0;
+};
+static ProgressReporter g_progress;
+static thread_local ProgressReporter* t_progress = &g_progress;
+static constexpr size_t kSyncProgressByteUnits = 10000;   // bar range when weighting by bytes
+static constexpr UINT_PTR kProgressPollTimerId = 0x5052;  // 'PR'
+static constexpr UINT kProgressPollIntervalMs = 33;       // ~30 Hz
+static constexpr ULONGLONG kProgressRateWindowMs = 1000;
+
+static size_t ProgressReporterBarTotal(const ProgressReporter& p)
+{
+	return p.totalBytes > 0 ? kSyncProgressByteUnits : p.total;
+}
+static size_t ProgressReporterBarPos(const ProgressReporter& p, size_t done)
+{
+	if (p.totalBytes == 0) return done;
+	const unsigned long long b = (std::min)(p.bytesDone.load(std::memory_order_relaxed), p.totalBytes);
+	return (size_t)(b * kSyncProgressByteUnits / p.totalBytes);
+}
+static std::wstring ProgressReporterLabel(const ProgressReporter& p, size_t done, bool withRates)
+{
+	const std::string_view* name = p.label.load(std::memory_order_acquire);
+	const int pct = p.totalBytes > 0 ? (int)(ProgressReporterBarPos(p, done) * 100 / kSyncProgressByteUnits) : -1;
+	std::wstring text = MakeProgressFileLabel(p.verb, done, p.total, name ? std::string(*name) : std::string(), nullptr, pct);
+	if (withRates && p.rateTick != p.startTick)
+	{
+		wchar_t rates[96]{};
+		swprintf_s(rates, L"   [ %.1f files/s, %.2f MB/s ]", p.filesPerSec, p.mbPerSec);
+		text += rates;
+	}
+	return text;
+}
+// Worker: starts a run of `total` entries. totalBytes > 0 weights the bar by size.
+static void ProgressReporterBegin(const wchar_t* verb, size_t total, unsigned long long totalBytes)
+{
+	ProgressReporter& p = *t_progress;
+	{
+		std::lock_guard<std::mutex> guard(p.lock);
+		p.active = true;
+		p.verb = verb;
+		p.total = total;
+		p.totalBytes = totalBytes;
+		p.startTick = GetTickCount64();
+		p.done.store(0);
+		p.bytesDone.store(0);
+		p.netBytes.store(0);
+		p.label.store(nullptr);
+		p.rateTick = p.startTick;
+		p.rateDone = 0;
+		p.rateBytes = 0;
+		p.filesPerSec = 0.0;
+		p.mbPerSec = 0.0;
+	}
+	if (&p != &g_progress) return;   // the window only polls g_progress
+	PostProgressInit(ProgressReporterBarTotal(p));
+	PostUiSimple(UiEventKind::ProgressPollStart);
+}
+// Worker: one entry finished. `name` must stay valid until ProgressReporterEnd().
+static void ProgressReporterEntryDone(const std::string_view* name, unsigned long long manifestBytes)
+{
+	ProgressReporter& p = *t_progress;
+	p.label.store(name, std::memory_order_release);
+	p.bytesDone.fetch_add(manifestBytes, std::memory_order_relaxed);
+	p.done.fetch_add(1, std::memory_order_release);
+}
+// Any thread: bytes just received for the current run (drives MB/s).
+static void ProgressReporterAddNetBytes(unsigned long long n)
+{
+	t_progress->netBytes.fetch_add(n, std::memory_order_relaxed);
+}
+// Worker: ends the run. postFinal = false on cancel, so "Canceled." is not overwritten.
+static void ProgressReporterEnd(bool postFinal)
+{
+	ProgressReporter& p = *t_progress;
+	size_t pos = 0;
+	std::wstring text;
+	{
+		std::lock_guard<std::mutex> guard(p.lock);
+		if (!p.active) return;
+		const size_t done = p.done.load(std::memory_order_acquire);
+		pos = ProgressReporterBarPos(p, done);
+		if (postFinal)
+			text = ProgressReporterLabel(p, done, false);
+		p.active = false;
+		p.label.store(nullptr);
+	}
+	if (!postFinal || &p != &g_progress) return;
+	PostProgressTextW(std::move(text));
+	PostProgressSet(pos);
+}
+// UI thread (poll timer): renders the current snapshot; stops the timer once the run ended.
+static void ProgressReporterPoll(AppState* st, HWND hwnd)
+{
+	ProgressUpdate u;
+	{
+		std::lock_guard<std::mutex> guard(g_progress.lock);
+		if (!g_progress.active)
+		{
+			KillTimer(hwnd, kProgressPollTimerId);
+			return;
+		}
+		if (!st || !st->hProgress || !GateProgressUpdate(st)) return;
+
+		const size_t done = g_progress.done.load(std::memory_order_acquire);
+		const ULONGLONG now = GetTickCount64();
+		if (now - g_progress.rateTick >= kProgressRateWindowMs)
+		{
+			const double secs = (double)(now - g_progress.rateTick) / 1000.0;
+			const unsigned long long bytes = g_progress.netBytes.load(std::memory_order_relaxed);
+			g_progress.filesPerSec = (double)(done - g_progress.rateDone) / secs;
+			g_progress.mbPerSec = (double)(bytes - g_progress.rateBytes) / (1024.0 * 1024.0) / secs;
+			g_progress.rateTick = now;
+			g_progress.rateDone = done;
+			g_progress.rateBytes = bytes;
+		}
+
+		u.setMarquee = true;
+		u.marquee = false;
+		u.setPos = true;
+		u.pos = ProgressReporterBarPos(g_progress, done);
+		u.setText = true;
+		u.text = ProgressReporterLabel(g_progress, done, true);
+	}
+	st->progressPos = (int)u.pos;
+	ApplyProgressUpdate(st, u);
+}
 
 static bool CheckAndHandleCancel(const CancelToken& cancel, const char* logLine)
 {
@@ -2037,38 +2729,179 @@ struct ScopeExit
 	std::function<void()> fn;
 	~ScopeExit() { if (fn) fn(); }
 };
-
 // --------------------------------------------------
-// RAII wrappers for common Win32/Crypto handle types
+// Performance instrumentation ([Preferences] PerfSummary, TraceLogging)
+// - PerfPhase times one phase of a Sync / Remove run with QueryPerformanceCounter. Totals are
+//   per run (PerfRunBegin resets them); a phase entered more than once adds up. They go to
+//   *t_perf (g_perf unless the run set its own, as each headless batch folder does); pool
+//   threads take over their creator's.
+// - Counters: local bytes hashed, bytes received, HTTP requests and the connections behind them
+//   (a local port not seen before in this run, from WINHTTP_OPTION_CONNECTION_INFO, is a new
+//   connection; the rest reused a kept-alive one) and send-to-headers latency per request.
+// - PerfLogSummary adds a "Performance Summary" section to the log when PerfSummary=1.
+// - Phases and requests are also TraceLogging events of provider "MapPackSyncTool"
+//   ({2fd80803-1f8e-5a93-3054-c49760984164}, the name-hashed GUID, so "*MapPackSyncTool" works
+//   in WPR profiles / tracelog), whatever the INI says. Unregistered = near-zero cost.
 // --------------------------------------------------
-
-struct BcryptAlgHandle
-{
-	BCRYPT_ALG_HANDLE h = nullptr;
-	BcryptAlgHandle() = default;
-	explicit BcryptAlgHandle(BCRYPT_ALG_HANDLE handle) : h(handle) {}
-	~BcryptAlgHandle() { if (h) { BCryptCloseAlgorithmProvider(h, 0); h = nullptr; } }
-	BcryptAlgHandle(const BcryptAlgHandle&) = delete;
-	BcryptAlgHandle& operator=(const BcryptAlgHandle&) = delete;
-	BcryptAlgHandle(BcryptAlgHandle&& o) noexcept : h(o.h) { o.h = nullptr; }
-	BcryptAlgHandle& operator=(BcryptAlgHandle&& o) noexcept { if (this != &o) { if (h) BCryptCloseAlgorithmProvider(h, 0); h = o.h; o.h = nullptr; } return *this; }
-	operator BCRYPT_ALG_HANDLE() const { return h; }
-	bool valid() const { return h != nullptr; }
+TRACELOGGING_DEFINE_PROVIDER(g_perfProvider, "MapPackSyncTool",
+	(0x2fd80803, 0x1f8e, 0x5a93, 0x30, 0x54, 0xc4, 0x97, 0x60, 0x98, 0x41, 0x64));
+struct PerfPhaseTotal
+{
+	const char* name = nullptr;   // string literal
+	double ms = 0.0;
+	size_t count = 0;
 };
-
-struct BcryptHashHandle
-{
-	BCRYPT_HASH_HANDLE h = nullptr;
-	BcryptHashHandle() = default;
-	explicit BcryptHashHandle(BCRYPT_HASH_HANDLE handle) : h(handle) {}
-	~BcryptHashHandle() { if (h) { BCryptDestroyHash(h); h = nullptr; } }
-	BcryptHashHandle(const BcryptHashHandle&) = delete;
-	BcryptHashHandle& operator=(const BcryptHashHandle&) = delete;
-	BcryptHashHandle(BcryptHashHandle&& o) noexcept : h(o.h) { o.h = nullptr; }
-	BcryptHashHandle& operator=(BcryptHashHandle&& o) noexcept { if (this != &o) { if (h) BCryptDestroyHash(h); h = o.h; o.h = nullptr; } return *this; }
-	operator BCRYPT_HASH_HANDLE() const { return h; }
-	bool valid() const { return h != nullptr; }
+struct PerfStats
+{
+	std::mutex lock;                    // guards the vectors and the port set
+	std::vector<PerfPhaseTotal> phases; // in first-entered order
+	std::vector<uint32_t> requestUs;    // send -> response headers, per request
+	std::unordered_set<unsigned> ports; // local ports seen this run
+	size_t connections = 0;
+	size_t requestsNoConnInfo = 0;      // WINHTTP_OPTION_CONNECTION_INFO not available
+	std::atomic<unsigned long long> bytesHashed{ 0 };
+	std::atomic<unsigned long long> bytesReceived{ 0 };
+	LARGE_INTEGER runStart{};
+};
+static PerfStats g_perf;
+static thread_local PerfStats* t_perf = &g_perf;
+static double PerfTicksToMs(LONGLONG ticks)
+{
+	static const LONGLONG freq = []() { LARGE_INTEGER f{}; QueryPerformanceFrequency(&f); return f.QuadPart > 0 ? f.QuadPart : 1; }();
+	return (double)ticks * 1000.0 / (double)freq;
+}
+static void PerfRunBegin()
+{
+	PerfStats& perf = *t_perf;
+	std::lock_guard<std::mutex> guard(perf.lock);
+	perf.phases.clear();
+	perf.requestUs.clear();
+	perf.ports.clear();
+	perf.connections = 0;
+	perf.requestsNoConnInfo = 0;
+	perf.bytesHashed.store(0);
+	perf.bytesReceived.store(0);
+	QueryPerformanceCounter(&perf.runStart);
+}
+static void PerfNoteHashedBytes(unsigned long long n)
+{
+	t_perf->bytesHashed.fetch_add(n, std::memory_order_relaxed);
+}
+static void PerfNoteReceivedBytes(unsigned long long n)
+{
+	t_perf->bytesReceived.fetch_add(n, std::memory_order_relaxed);
+}
+// localPort 0 = unknown connection.
+static void PerfNoteRequest(LONGLONG ticks, unsigned localPort)
+{
+	PerfStats& perf = *t_perf;
+	const double ms = PerfTicksToMs(ticks);
+	bool reused = false;
+	{
+		std::lock_guard<std::mutex> guard(perf.lock);
+		perf.requestUs.push_back((uint32_t)(std::min)(ms * 1000.0, 4294967295.0));
+		if (localPort == 0)
+			++perf.requestsNoConnInfo;
+		else if (perf.ports.insert(localPort).second)
+			++perf.connections;
+		else
+			reused = true;
+	}
+	TraceLoggingWrite(g_perfProvider, "HttpRequest",
+		TraceLoggingFloat64(ms, "HeadersMs"),
+		TraceLoggingUInt32(localPort, "LocalPort"),
+		TraceLoggingBool(reused, "ReusedConnection"));
+}
+static void PerfNotePhase(const char* name, LONGLONG ticks)
+{
+	PerfStats& perf = *t_perf;
+	const double ms = PerfTicksToMs(ticks);
+	{
+		std::lock_guard<std::mutex> guard(perf.lock);
+		auto it = std::find_if(perf.phases.begin(), perf.phases.end(), [name](const PerfPhaseTotal& p) { return strcmp(p.name, name) == 0; });
+		if (it == perf.phases.end())
+			it = perf.phases.insert(perf.phases.end(), PerfPhaseTotal{ name, 0.0, 0 });
+		it->ms += ms;
+		++it->count;
+	}
+	TraceLoggingWrite(g_perfProvider, "Phase",
+		TraceLoggingString(name, "Name"),
+		TraceLoggingFloat64(ms, "DurationMs"));
+}
+// Scoped phase timer; End() closes it early.
+struct PerfPhase
+{
+	const char* name;
+	LARGE_INTEGER start{};
+	bool open = true;
+	explicit PerfPhase(const char* phaseName) : name(phaseName) { QueryPerformanceCounter(&start); }
+	PerfPhase(const PerfPhase&) = delete;
+	PerfPhase& operator=(const PerfPhase&) = delete;
+	~PerfPhase() { End(); }
+	void End()
+	{
+		if (!open) return;
+		open = false;
+		LARGE_INTEGER now{};
+		QueryPerformanceCounter(&now);
+		PerfNotePhase(name, now.QuadPart - start.QuadPart);
+	}
 };
+static std::string PerfFormatMs(double ms)
+{
+	char buf[32]{};
+	if (ms >= 10000.0) sprintf_s(buf, "%.1f s", ms / 1000.0);
+	else sprintf_s(buf, "%.1f ms", ms);
+	return buf;
+}
+static std::string PerfFormatBytes(unsigned long long bytes)
+{
+	char buf[32]{};
+	if (bytes >= 1024ull * 1024ull * 1024ull) sprintf_s(buf, "%.2f GB", (double)bytes / (1024.0 * 1024.0 * 1024.0));
+	else if (bytes >= 1024ull * 1024ull) sprintf_s(buf, "%.2f MB", (double)bytes / (1024.0 * 1024.0));
+	else sprintf_s(buf, "%llu KB", bytes / 1024ull);
+	return buf;
+}
+static void PerfLogSummary()
+{
+	const PerfStats& perf = *t_perf;
+	std::vector<PerfPhaseTotal> phases;
+	std::vector<uint32_t> us;
+	size_t connections = 0, noConnInfo = 0;
+	LARGE_INTEGER now{};
+	QueryPerformanceCounter(&now);
+	double totalMs = 0.0;
+	{
+		std::lock_guard<std::mutex> guard(perf.lock);
+		phases = perf.phases;
+		us = perf.requestUs;
+		connections = perf.connections;
+		noConnInfo = perf.requestsNoConnInfo;
+		totalMs = PerfTicksToMs(now.QuadPart - perf.runStart.QuadPart);
+	}
+	LogSeparator();
+	Log("Performance Summary:\r\n");
+	Log("  Total:  " + PerfFormatMs(totalMs) + "\r\n");
+	for (const auto& p : phases)
+		Log("    " + std::string(p.name) + ":  " + PerfFormatMs(p.ms) + (p.count > 1 ? " (" + std::to_string(p.count) + "x)" : "") + "\r\n");
+	Log("  Local bytes hashed:  " + PerfFormatBytes(perf.bytesHashed.load()) + "\r\n");
+	Log("  Bytes downloaded:  " + PerfFormatBytes(perf.bytesReceived.load()) + "\r\n");
+	if (!us.empty())
+	{
+		std::sort(us.begin(), us.end());
+		auto pct = [&us](double q) { return (double)us[(size_t)(q * (double)(us.size() - 1) + 0.5)] / 1000.0; };
+		const size_t known = us.size() - noConnInfo;
+		Log("  HTTP requests:  " + std::to_string(us.size()) + (known > 0
+			? " on " + std::to_string(connections) + " connection(s), " + std::to_string(known - connections) + " reused"
+			: std::string()) + "\r\n");
+		Log("  Time to response headers:  p50 " + PerfFormatMs(pct(0.50)) + ", p90 " + PerfFormatMs(pct(0.90))
+			+ ", p99 " + PerfFormatMs(pct(0.99)) + ", max " + PerfFormatMs(us.back() / 1000.0) + "\r\n");
+	}
+}
+
+// --------------------------------------------------
+// RAII wrappers for common Win32/Crypto handle types
+// --------------------------------------------------
 
 struct CryptMsgHandle
 {
@@ -2147,6 +2980,12 @@ struct SyncConfig
 	std::string manifestUrl;
 	fs::path localBase;
 	fs::path localSyncRoot;
+	int downloadWorkers = AppConstants::kDefaultDownloadWorkers;
+	bool forceFullVerify = false;   // ignore the local hash index and re-hash every file
+	int fullVerifyDays = AppConstants::kDefaultFullVerifyDays;   // max days between full passes; 0 = always full
+	int maxDownloadKBps = 0;        // global download cap; 0 = unlimited
+	bool dedupHardLinks = false;    // fill identical-content paths with hard links instead of copies
+	ExclusionMatcher exclusions;    // loaded once per run (LoadExclusionMatcher)
 };
 static bool IsLikelyAccessDeniedErrorCode(const std::error_code& ec)
 {
@@ -2393,13 +3232,53 @@ static bool EnsureSelectedGameFolderWriteAccessOrPromptElevation(HWND owner, con
 			L"Please choose a writable game folder or adjust permissions.");
 }
 
+// Optional conditional-GET state. Validators are sent as If-None-Match / If-Modified-Since;
+// a 304 reply is then reported as success with notModified = true (and no body).
+struct HttpConditional
+{
+	std::string etag;
+	std::string lastModified;
+
+	// Filled from the response.
+	bool notModified = false;
+	std::string respEtag;
+	std::string respLastModified;
+};
+// Optional resume state. offset > 0 sends "Range: bytes=<offset>-" (plus If-Range when a
+// validator is known); a 206 reply is checked against Content-Range before it is accepted.
+// Pack fetches set spans instead ("a-b,c-d"); the caller then splits the 206 body itself.
+struct HttpRangeRequest
+{
+	unsigned long long offset = 0;
+	std::string ifRange;             // strong ETag or Last-Modified date the kept bytes came from
+	std::string spans;               // explicit byte ranges; takes precedence over offset
+
+	// Filled from the response.
+	bool partial = false;            // 206: the body continues at offset (or holds the spans)
+	bool notSatisfiable = false;     // 416: the kept bytes cannot be resumed
+	std::string respValidator;       // strong ETag, else Last-Modified ("" = not resumable)
+	std::string contentType;         // spans only: multipart/byteranges or the single part's type
+	std::string contentRange;        // spans only: Content-Range of a single-part 206
+};
+// HTTP validator cache record (see the HTTP validator cache section).
+struct HttpCacheMeta
+{
+	std::string url;
+	std::string etag;
+	std::string lastModified;
+	std::string sha256;   // lowercase hex of the body
+};
+static bool Sha256FileHexLower(const fs::path& filePath, std::string& outHex);
 static bool DownloadUrlToFileNoVerify(
 	const std::string& url,
 	const fs::path& destFile,
 	const CancelToken& cancel,
 	std::string* outErr,
 	long* outHttp,
-	unsigned long long maxBytes = AppConstants::kMaxSupportFileDownloadBytes);
+	unsigned long long maxBytes = AppConstants::kMaxSupportFileDownloadBytes,
+	HttpConditional* cond = nullptr);
+static bool HttpCacheLoadMeta(const std::string& url, HttpCacheMeta& out);
+static void HttpCacheRememberFile(const std::string& url, const HttpConditional& cond, const fs::path& file);
 static bool MoveReplace(const fs::path& from, const fs::path& to);
 
 static bool AreFilesByteIdentical(const fs::path& a, const fs::path& b, std::wstring* outErr = nullptr)
@@ -2516,12 +3395,23 @@ static bool DownloadRemoteAppFilePreserveTimestamp(
 	std::string dlErr;
 	long http = 0;
 
+	// Conditional GET: if the local file still holds exactly the bytes we last fetched,
+	// send the stored validators so an unchanged file costs a 304 instead of a full download.
+	HttpConditional cond;
+	HttpCacheMeta meta;
+	std::string destSha;
+	if (HttpCacheLoadMeta(url, meta) && Sha256FileHexLower(dest, destSha) && destSha == meta.sha256)
+	{
+		cond.etag = meta.etag;
+		cond.lastModified = meta.lastModified;
+	}
+
 	// Always download to a side file first. If the downloaded bytes match the
 	// existing local file, delete the side file and leave the local modified time
 	// untouched. Only replace the local file when the content actually changes.
 	// This will preserve file date/time so it doesn't look like we have a new updates,
 	// to help/support/changelog files everytime program is ran.
-	if (!DownloadUrlToFileNoVerify(url, downloaded, noCancel, &dlErr, &http))
+	if (!DownloadUrlToFileNoVerify(url, downloaded, noCancel, &dlErr, &http, AppConstants::kMaxSupportFileDownloadBytes, &cond))
 	{
 		fs::remove(downloaded, ec);
 		std::wstring msg = L"Failed to download " + std::wstring(localName) + L".";
@@ -2533,10 +3423,14 @@ static bool DownloadRemoteAppFilePreserveTimestamp(
 		return false;
 	}
 
+	if (cond.notModified)
+		return true;
+
 	std::wstring compareErr;
 	if (AreFilesByteIdentical(dest, downloaded, &compareErr))
 	{
 		fs::remove(downloaded, ec);
+		HttpCacheRememberFile(url, cond, dest);
 		return true;
 	}
 
@@ -2552,6 +3446,7 @@ static bool DownloadRemoteAppFilePreserveTimestamp(
 		return false;
 	}
 
+	HttpCacheRememberFile(url, cond, dest);
 	return true;
 }
 
@@ -2619,118 +3514,35 @@ static bool RefreshStartupSupportFiles(HWND owner)
 }
 
 // --------------------------------------------------
-// SHA-256 (Windows CNG / BCrypt)
+// SHA-256 (Sha256Lib, shared with the manifest tools)
 // --------------------------------------------------
+// One cached CNG provider per process and one reusable hash object per thread, so sync pool
+// workers verify local files in parallel without reopening BCrypt. Large files are hashed
+// through memory-mapped views. See Sha256Lib/Sha256.h.
 static bool Sha256FileHexLower(const fs::path& filePath, std::string& outHex)
 {
-	outHex.clear();
-
-	BCRYPT_ALG_HANDLE rawAlg = nullptr;
-	BCRYPT_HASH_HANDLE rawHash = nullptr;
-
-	NTSTATUS st = BCryptOpenAlgorithmProvider(&rawAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
-	if (st != 0) return false;
-	BcryptAlgHandle hAlg(rawAlg);
-
-	DWORD objLen = 0, cbData = 0, hashLen = 0;
-
-	st = BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&objLen, sizeof(objLen), &cbData, 0);
-	if (st != 0) return false;
-
-	st = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&hashLen, sizeof(hashLen), &cbData, 0);
-	if (st != 0) return false;
+	return sha256lib::HashFileHex(filePath.wstring(), outHex);
+}
 
-	std::vector<UCHAR> obj(objLen);
-	std::vector<UCHAR> hash(hashLen);
+static bool Sha256BytesHexLower(const void* data, size_t size, std::string& outHex)
+{
+	return sha256lib::HashBytesHex(data, size, outHex);
+}
 
-	st = BCryptCreateHash(hAlg, &rawHash, obj.data(), (ULONG)obj.size(), nullptr, 0, 0);
-	if (st != 0) return false;
-	BcryptHashHandle hHash(rawHash);
-
-	std::ifstream f(filePath, std::ios::binary);
-	if (!f) return false;
-
-	std::vector<char> buf(64 * 1024);
-	while (f)
-	{
-		f.read(buf.data(), (std::streamsize)buf.size());
-		std::streamsize got = f.gcount();
-		if (got <= 0) break;
-		st = BCryptHashData(hHash, (PUCHAR)buf.data(), (ULONG)got, 0);
-		if (st != 0) return false;
-	}
-
-	st = BCryptFinishHash(hHash, hash.data(), (ULONG)hash.size(), 0);
-	if (st != 0) return false;
-
-	static const char* hexd = "0123456789abcdef";
-	outHex.resize(hash.size() * 2);
-	for (size_t i = 0; i < hash.size(); ++i)
-	{
-		outHex[i * 2 + 0] = hexd[(hash[i] >> 4) & 0xF];
-		outHex[i * 2 + 1] = hexd[hash[i] & 0xF];
-	}
-	return true;
-}
-
-static bool Sha256BytesHexLower(const void* data, size_t size, std::string& outHex)
-{
-	outHex.clear();
-	if (!data && size != 0)
-		return false;
-
-	BCRYPT_ALG_HANDLE rawAlg = nullptr;
-	BCRYPT_HASH_HANDLE rawHash = nullptr;
-
-	NTSTATUS st = BCryptOpenAlgorithmProvider(&rawAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
-	if (st != 0) return false;
-	BcryptAlgHandle hAlg(rawAlg);
-
-	DWORD objLen = 0, cbData = 0, hashLen = 0;
-	st = BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&objLen, sizeof(objLen), &cbData, 0);
-	if (st != 0) return false;
-	st = BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&hashLen, sizeof(hashLen), &cbData, 0);
-	if (st != 0) return false;
-
-	std::vector<UCHAR> obj(objLen);
-	std::vector<UCHAR> hash(hashLen);
-
-	st = BCryptCreateHash(hAlg, &rawHash, obj.data(), (ULONG)obj.size(), nullptr, 0, 0);
-	if (st != 0) return false;
-	BcryptHashHandle hHash(rawHash);
-
-	const BYTE* bytes = static_cast<const BYTE*>(data);
-	while (size > 0)
-	{
-		const ULONG chunk = (size > 1024ull * 1024ull) ? (1024ul * 1024ul) : static_cast<ULONG>(size);
-		st = BCryptHashData(hHash, const_cast<PUCHAR>(bytes), chunk, 0);
-		if (st != 0) return false;
-		bytes += chunk;
-		size -= chunk;
-	}
-
-	st = BCryptFinishHash(hHash, hash.data(), (ULONG)hash.size(), 0);
-	if (st != 0) return false;
-
-	static const char* hexd = "0123456789abcdef";
-	outHex.resize(hash.size() * 2);
-	for (size_t i = 0; i < hash.size(); ++i)
-	{
-		outHex[i * 2 + 0] = hexd[(hash[i] >> 4) & 0xF];
-		outHex[i * 2 + 1] = hexd[hash[i] & 0xF];
-	}
-	return true;
-}
-
-static bool Sha256StringHexLower(const std::string& data, std::string& outHex)
-{
-	return Sha256BytesHexLower(data.empty() ? nullptr : data.data(), data.size(), outHex);
-}
+static bool Sha256StringHexLower(const std::string& data, std::string& outHex)
+{
+	return Sha256BytesHexLower(data.empty() ? nullptr : data.data(), data.size(), outHex);
+}
 
 static bool StartsWith(const std::string& s, const std::string& prefix)
 {
 	return s.size() >= prefix.size() && memcmp(s.data(), prefix.data(), prefix.size()) == 0;
 }
+static std::string ToLowerAsciiCopy(std::string s)
+{
+	std::transform(s.begin(), s.end(), s.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+	return s;
+}
 static bool EqualIcaseAscii(const std::string& a, const std::string& b)
 {
 	if (a.size() != b.size()) return false;
@@ -2950,23 +3762,63 @@ static bool NormalizeManifestRelStrict(std::string_view manifestRelPath, std::st
 
 static fs::path MakeDestPath(const fs::path& installRoot, std::string_view validatedRelPath)
 {
-	// validatedRelPath is produced by ValidateAndNormalizeManifest() and is guaranteed to be relative and safe.
+	// validatedRelPath is produced by ParseAndValidateManifest() and is guaranteed to be relative and safe.
 	return installRoot / "resources_override" / "mappack" / fs::path(std::string(validatedRelPath));
 }
 // --------------------------------------------------
 // Manifest parsing
+// - ParseAndValidateManifest reads the manifest text in one pass straight into the work list.
+//   Entries are views: into the manifest text itself when a string has no escapes and is
+//   already in canonical form (what ManifestSha256 writes), otherwise into a StringArena.
+// - The SHA-256 is kept as its 32 raw bytes; consumers ask for hex when they need it.
+// - ManifestRawEntry (owned strings) remains for manifest deltas and the delta base, which are
+//   edited as a path -> hash map anyway.
 // --------------------------------------------------
+// Bump allocator for manifest strings that cannot point into the text (escaped or
+// non-canonical paths). Chunks never move, so views stay valid when the owner is moved.
+struct StringArena
+{
+	static constexpr size_t kChunkBytes = 64 * 1024;
+	std::vector<std::unique_ptr<char[]>> chunks;
+	size_t used = 0;       // bytes used in chunks.back()
+	size_t capacity = 0;   // size of chunks.back()
+
+	std::string_view Store(std::string_view s)
+	{
+		if (s.empty())
+			return std::string_view();
+		if (chunks.empty() || capacity - used < s.size())
+		{
+			capacity = (std::max)(kChunkBytes, s.size());
+			chunks.emplace_back(new char[capacity]);
+			used = 0;
+		}
+		char* dst = chunks.back().get() + used;
+		memcpy(dst, s.data(), s.size());
+		used += s.size();
+		return std::string_view(dst, s.size());
+	}
+	void Clear()
+	{
+		chunks.clear();
+		used = capacity = 0;
+	}
+};
 struct ManifestEntry
 {
-	std::string remotePath;  // normalized remote path (generic, '/' separators, no leading '/')
-	std::string relPath;     // normalized relative path under resources_override/mappack/
-	std::string sha256;      // expected SHA-256 (hex)
+	std::string_view remotePath;  // normalized remote path (generic, '/' separators, no leading '/')
+	std::string_view relPath;     // normalized relative path under resources_override/mappack/ (a suffix of remotePath)
+	unsigned char sha256[sha256lib::kDigestBytes] = {};   // expected SHA-256
+	long long size = -1;          // expected size in bytes; -1 when the manifest has no "size"
+
+	std::string Sha256Hex() const { return sha256lib::ToHexLower(sha256, sizeof(sha256)); }
 };
 
 struct ManifestRawEntry
 {
 	std::string path;   // path string exactly as in manifest (UTF-8)
 	std::string sha256; // sha256 exactly as in manifest (hex)
+	long long size = -1; // "size" if present (older manifests omit it)
 };
 
 
@@ -3146,6 +3998,31 @@ static bool SkipJsonNumber(const std::string& s, size_t& i)
 	return i > start;
 }
 
+// Non-negative integer only (file sizes); fractions, exponents and signs are rejected.
+static bool ReadJsonUInt64(const std::string& s, size_t& i, long long& out, std::string* outErr)
+{
+	const size_t start = i;
+	unsigned long long v = 0;
+	while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+	{
+		if (v > (0x7FFFFFFFFFFFFFFFull - (unsigned long long)(s[i] - '0')) / 10ull)
+		{
+			if (outErr) *outErr = "number out of range";
+			return false;
+		}
+		v = v * 10ull + (unsigned long long)(s[i] - '0');
+		++i;
+	}
+	if (i == start || (i - start > 1 && s[start] == '0') || (i < s.size() && (s[i] == '.' || s[i] == 'e' || s[i] == 'E')))
+	{
+		i = start;
+		if (outErr) *outErr = "expected non-negative integer";
+		return false;
+	}
+	out = (long long)v;
+	return true;
+}
+
 static bool SkipJsonArray(const std::string& s, size_t& i, int depth, std::string* outErr)
 {
 	if (i >= s.size() || s[i] != '[') { if (outErr) *outErr = "expected '['"; return false; }
@@ -3267,36 +4144,89 @@ static bool IsHex64(const std::string& s)
 
 // New manifest format: top-level JSON object with "files": [ { "path": "...", "sha256": "..." }, ... ]
 
-// Forward declarations (needed for Status wrappers)
-struct ManifestRawEntry;
-struct ManifestEntry;
-static bool ParseManifestRaw(const std::string& jsonText, std::vector<ManifestRawEntry>& outFiles, std::string* outErr);
+static constexpr size_t kMaxManifestBytes = 50ull * 1024ull * 1024ull; // 50 MiB (network input)
+
+// Parses one [{"path":"...","sha256":"..."}, ...] array starting at s[i] (the manifest "files"
+// array, and the added/changed/removed arrays of a manifest delta).
+static bool ParseManifestFileArray(const std::string& s, size_t& i, std::vector<ManifestRawEntry>& outFiles, const char* arrayName, std::string* outErr)
+{
+	if (i >= s.size() || s[i] != '[') { if (outErr) *outErr = "expected '[' for " + std::string(arrayName); return false; }
+	++i;
+	SkipWs(s, i);
+	if (i < s.size() && s[i] == ']') { ++i; return true; } // empty array allowed
+	for (;;)
+	{
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated " + std::string(arrayName) + " array"; return false; }
+		if (s[i] != '{') { if (outErr) *outErr = "expected object in " + std::string(arrayName) + " array"; return false; }
+		++i;
+
+		std::string pathVal, hashVal;
+		long long sizeVal = -1;
+		for (;;)
+		{
+			SkipWs(s, i);
+			if (i >= s.size()) { if (outErr) *outErr = "unterminated file object"; return false; }
+			if (s[i] == '}') { ++i; break; }
+
+			std::string fkey;
+			if (!ReadJsonString(s, i, fkey, outErr)) return false;
+			SkipWs(s, i);
+			if (i >= s.size() || s[i] != ':') { if (outErr) *outErr = "expected ':' in file object"; return false; }
+			++i;
+			SkipWs(s, i);
+
+			if (fkey == "path")
+			{
+				if (!ReadJsonString(s, i, pathVal, outErr)) return false;
+			}
+			else if (fkey == "sha256" || fkey == "hash")
+			{
+				if (!ReadJsonString(s, i, hashVal, outErr)) return false;
+			}
+			else if (fkey == "size")
+			{
+				if (!ReadJsonUInt64(s, i, sizeVal, outErr)) return false;
+			}
+			else
+			{
+				// Skip any unknown field (string/number/object/array/bool/null)
+				if (!SkipJsonValue(s, i, 0, outErr)) return false;
+			}
 
-// Validate+normalize has a 4-arg core version (tracks duplicates) and a convenience 3-arg overload.
-static bool ValidateAndNormalizeManifest(const std::vector<ManifestRawEntry>& rawFiles,
-	std::vector<ManifestEntry>& outWorkList,
-	std::unordered_set<std::string>& outManifestRelSet,
-	std::string* outErr);
+			SkipWs(s, i);
+			if (i >= s.size()) { if (outErr) *outErr = "unterminated file object"; return false; }
+			if (s[i] == ',') { ++i; continue; }
+			if (s[i] == '}') { ++i; break; }
+			if (outErr) *outErr = "expected ',' or '}' in file object";
+			return false;
+		}
 
-// Convenience overload used by Status wrapper and other call sites.
-static bool ValidateAndNormalizeManifest(const std::vector<ManifestRawEntry>& rawFiles,
-	std::vector<ManifestEntry>& outWorkList,
-	std::string* outErr);
+		if (!pathVal.empty() && !hashVal.empty())
+		{
+			// Delta entries are checked by ApplyManifestDelta and the rebuilt manifest by ParseAndValidateManifest.
+			ManifestRawEntry e;
+			e.path = pathVal;
+			e.sha256 = hashVal;
+			e.size = sizeVal;
+			outFiles.push_back(std::move(e));
+		}
 
-static bool ValidateAndNormalizeManifest(const std::vector<ManifestRawEntry>& rawFiles,
-	std::vector<ManifestEntry>& outWorkList,
-	std::string* outErr)
-{
-	std::unordered_set<std::string> dummySet;
-	return ValidateAndNormalizeManifest(rawFiles, outWorkList, dummySet, outErr);
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated " + std::string(arrayName) + " array"; return false; }
+		if (s[i] == ',') { ++i; continue; }
+		if (s[i] == ']') { ++i; break; }
+		if (outErr) *outErr = "expected ',' or ']' in " + std::string(arrayName) + " array";
+		return false;
+	}
+	return true;
 }
+
 static bool ParseManifestRaw(const std::string& jsonText, std::vector<ManifestRawEntry>& outFiles, std::string* outErr)
 {
 	outFiles.clear();
 	if (outErr) outErr->clear();
 
-	// Size guard (network input)
-	static constexpr size_t kMaxManifestBytes = 50ull * 1024ull * 1024ull; // 50 MiB
 	if (jsonText.size() > kMaxManifestBytes)
 	{
 		if (outErr) *outErr = "manifest too large";
@@ -3332,72 +4262,7 @@ static bool ParseManifestRaw(const std::string& jsonText, std::vector<ManifestRa
 		if (key == "files")
 		{
 			foundFiles = true;
-			if (i >= s.size() || s[i] != '[') { if (outErr) *outErr = "expected '[' for files"; return false; }
-			++i;
-			SkipWs(s, i);
-			if (i < s.size() && s[i] == ']') { ++i; } // empty array allowed
-			else
-			{
-				for (;;)
-				{
-					SkipWs(s, i);
-					if (i >= s.size()) { if (outErr) *outErr = "unterminated files array"; return false; }
-					if (s[i] != '{') { if (outErr) *outErr = "expected object in files array"; return false; }
-					++i;
-
-					std::string pathVal, hashVal;
-					for (;;)
-					{
-						SkipWs(s, i);
-						if (i >= s.size()) { if (outErr) *outErr = "unterminated file object"; return false; }
-						if (s[i] == '}') { ++i; break; }
-
-						std::string fkey;
-						if (!ReadJsonString(s, i, fkey, outErr)) return false;
-						SkipWs(s, i);
-						if (i >= s.size() || s[i] != ':') { if (outErr) *outErr = "expected ':' in file object"; return false; }
-						++i;
-						SkipWs(s, i);
-
-						if (fkey == "path")
-						{
-							if (!ReadJsonString(s, i, pathVal, outErr)) return false;
-						}
-						else if (fkey == "sha256" || fkey == "hash")
-						{
-							if (!ReadJsonString(s, i, hashVal, outErr)) return false;
-						}
-						else
-						{
-							// Skip any unknown field (string/number/object/array/bool/null)
-							if (!SkipJsonValue(s, i, 0, outErr)) return false;
-						}
-
-						SkipWs(s, i);
-						if (i >= s.size()) { if (outErr) *outErr = "unterminated file object"; return false; }
-						if (s[i] == ',') { ++i; continue; }
-						if (s[i] == '}') { ++i; break; }
-						if (outErr) *outErr = "expected ',' or '}' in file object";
-						return false;
-					}
-
-					if (!pathVal.empty() && !hashVal.empty())
-					{
-						// Validation is performed in ValidateAndNormalizeManifest().
-						ManifestRawEntry e;
-						e.path = pathVal; // normalized later by ValidateAndNormalizeManifest()
-						e.sha256 = hashVal;
-						outFiles.push_back(std::move(e));
-					}
-
-					SkipWs(s, i);
-					if (i >= s.size()) { if (outErr) *outErr = "unterminated files array"; return false; }
-					if (s[i] == ',') { ++i; continue; }
-					if (s[i] == ']') { ++i; break; }
-					if (outErr) *outErr = "expected ',' or ']' in files array";
-					return false;
-				}
-			}
+			if (!ParseManifestFileArray(s, i, outFiles, "files", outErr)) return false;
 		}
 		else
 		{
@@ -3430,126 +4295,737 @@ static bool ParseManifestRaw(const std::string& jsonText, std::vector<ManifestRa
 
 
 
-static Status ValidateAndNormalizeManifest_Status(
-	const std::vector<ManifestRawEntry>& rawEntries,
-	std::vector<ManifestEntry>& outEntries)
+// String token at s[i] without a copy: a view of the raw bytes when it has no escapes, otherwise
+// decoded by ReadJsonString (same rules) into `scratch` and viewed there.
+static bool ReadJsonStringView(const std::string& s, size_t& i, std::string& scratch, std::string_view& out, std::string* outErr)
 {
-	std::string err;
-	std::vector<ManifestEntry> tmp;
-	if (!ValidateAndNormalizeManifest(rawEntries, tmp, &err)) {
-		return Status::FailMsg(Utf8ToWide(err));
+	out = std::string_view();
+	if (i >= s.size() || s[i] != '"') { if (outErr) *outErr = "expected string"; return false; }
+	const size_t start = i + 1;
+	for (size_t j = start; j < s.size(); ++j)
+	{
+		const char c = s[j];
+		if (c == '"')
+		{
+			out = std::string_view(s.data() + start, j - start);
+			i = j + 1;
+			return true;
+		}
+		if (c == '\\')
+		{
+			if (!ReadJsonString(s, i, scratch, outErr)) return false;
+			out = scratch;
+			return true;
+		}
+		if ((unsigned char)c < 0x20) { if (outErr) *outErr = "control character in string"; return false; }
 	}
-	outEntries.swap(tmp);
-	return Status::Ok();
+	if (outErr) *outErr = "unterminated string";
+	return false;
 }
-
-static bool ValidateAndNormalizeManifest(const std::vector<ManifestRawEntry>& rawFiles,
-	std::vector<ManifestEntry>& outWorkList,
-	std::unordered_set<std::string>& outManifestRelSet,
-	std::string* outErr)
+static bool DecodeSha256Hex(std::string_view hex, unsigned char out[sha256lib::kDigestBytes])
 {
-	outWorkList.clear();
-	outManifestRelSet.clear();
-	if (outErr) outErr->clear();
-
-	if (rawFiles.empty())
+	if (hex.size() != sha256lib::kDigestBytes * 2) return false;
+	for (size_t k = 0; k < sha256lib::kDigestBytes; ++k)
 	{
-		if (outErr) *outErr = "'files' array is empty";
-		return false;
+		uint32_t hi = 0, lo = 0;
+		if (!HexNibble(hex[2 * k], hi) || !HexNibble(hex[2 * k + 1], lo)) return false;
+		out[k] = (unsigned char)((hi << 4) | lo);
 	}
-
-	outWorkList.reserve(rawFiles.size());
-	outManifestRelSet.reserve(rawFiles.size() * 2);
-
-	for (const auto& rf : rawFiles)
+	return true;
+}
+// True when NormalizeManifestRelStrict(NormalizePathGeneric(p)) would only strip the known prefix:
+// '/' separators, no leading/trailing/repeated '/', no "." or ".." segments, and none of what the
+// strict check rejects (NUL, ':', "..").
+static bool IsCanonicalManifestPath(std::string_view p)
+{
+	if (p.empty() || p.front() == '/' || p.back() == '/' || p.find("..") != std::string_view::npos)
+		return false;
+	size_t segStart = 0;
+	for (size_t k = 0; k <= p.size(); ++k)
 	{
-		if (rf.path.empty())
-		{
-			if (outErr) *outErr = "file entry has empty path";
+		const char c = k < p.size() ? p[k] : '/';
+		if (c == '\\' || c == ':' || c == '\0')
 			return false;
-		}
-		if (!IsHex64(rf.sha256))
+		if (c == '/')
 		{
-			if (outErr) *outErr = "invalid sha256 for path: " + rf.path;
-			return false;
+			const size_t len = k - segStart;
+			if (len == 0 || (len == 1 && p[segStart] == '.'))
+				return false;
+			segStart = k + 1;
 		}
+	}
+	return true;
+}
+// Same prefixes, same order, as NormalizeManifestRelStrict.
+static std::string_view StripManifestRelPrefix(std::string_view rel)
+{
+	static constexpr std::string_view kPrefixes[] = { "resources_override/mappack/", "resources_override/", "mappack/" };
+	for (std::string_view prefix : kPrefixes)
+	{
+		if (rel.size() >= prefix.size() && rel.compare(0, prefix.size(), prefix) == 0)
+			return rel.substr(prefix.size());
+	}
+	return rel;
+}
+// The "files" array of ParseAndValidateManifest. outInvalid = well-formed JSON, but an entry
+// failed validation.
+static bool ParseManifestEntryArray(const std::string& s, size_t& i, std::vector<ManifestEntry>& outWorkList, StringArena& arena,
+	std::string& outErr, bool& outInvalid)
+{
+	if (i >= s.size() || s[i] != '[') { outErr = "expected '[' for files"; return false; }
+	++i;
+	SkipWs(s, i);
+	if (i < s.size() && s[i] == ']') { ++i; return true; } // empty array allowed
+	std::string keyScratch, pathScratch, hashScratch;
+	for (;;)
+	{
+		SkipWs(s, i);
+		if (i >= s.size()) { outErr = "unterminated files array"; return false; }
+		if (s[i] != '{') { outErr = "expected object in files array"; return false; }
+		++i;
 
-		ManifestEntry e;
-		e.remotePath = NormalizePathGeneric(rf.path);
-
-		std::string relErr;
-		if (!NormalizeManifestRelStrict(e.remotePath, e.relPath, &relErr))
+		std::string_view pathVal, hashVal;
+		long long sizeVal = -1;
+		for (;;)
 		{
-			if (outErr) *outErr = "unsafe path: " + (relErr.empty() ? rf.path : relErr) + " (" + rf.path + ")";
+			SkipWs(s, i);
+			if (i >= s.size()) { outErr = "unterminated file object"; return false; }
+			if (s[i] == '}') { ++i; break; }
+
+			std::string_view fkey;
+			if (!ReadJsonStringView(s, i, keyScratch, fkey, &outErr)) return false;
+			SkipWs(s, i);
+			if (i >= s.size() || s[i] != ':') { outErr = "expected ':' in file object"; return false; }
+			++i;
+			SkipWs(s, i);
+
+			if (fkey == "path")
+			{
+				if (!ReadJsonStringView(s, i, pathScratch, pathVal, &outErr)) return false;
+			}
+			else if (fkey == "sha256" || fkey == "hash")
+			{
+				if (!ReadJsonStringView(s, i, hashScratch, hashVal, &outErr)) return false;
+			}
+			else if (fkey == "size")
+			{
+				if (!ReadJsonUInt64(s, i, sizeVal, &outErr)) return false;
+			}
+			else
+			{
+				// Skip any unknown field (string/number/object/array/bool/null)
+				if (!SkipJsonValue(s, i, 0, &outErr)) return false;
+			}
+
+			SkipWs(s, i);
+			if (i >= s.size()) { outErr = "unterminated file object"; return false; }
+			if (s[i] == ',') { ++i; continue; }
+			if (s[i] == '}') { ++i; break; }
+			outErr = "expected ',' or '}' in file object";
 			return false;
 		}
 
-		e.sha256 = rf.sha256;
-
-		if (!outManifestRelSet.insert(e.relPath).second)
+		// Entries without a path or hash are ignored, as they always were.
+		if (!pathVal.empty() && !hashVal.empty())
 		{
-			if (outErr) *outErr = "duplicate path in manifest: " + e.relPath;
-			return false;
+			ManifestEntry e;
+			e.size = sizeVal;
+			if (!DecodeSha256Hex(hashVal, e.sha256))
+			{
+				outInvalid = true;
+				outErr = "invalid sha256 for path: " + std::string(pathVal);
+				return false;
+			}
+			if (IsCanonicalManifestPath(pathVal))
+			{
+				e.remotePath = (pathVal.data() == pathScratch.data()) ? arena.Store(pathVal) : pathVal;
+				e.relPath = StripManifestRelPrefix(e.remotePath);
+			}
+			else
+			{
+				const std::string generic = NormalizePathGeneric(pathVal);
+				std::string rel, relErr;
+				if (!NormalizeManifestRelStrict(generic, rel, &relErr))
+				{
+					outInvalid = true;
+					outErr = "unsafe path: " + (relErr.empty() ? std::string(pathVal) : relErr) + " (" + std::string(pathVal) + ")";
+					return false;
+				}
+				e.remotePath = arena.Store(generic);
+				const size_t n = e.remotePath.size();
+				e.relPath = (rel.size() <= n && e.remotePath.compare(n - rel.size(), rel.size(), rel) == 0)
+					? e.remotePath.substr(n - rel.size())
+					: arena.Store(rel);
+			}
+			outWorkList.push_back(e);
 		}
 
-		outWorkList.push_back(std::move(e));
+		SkipWs(s, i);
+		if (i >= s.size()) { outErr = "unterminated files array"; return false; }
+		if (s[i] == ',') { ++i; continue; }
+		if (s[i] == ']') { ++i; break; }
+		outErr = "expected ',' or ']' in files array";
+		return false;
 	}
-
-	std::sort(outWorkList.begin(), outWorkList.end(),
-		[](const ManifestEntry& a, const ManifestEntry& b) { return a.relPath < b.relPath; });
-
 	return true;
 }
-
-
-static bool CrackUrlWinHttp(const std::string& urlUtf8, std::wstring& outHost, std::wstring& outPath, INTERNET_PORT& outPort, bool& outSecure, std::string* outErr)
+// One pass from manifest text to the sorted, validated work list (same rules as ParseManifestRaw
+// plus path/hash validation). Entries view into `text` and `arena`; both must outlive them.
+// outErr is the complete message ("Manifest parse failed: ..." / "Manifest validation failed: ...").
+static bool ParseAndValidateManifest(const std::string& text, std::vector<ManifestEntry>& outWorkList, StringArena& arena, std::string& outErr)
 {
-	outHost.clear();
-	outPath.clear();
-	outPort = 0;
-	outSecure = false;
-
-	std::wstring url = Utf8ToWide(urlUtf8);
-	URL_COMPONENTS uc{};
-	uc.dwStructSize = sizeof(uc);
-	uc.dwHostNameLength = (DWORD)-1;
-	uc.dwUrlPathLength = (DWORD)-1;
-	uc.dwExtraInfoLength = (DWORD)-1;
+	outWorkList.clear();
+	arena.Clear();
+	outErr.clear();
+	std::string err;
+	bool invalid = false;
+	auto fail = [&]() {
+		outWorkList.clear();
+		outErr = (invalid ? "Manifest validation failed: " : "Manifest parse failed: ") + (err.empty() ? std::string("unknown error") : err);
+		return false;
+	};
 
-	if (!WinHttpCrackUrl(url.c_str(), 0, 0, &uc))
+	if (text.size() > kMaxManifestBytes)
 	{
-		if (outErr) *outErr = "WinHttpCrackUrl failed (" + std::to_string(GetLastError()) + ")";
-		return false;
+		err = "manifest too large";
+		return fail();
 	}
+	outWorkList.reserve(text.size() / 160 + 1);   // ManifestSha256 writes ~160 bytes per entry
 
-	if (uc.nScheme != INTERNET_SCHEME_HTTP && uc.nScheme != INTERNET_SCHEME_HTTPS)
+	const std::string& s = text;
+	size_t i = 0;
+	SkipWs(s, i);
+	if (i >= s.size() || s[i] != '{')
 	{
-		if (outErr) *outErr = "Unsupported URL scheme (only http/https allowed)";
-		return false;
+		err = "expected top-level object";
+		return fail();
 	}
+	++i;
 
-	outSecure = (uc.nScheme == INTERNET_SCHEME_HTTPS);
-	outPort = uc.nPort;
-	outHost.assign(uc.lpszHostName, uc.dwHostNameLength);
+	bool foundFiles = false;
+	std::string keyScratch;
+	for (;;)
+	{
+		SkipWs(s, i);
+		if (i >= s.size()) { err = "unterminated top-level object"; return fail(); }
+		if (s[i] == '}') { ++i; break; }
 
-	// Path = url-path + extra-info (query/fragment). We keep query; callers may strip if desired.
-	outPath.assign(uc.lpszUrlPath, uc.dwUrlPathLength);
-	if (uc.dwExtraInfoLength > 0 && uc.lpszExtraInfo)
+		std::string_view key;
+		if (!ReadJsonStringView(s, i, keyScratch, key, &err)) return fail();
+
+		SkipWs(s, i);
+		if (i >= s.size() || s[i] != ':') { err = "expected ':' after key"; return fail(); }
+		++i;
+		SkipWs(s, i);
+
+		if (key == "files")
+		{
+			foundFiles = true;
+			if (!ParseManifestEntryArray(s, i, outWorkList, arena, err, invalid)) return fail();
+		}
+		else
+		{
+			// Skip unknown top-level fields
+			if (!SkipJsonValue(s, i, 0, &err)) return fail();
+		}
+
+		SkipWs(s, i);
+		if (i >= s.size()) { err = "unterminated top-level object"; return fail(); }
+		if (s[i] == ',') { ++i; continue; }
+		if (s[i] == '}') { ++i; break; }
+		err = "expected ',' or '}' in top-level object";
+		return fail();
+	}
+
+	if (!foundFiles)
+	{
+		err = "missing 'files' key";
+		return fail();
+	}
+	// Empty files list is allowed but likely an error; keep it as failure to be safe.
+	if (outWorkList.empty())
+	{
+		err = "'files' array is empty";
+		return fail();
+	}
+
+	std::sort(outWorkList.begin(), outWorkList.end(),
+		[](const ManifestEntry& a, const ManifestEntry& b) { return a.relPath < b.relPath; });
+	for (size_t k = 1; k < outWorkList.size(); ++k)
+	{
+		if (outWorkList[k].relPath == outWorkList[k - 1].relPath)
+		{
+			invalid = true;
+			err = "duplicate path in manifest: " + std::string(outWorkList[k].relPath);
+			return fail();
+		}
+	}
+	return true;
+}
+
+
+static bool CrackUrlWinHttp(const std::string& urlUtf8, std::wstring& outHost, std::wstring& outPath, INTERNET_PORT& outPort, bool& outSecure, std::string* outErr)
+{
+	outHost.clear();
+	outPath.clear();
+	outPort = 0;
+	outSecure = false;
+
+	std::wstring url = Utf8ToWide(urlUtf8);
+	URL_COMPONENTS uc{};
+	uc.dwStructSize = sizeof(uc);
+	uc.dwHostNameLength = (DWORD)-1;
+	uc.dwUrlPathLength = (DWORD)-1;
+	uc.dwExtraInfoLength = (DWORD)-1;
+
+	if (!WinHttpCrackUrl(url.c_str(), 0, 0, &uc))
+	{
+		if (outErr) *outErr = "WinHttpCrackUrl failed (" + std::to_string(GetLastError()) + ")";
+		return false;
+	}
+
+	if (uc.nScheme != INTERNET_SCHEME_HTTP && uc.nScheme != INTERNET_SCHEME_HTTPS)
+	{
+		if (outErr) *outErr = "Unsupported URL scheme (only http/https allowed)";
+		return false;
+	}
+
+	outSecure = (uc.nScheme == INTERNET_SCHEME_HTTPS);
+	outPort = uc.nPort;
+	outHost.assign(uc.lpszHostName, uc.dwHostNameLength);
+
+	// Path = url-path + extra-info (query/fragment). We keep query; callers may strip if desired.
+	outPath.assign(uc.lpszUrlPath, uc.dwUrlPathLength);
+	if (uc.dwExtraInfoLength > 0 && uc.lpszExtraInfo)
 		outPath.append(uc.lpszExtraInfo, uc.dwExtraInfoLength);
 
 	if (outPath.empty()) outPath = L"/";
 	return true;
 }
 
+// --------------------------------------------------
+// Minimal inflate (RFC 1951) with gzip (RFC 1952) / zlib (RFC 1950) wrappers
+// - Used for the pre-compressed *.json.gz manifests, and for Content-Encoding
+//   gzip/deflate responses when WinHTTP cannot decompress for us (before Windows 8.1).
+// - Output is capped by the caller's size limit, so a small compressed body cannot
+//   expand past the same caps that apply to uncompressed downloads.
+// --------------------------------------------------
+struct InflateHuffman
+{
+	short count[16];    // number of codes of each length
+	short symbol[288];  // symbols ordered by code
+};
+struct InflateState
+{
+	const unsigned char* in = nullptr;
+	size_t inLen = 0;
+	size_t inPos = 0;
+	unsigned long bitBuf = 0;
+	int bitCnt = 0;
+	std::string* out = nullptr;
+	size_t maxOut = 0;
+	bool overflow = false;
+};
+static bool InflateBits(InflateState& s, int need, int& outVal)
+{
+	unsigned long val = s.bitBuf;
+	while (s.bitCnt < need)
+	{
+		if (s.inPos >= s.inLen) return false;
+		val |= (unsigned long)s.in[s.inPos++] << s.bitCnt;
+		s.bitCnt += 8;
+	}
+	s.bitBuf = val >> need;
+	s.bitCnt -= need;
+	outVal = (int)(val & ((1UL << need) - 1));
+	return true;
+}
+static bool InflateBuild(InflateHuffman& h, const short* lengths, int n)
+{
+	for (int len = 0; len < 16; ++len) h.count[len] = 0;
+	for (int sym = 0; sym < n; ++sym) h.count[lengths[sym]]++;
+	if (h.count[0] == n) return true;   // no codes; any decode attempt will fail
+
+	int left = 1;
+	for (int len = 1; len < 16; ++len)
+	{
+		left <<= 1;
+		left -= h.count[len];
+		if (left < 0) return false;      // over-subscribed
+	}
+	short offs[16];
+	offs[1] = 0;
+	for (int len = 1; len < 15; ++len) offs[len + 1] = (short)(offs[len] + h.count[len]);
+	for (int sym = 0; sym < n; ++sym)
+	{
+		if (lengths[sym] != 0) h.symbol[offs[lengths[sym]]++] = (short)sym;
+	}
+	return true;
+}
+static int InflateDecode(InflateState& s, const InflateHuffman& h)
+{
+	int code = 0, first = 0, index = 0;
+	for (int len = 1; len < 16; ++len)
+	{
+		int bit = 0;
+		if (!InflateBits(s, 1, bit)) return -1;
+		code |= bit;
+		const int count = h.count[len];
+		if (code - count < first) return h.symbol[index + (code - first)];
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+static bool InflateStored(InflateState& s)
+{
+	s.bitBuf = 0;   // stored blocks start on a byte boundary
+	s.bitCnt = 0;
+	if (s.inPos + 4 > s.inLen) return false;
+	const unsigned len = s.in[s.inPos] | ((unsigned)s.in[s.inPos + 1] << 8);
+	const unsigned nlen = s.in[s.inPos + 2] | ((unsigned)s.in[s.inPos + 3] << 8);
+	if (len != (~nlen & 0xFFFFu)) return false;
+	s.inPos += 4;
+	if (s.inPos + len > s.inLen) return false;
+	if (s.out->size() + len > s.maxOut) { s.overflow = true; return false; }
+	s.out->append((const char*)s.in + s.inPos, len);
+	s.inPos += len;
+	return true;
+}
+static bool InflateCodes(InflateState& s, const InflateHuffman& lencode, const InflateHuffman& distcode)
+{
+	static const short kLenBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+	static const short kLenExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+	static const short kDistBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+	static const short kDistExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+	std::string& out = *s.out;
+	for (;;)
+	{
+		int sym = InflateDecode(s, lencode);
+		if (sym < 0) return false;
+		if (sym < 256)
+		{
+			if (out.size() >= s.maxOut) { s.overflow = true; return false; }
+			out.push_back((char)sym);
+			continue;
+		}
+		if (sym == 256) return true;
+
+		sym -= 257;
+		if (sym >= 29) return false;
+		int extra = 0;
+		if (!InflateBits(s, kLenExtra[sym], extra)) return false;
+		const size_t len = (size_t)(kLenBase[sym] + extra);
+
+		const int dsym = InflateDecode(s, distcode);
+		if (dsym < 0 || dsym >= 30) return false;
+		if (!InflateBits(s, kDistExtra[dsym], extra)) return false;
+		const size_t dist = (size_t)(kDistBase[dsym] + extra);
+		if (dist > out.size()) return false;
+		if (out.size() + len > s.maxOut) { s.overflow = true; return false; }
+
+		// Byte-wise copy: source and destination may overlap (dist < len).
+		const size_t from = out.size() - dist;
+		for (size_t k = 0; k < len; ++k) out.push_back(out[from + k]);
+	}
+}
+static bool InflateFixed(InflateState& s)
+{
+	InflateHuffman lencode{}, distcode{};
+	short lengths[288];
+	int sym = 0;
+	for (; sym < 144; ++sym) lengths[sym] = 8;
+	for (; sym < 256; ++sym) lengths[sym] = 9;
+	for (; sym < 280; ++sym) lengths[sym] = 7;
+	for (; sym < 288; ++sym) lengths[sym] = 8;
+	InflateBuild(lencode, lengths, 288);
+	for (sym = 0; sym < 30; ++sym) lengths[sym] = 5;
+	InflateBuild(distcode, lengths, 30);
+	return InflateCodes(s, lencode, distcode);
+}
+static bool InflateDynamic(InflateState& s)
+{
+	static const short kOrder[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+	int nlen = 0, ndist = 0, ncode = 0;
+	if (!InflateBits(s, 5, nlen) || !InflateBits(s, 5, ndist) || !InflateBits(s, 4, ncode)) return false;
+	nlen += 257;
+	ndist += 1;
+	ncode += 4;
+	if (nlen > 286 || ndist > 30) return false;
+
+	short lengths[320]{};
+	for (int i = 0; i < ncode; ++i)
+	{
+		int v = 0;
+		if (!InflateBits(s, 3, v)) return false;
+		lengths[kOrder[i]] = (short)v;
+	}
+	InflateHuffman lencode{}, distcode{};
+	if (!InflateBuild(lencode, lengths, 19)) return false;
+
+	int index = 0;
+	while (index < nlen + ndist)
+	{
+		int sym = InflateDecode(s, lencode);
+		if (sym < 0) return false;
+		if (sym < 16)
+		{
+			lengths[index++] = (short)sym;
+			continue;
+		}
+		short len = 0;
+		int rep = 0;
+		if (sym == 16)
+		{
+			if (index == 0) return false;
+			len = lengths[index - 1];
+			if (!InflateBits(s, 2, rep)) return false;
+			rep += 3;
+		}
+		else if (sym == 17)
+		{
+			if (!InflateBits(s, 3, rep)) return false;
+			rep += 3;
+		}
+		else
+		{
+			if (!InflateBits(s, 7, rep)) return false;
+			rep += 11;
+		}
+		if (index + rep > nlen + ndist) return false;
+		while (rep-- > 0) lengths[index++] = len;
+	}
+	if (lengths[256] == 0) return false;   // no end-of-block code
+	if (!InflateBuild(lencode, lengths, nlen)) return false;
+	if (!InflateBuild(distcode, lengths + nlen, ndist)) return false;
+	return InflateCodes(s, lencode, distcode);
+}
+static bool InflateRaw(const unsigned char* in, size_t inLen, size_t* outConsumed, std::string& out, size_t maxOut, std::string* outErr)
+{
+	InflateState s;
+	s.in = in;
+	s.inLen = inLen;
+	s.out = &out;
+	s.maxOut = maxOut;
+
+	int last = 0;
+	do
+	{
+		int type = 0;
+		if (!InflateBits(s, 1, last) || !InflateBits(s, 2, type))
+		{
+			if (outErr) *outErr = "Compressed data is truncated";
+			return false;
+		}
+		bool ok = false;
+		if (type == 0) ok = InflateStored(s);
+		else if (type == 1) ok = InflateFixed(s);
+		else if (type == 2) ok = InflateDynamic(s);
+		if (!ok)
+		{
+			if (outErr) *outErr = s.overflow ? "Decompressed data exceeds size limit" : "Invalid compressed data";
+			return false;
+		}
+	} while (!last);
+
+	if (outConsumed) *outConsumed = s.inPos;   // any partial byte left in bitBuf belongs to this stream
+	return true;
+}
+static uint32_t Crc32Update(uint32_t crc, const unsigned char* data, size_t size)
+{
+	static uint32_t table[256] = {};
+	static std::once_flag once;
+	std::call_once(once, []() {
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+			table[i] = c;
+		}
+	});
+	crc ^= 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+static bool GzipDecompress(const std::string& in, std::string& out, size_t maxOut, std::string* outErr)
+{
+	out.clear();
+	const unsigned char* p = (const unsigned char*)in.data();
+	const size_t n = in.size();
+	if (n < 18 || p[0] != 0x1F || p[1] != 0x8B || p[2] != 8)
+	{
+		if (outErr) *outErr = "Not a gzip stream";
+		return false;
+	}
+	const unsigned char flags = p[3];
+	size_t pos = 10;
+	if (flags & 0x04)   // FEXTRA
+	{
+		if (pos + 2 > n) { if (outErr) *outErr = "Truncated gzip header"; return false; }
+		pos += 2 + (size_t)(p[pos] | (p[pos + 1] << 8));
+	}
+	if (flags & 0x08) { while (pos < n && p[pos] != 0) ++pos; ++pos; }   // FNAME
+	if (flags & 0x10) { while (pos < n && p[pos] != 0) ++pos; ++pos; }   // FCOMMENT
+	if (flags & 0x02) pos += 2;                                           // FHCRC
+	if (pos >= n) { if (outErr) *outErr = "Truncated gzip header"; return false; }
+
+	size_t consumed = 0;
+	if (!InflateRaw(p + pos, n - pos, &consumed, out, maxOut, outErr))
+		return false;
+	pos += consumed;
+	if (pos + 8 > n) { if (outErr) *outErr = "Truncated gzip trailer"; return false; }
+
+	const uint32_t crc = (uint32_t)p[pos] | ((uint32_t)p[pos + 1] << 8) | ((uint32_t)p[pos + 2] << 16) | ((uint32_t)p[pos + 3] << 24);
+	const uint32_t isize = (uint32_t)p[pos + 4] | ((uint32_t)p[pos + 5] << 8) | ((uint32_t)p[pos + 6] << 16) | ((uint32_t)p[pos + 7] << 24);
+	if (isize != (uint32_t)(out.size() & 0xFFFFFFFFu) || crc != Crc32Update(0, (const unsigned char*)out.data(), out.size()))
+	{
+		out.clear();
+		if (outErr) *outErr = "gzip CRC/size check failed";
+		return false;
+	}
+	return true;
+}
+// HTTP "deflate" is specified as zlib-wrapped, but some servers send raw deflate; accept both.
+static bool HttpDeflateDecompress(const std::string& in, std::string& out, size_t maxOut, std::string* outErr)
+{
+	out.clear();
+	const unsigned char* p = (const unsigned char*)in.data();
+	const size_t n = in.size();
+	const bool zlibWrapped = n >= 2 && (p[0] & 0x0F) == 8 && (p[0] >> 4) <= 7 && (((unsigned)p[0] << 8) | p[1]) % 31 == 0 && !(p[1] & 0x20);
+	if (zlibWrapped)
+		return InflateRaw(p + 2, n - 2, nullptr, out, maxOut, outErr);
+	return InflateRaw(p, n, nullptr, out, maxOut, outErr);
+}
+
+// --------------------------------------------------
+// Shared WinHTTP client
+// - One long-lived session for the whole process, plus one connect handle per host:port.
+// - WinHTTP pools keep-alive connections per session, so sharing it means each request
+//   after the first one to a host reuses an open TLS connection instead of a new handshake.
+// - On Windows 10 1607+ HTTP/2 is negotiated (ALPN) so parallel sync workers multiplex
+//   over one connection; older systems silently stay on HTTP/1.1 keep-alive.
+// - Only session/connect handles are shared. Each caller still opens its own request
+//   handle and applies its own redirect policy, timeouts and size caps.
+// --------------------------------------------------
+#ifndef WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL
+#define WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL 133
+#endif
+#ifndef WINHTTP_PROTOCOL_FLAG_HTTP2
+#define WINHTTP_PROTOCOL_FLAG_HTTP2 0x1
+#endif
+struct WinHttpClient
+{
+	std::mutex lock;   // guards session + connections
+	WinHttpHandle session;
+	std::vector<std::pair<std::wstring, WinHttpHandle>> connections;   // key: "host:port"
+
+	WinHttpHandle OpenRequest(const std::wstring& host, INTERNET_PORT port, const std::wstring& path, bool secure, std::string* outErr)
+	{
+		HINTERNET hConnect = GetConnection(host, port, outErr);
+		if (!hConnect)
+			return WinHttpHandle{};
+
+		WinHttpHandle request(WinHttpOpenRequest(
+			hConnect,
+			L"GET",
+			path.c_str(),
+			nullptr,
+			WINHTTP_NO_REFERER,
+			WINHTTP_DEFAULT_ACCEPT_TYPES,
+			secure ? WINHTTP_FLAG_SECURE : 0));
+		if (!request && outErr)
+			*outErr = "WinHttpOpenRequest failed (" + std::to_string(GetLastError()) + ")";
+		return request;
+	}
+
+private:
+	bool EnsureSessionLocked(std::string* outErr)
+	{
+		if (session)
+			return true;
+		session = WinHttpHandle(WinHttpOpen(
+			AppConstants::kUserAgentW,
+			WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+			WINHTTP_NO_PROXY_NAME,
+			WINHTTP_NO_PROXY_BYPASS,
+			0));
+		if (!session)
+		{
+			if (outErr) *outErr = "WinHttpOpen failed (" + std::to_string(GetLastError()) + ")";
+			return false;
+		}
+
+		// Let every sync worker keep its own pooled connection (HTTP/1.1 fallback path).
+		DWORD maxConns = (DWORD)AppConstants::kMaxDownloadWorkers;
+		(void)WinHttpSetOption((HINTERNET)session.get(), WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &maxConns, sizeof(maxConns));
+		(void)WinHttpSetOption((HINTERNET)session.get(), WINHTTP_OPTION_MAX_CONNS_PER_1_0_SERVER, &maxConns, sizeof(maxConns));
+
+		// Fails with ERROR_WINHTTP_INVALID_OPTION before Windows 10 1607; that is fine.
+		DWORD protocols = WINHTTP_PROTOCOL_FLAG_HTTP2;
+		(void)WinHttpSetOption((HINTERNET)session.get(), WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL, &protocols, sizeof(protocols));
+		return true;
+	}
+
+	HINTERNET GetConnection(const std::wstring& host, INTERNET_PORT port, std::string* outErr)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!EnsureSessionLocked(outErr))
+			return nullptr;
+
+		const std::wstring key = host + L":" + std::to_wstring(port);
+		for (const auto& c : connections)
+		{
+			if (c.first == key)
+				return (HINTERNET)c.second.get();
+		}
+
+		WinHttpHandle connect(WinHttpConnect((HINTERNET)session.get(), host.c_str(), port, 0));
+		if (!connect)
+		{
+			if (outErr) *outErr = "WinHttpConnect failed (" + std::to_string(GetLastError()) + ")";
+			return nullptr;
+		}
+		HINTERNET h = (HINTERNET)connect.get();
+		connections.emplace_back(key, std::move(connect));
+		return h;
+	}
+};
+static WinHttpClient& SharedHttpClient()
+{
+	static WinHttpClient client;
+	return client;
+}
+
 // --------------------------------------------------
 // WinHTTP (no redirects; treat redirects as errors)
 // --------------------------------------------------
+#ifndef WINHTTP_OPTION_DECOMPRESSION
+#define WINHTTP_OPTION_DECOMPRESSION 118
+#endif
+#ifndef WINHTTP_DECOMPRESSION_FLAG_ALL
+#define WINHTTP_DECOMPRESSION_FLAG_ALL 0x00000003
+#endif
 struct WinHttpGetCtx
 {
-	WinHttpHandle session;
-	WinHttpHandle connect;
-	WinHttpHandle request;
+	WinHttpHandle request;   // session/connect are owned by SharedHttpClient()
+	std::string contentEncoding;   // lowercase; set only when the caller must decode the body itself
+	long long contentLength = -1;  // Content-Length of the (possibly partial) body; -1 = not sent
 };
+static std::string WinHttpQueryHeaderUtf8(HINTERNET hRequest, DWORD infoLevel)
+{
+	DWORD size = 0;
+	WinHttpQueryHeaders(hRequest, infoLevel, WINHTTP_HEADER_NAME_BY_INDEX, WINHTTP_NO_OUTPUT_BUFFER, &size, WINHTTP_NO_HEADER_INDEX);
+	if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || size == 0)
+		return std::string();
+	std::vector<wchar_t> buf(size / sizeof(wchar_t) + 1, L'\0');
+	if (!WinHttpQueryHeaders(hRequest, infoLevel, WINHTTP_HEADER_NAME_BY_INDEX, buf.data(), &size, WINHTTP_NO_HEADER_INDEX))
+		return std::string();
+	return WideToUtf8(std::wstring(buf.data(), size / sizeof(wchar_t)));
+}
 
 static bool WinHttpOpenGet_NoRedirects(
 	const std::string& urlUtf8,
@@ -3558,11 +5034,23 @@ static bool WinHttpOpenGet_NoRedirects(
 	long connectTimeoutMs,
 	long totalTimeoutMs,
 	std::string* outErr,
-	long* outHttp)
+	long* outHttp,
+	HttpConditional* cond = nullptr,
+	bool acceptCompressed = false,
+	HttpRangeRequest* range = nullptr)
 {
 	if (outErr) outErr->clear();
 	if (outHttp) *outHttp = 0;
 	out = WinHttpGetCtx{};
+	if (range)
+	{
+		range->partial = false;
+		range->notSatisfiable = false;
+		range->respValidator.clear();
+		range->contentType.clear();
+		range->contentRange.clear();
+	}
+	const bool ranged = range && (range->offset > 0 || !range->spans.empty());
 
 	std::wstring host, path;
 	INTERNET_PORT port = 0;
@@ -3570,39 +5058,9 @@ static bool WinHttpOpenGet_NoRedirects(
 	if (!CrackUrlWinHttp(urlUtf8, host, path, port, secure, outErr))
 		return false;
 
-	out.session = WinHttpHandle(WinHttpOpen(
-		Utf8ToWide(AppConstants::kUserAgent).c_str(),
-		WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-		WINHTTP_NO_PROXY_NAME,
-		WINHTTP_NO_PROXY_BYPASS,
-		0));
-	if (!out.session)
-	{
-		if (outErr) *outErr = "WinHttpOpen failed (" + std::to_string(GetLastError()) + ")";
-		return false;
-	}
-
-	out.connect = WinHttpHandle(WinHttpConnect((HINTERNET)out.session.get(), host.c_str(), port, 0));
-	if (!out.connect)
-	{
-		if (outErr) *outErr = "WinHttpConnect failed (" + std::to_string(GetLastError()) + ")";
-		return false;
-	}
-
-	DWORD flags = secure ? WINHTTP_FLAG_SECURE : 0;
-	out.request = WinHttpHandle(WinHttpOpenRequest(
-		(HINTERNET)out.connect.get(),
-		L"GET",
-		path.c_str(),
-		nullptr,
-		WINHTTP_NO_REFERER,
-		WINHTTP_DEFAULT_ACCEPT_TYPES,
-		flags));
+	out.request = SharedHttpClient().OpenRequest(host, port, path, secure, outErr);
 	if (!out.request)
-	{
-		if (outErr) *outErr = "WinHttpOpenRequest failed (" + std::to_string(GetLastError()) + ")";
 		return false;
-	}
 
 	// Treat redirects as errors.
 	DWORD redirectPolicy = WINHTTP_OPTION_REDIRECT_POLICY_NEVER;
@@ -3617,7 +5075,41 @@ static bool WinHttpOpenGet_NoRedirects(
 
 	if (cancel.IsCanceled()) { if (outErr) *outErr = "Canceled"; return false; }
 
-	if (!WinHttpSendRequest((HINTERNET)out.request.get(), WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0))
+	// Compressed transfer (text callers only). Windows 8.1+ WinHTTP negotiates and inflates
+	// transparently; older systems reject the option, so we ask ourselves and decode later.
+	bool autoDecompress = false;
+	std::wstring extraHeaders;
+	if (acceptCompressed)
+	{
+		DWORD decompression = WINHTTP_DECOMPRESSION_FLAG_ALL;
+		autoDecompress = WinHttpSetOption((HINTERNET)out.request.get(), WINHTTP_OPTION_DECOMPRESSION, &decompression, sizeof(decompression)) != FALSE;
+		if (!autoDecompress)
+			extraHeaders += L"Accept-Encoding: gzip, deflate\r\n";
+	}
+	if (cond)
+	{
+		cond->notModified = false;
+		cond->respEtag.clear();
+		cond->respLastModified.clear();
+		if (!cond->etag.empty())
+			extraHeaders += L"If-None-Match: " + Utf8ToWide(cond->etag) + L"\r\n";
+		if (!cond->lastModified.empty())
+			extraHeaders += L"If-Modified-Since: " + Utf8ToWide(cond->lastModified) + L"\r\n";
+	}
+	if (range && !range->spans.empty())
+		extraHeaders += L"Range: bytes=" + Utf8ToWide(range->spans) + L"\r\n";
+	else if (range && range->offset > 0)
+	{
+		extraHeaders += L"Range: bytes=" + std::to_wstring(range->offset) + L"-\r\n";
+		if (!range->ifRange.empty())
+			extraHeaders += L"If-Range: " + Utf8ToWide(range->ifRange) + L"\r\n";
+	}
+	LARGE_INTEGER sendStart{};
+	QueryPerformanceCounter(&sendStart);
+	if (!WinHttpSendRequest((HINTERNET)out.request.get(),
+		extraHeaders.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : extraHeaders.c_str(),
+		extraHeaders.empty() ? 0 : (DWORD)-1L,
+		WINHTTP_NO_REQUEST_DATA, 0, 0, 0))
 	{
 		if (outErr) *outErr = "WinHttpSendRequest failed (" + std::to_string(GetLastError()) + ")";
 		return false;
@@ -3627,6 +5119,21 @@ static bool WinHttpOpenGet_NoRedirects(
 		if (outErr) *outErr = "WinHttpReceiveResponse failed (" + std::to_string(GetLastError()) + ")";
 		return false;
 	}
+	{
+		LARGE_INTEGER headersAt{};
+		QueryPerformanceCounter(&headersAt);
+		// sin_port and sin6_port share offset 2 (network byte order).
+		WINHTTP_CONNECTION_INFO conn{};
+		conn.cbSize = sizeof(conn);
+		DWORD connSize = sizeof(conn);
+		unsigned localPort = 0;
+		if (WinHttpQueryOption((HINTERNET)out.request.get(), WINHTTP_OPTION_CONNECTION_INFO, &conn, &connSize))
+		{
+			const unsigned char* sa = reinterpret_cast<const unsigned char*>(&conn.LocalAddress);
+			localPort = ((unsigned)sa[2] << 8) | sa[3];
+		}
+		PerfNoteRequest(headersAt.QuadPart - sendStart.QuadPart, localPort);
+	}
 
 	DWORD status = 0;
 	DWORD statusSize = sizeof(status);
@@ -3639,17 +5146,88 @@ static bool WinHttpOpenGet_NoRedirects(
 
 	if (outHttp) *outHttp = (long)status;
 
+	// 304 is only meaningful (and only accepted) when we actually sent validators.
+	if (status == 304 && cond && (!cond->etag.empty() || !cond->lastModified.empty()))
+	{
+		cond->notModified = true;
+		return true;
+	}
 	if (status >= 300 && status < 400)
 	{
 		if (outErr) *outErr = "HTTP redirect received; redirects are treated as errors";
 		return false;
 	}
+	if (status == 416 && ranged)
+	{
+		range->notSatisfiable = true;
+		if (outErr) *outErr = "HTTP status 416 (requested range not satisfiable)";
+		return false;
+	}
 	if (status < 200 || status >= 300)
 	{
 		if (outErr) *outErr = "HTTP status " + std::to_string(status);
 		return false;
 	}
+	if (status == 206 && !ranged)
+	{
+		if (outErr) *outErr = "HTTP 206 received for a request without Range";
+		return false;
+	}
+	if (range)
+	{
+		// Weak ETags are not allowed in If-Range; fall back to the date validator then.
+		const std::string etag = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_ETAG);
+		range->respValidator = (!etag.empty() && !StartsWith(etag, "W/"))
+			? etag
+			: WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_LAST_MODIFIED);
+		if (status == 206 && !range->spans.empty())
+		{
+			range->contentType = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_CONTENT_TYPE);
+			range->contentRange = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_CONTENT_RANGE);
+			range->partial = true;
+		}
+		else if (status == 206)
+		{
+			// "bytes <first>-<last>/<total>": the body must start exactly where our bytes end.
+			const std::string cr = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_CONTENT_RANGE);
+			unsigned long long first = 0;
+			bool okRange = false;
+			if (cr.size() > 6 && EqualIcaseAscii(cr.substr(0, 6), "bytes "))
+			{
+				const char* p = cr.c_str() + 6;
+				while (*p == ' ') ++p;
+				char* end = nullptr;
+				first = strtoull(p, &end, 10);
+				okRange = (end != p && *end == '-');
+			}
+			if (!okRange || first != range->offset)
+			{
+				if (outErr) *outErr = "Unexpected Content-Range in 206 reply: " + cr;
+				return false;
+			}
+			range->partial = true;
+		}
+	}
 
+	if (acceptCompressed && !autoDecompress)
+	{
+		std::string enc = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_CONTENT_ENCODING);
+		enc.erase(std::remove_if(enc.begin(), enc.end(), [](char c) { return c == ' ' || c == '\t'; }), enc.end());
+		std::transform(enc.begin(), enc.end(), enc.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+		out.contentEncoding = enc;
+	}
+	{
+		const std::string len = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_CONTENT_LENGTH);
+		char* end = nullptr;
+		const unsigned long long n = len.empty() ? 0 : strtoull(len.c_str(), &end, 10);
+		if (!len.empty() && end && *end == '\0')
+			out.contentLength = (long long)n;
+	}
+	if (cond)
+	{
+		cond->respEtag = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_ETAG);
+		cond->respLastModified = WinHttpQueryHeaderUtf8((HINTERNET)out.request.get(), WINHTTP_QUERY_LAST_MODIFIED);
+	}
 	return true;
 }
 
@@ -3685,16 +5263,18 @@ static bool WinHttpReadAllToString(
 			return false;
 		}
 
-		std::vector<char> buf(avail);
+		// Read straight into the tail of the body: no per-chunk buffer.
+		const size_t at = body.size();
+		body.resize(at + (size_t)avail);
 		DWORD read = 0;
-		if (!WinHttpReadData(hRequest, buf.data(), avail, &read))
+		if (!WinHttpReadData(hRequest, &body[at], avail, &read))
 		{
 			if (outErr) *outErr = "WinHttpReadData failed (" + std::to_string(GetLastError()) + ")";
 			return false;
 		}
+		body.resize(at + (size_t)read);
 		if (read == 0) break;
-
-		body.append(buf.data(), buf.data() + read);
+		PerfNoteReceivedBytes(read);
 	}
 
 	outBody.swap(body);
@@ -3708,15 +5288,38 @@ static bool WinHttpGetToString_NoRedirects(
 	long connectTimeoutMs,
 	long totalTimeoutMs,
 	std::string* outErr,
-	long* outHttp)
+	long* outHttp,
+	HttpConditional* cond = nullptr)
 {
+	outBody.clear();
 	WinHttpGetCtx ctx;
-	if (!WinHttpOpenGet_NoRedirects(urlUtf8, ctx, cancel, connectTimeoutMs, totalTimeoutMs, outErr, outHttp))
+	if (!WinHttpOpenGet_NoRedirects(urlUtf8, ctx, cancel, connectTimeoutMs, totalTimeoutMs, outErr, outHttp, cond, true))
 		return false;
+	if (cond && cond->notModified)
+		return true;
 
 	// Text downloads should be small (manifest/version). Cap defensively.
-	return WinHttpReadAllToString((HINTERNET)ctx.request.get(), outBody, cancel,
-		static_cast<size_t>(AppConstants::kMaxTextDownloadBytes), outErr);
+	// With WinHTTP decompression the cap already applies to the inflated bytes; for our own
+	// decoder it applies to both the compressed body and the inflated output.
+	const size_t cap = static_cast<size_t>(AppConstants::kMaxTextDownloadBytes);
+	if (!WinHttpReadAllToString((HINTERNET)ctx.request.get(), outBody, cancel, cap, outErr))
+		return false;
+	if (ctx.contentEncoding.empty() || ctx.contentEncoding == "identity")
+		return true;
+
+	std::string inflated;
+	bool ok = false;
+	if (ctx.contentEncoding == "gzip" || ctx.contentEncoding == "x-gzip")
+		ok = GzipDecompress(outBody, inflated, cap, outErr);
+	else if (ctx.contentEncoding == "deflate")
+		ok = HttpDeflateDecompress(outBody, inflated, cap, outErr);
+	else if (outErr)
+		*outErr = "Unsupported Content-Encoding: " + ctx.contentEncoding;
+	outBody.clear();
+	if (!ok)
+		return false;
+	outBody.swap(inflated);
+	return true;
 }
 
 
@@ -3748,13 +5351,240 @@ static Status WinHttpGetToString_NoRedirects_Status(
 }
 
 
-static bool DownloadUrl(const std::string& url, std::string& out, const CancelToken& cancel, std::string* outErr = nullptr, long* outHttp = nullptr)
+// --------------------------------------------------
+// HTTP validator cache (MapPackSyncTool_cache\, next to the INI)
+// - Per URL: <key>.meta holds the URL, ETag, Last-Modified and SHA-256 of the body we hold.
+//   Text resources also keep <key>.body; support files use the real local file as the body.
+// - A cached body is only served when its SHA-256 still matches the .meta record.
+// - Best effort: if the folder is not writable we simply keep doing full downloads.
+// --------------------------------------------------
+static std::mutex g_httpCacheLock;   // startup check and sync worker can fetch the same URL
+static fs::path HttpCacheFileBase(const std::string& url)
 {
-	const long connectMs = AppConstants::kManifestConnectTimeoutSec * 1000L;
-	const long totalMs = AppConstants::kManifestTimeoutSec * 1000L;
-	return WinHttpGetToString_NoRedirects(url, out, cancel, connectMs, totalMs, outErr, outHttp);
+	std::string key;
+	if (!Sha256StringHexLower(url, key)) return fs::path();
+	return fs::path(GetSettingsIniPath()).parent_path() / kHttpCacheDirName / Utf8ToWide(key);
 }
-static std::string JoinUrl(const std::string& base, const std::string& path)
+static std::string StripHeaderUnsafeChars(std::string s)
+{
+	// Values end up in our own request headers; never let CR/LF through.
+	s.erase(std::remove_if(s.begin(), s.end(), [](char c) { return c == '\r' || c == '\n'; }), s.end());
+	return s;
+}
+static bool HttpCacheLoadMeta(const std::string& url, HttpCacheMeta& out)
+{
+	out = HttpCacheMeta{};
+	fs::path base = HttpCacheFileBase(url);
+	if (base.empty()) return false;
+	fs::path metaPath = base;
+	metaPath += L".meta";
+
+	std::lock_guard<std::mutex> guard(g_httpCacheLock);
+	std::ifstream f(metaPath, std::ios::binary);
+	if (!f) return false;
+	std::string line;
+	while (std::getline(f, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		const size_t tab = line.find('\t');
+		if (tab == std::string::npos) continue;
+		const std::string k = line.substr(0, tab);
+		const std::string v = StripHeaderUnsafeChars(line.substr(tab + 1));
+		if (k == "url") out.url = v;
+		else if (k == "etag") out.etag = v;
+		else if (k == "last-modified") out.lastModified = v;
+		else if (k == "sha256") out.sha256 = v;
+	}
+	if (out.url != url || !IsHex64(out.sha256) || (out.etag.empty() && out.lastModified.empty()))
+	{
+		out = HttpCacheMeta{};
+		return false;
+	}
+	return true;
+}
+static bool HttpCacheWriteFileAtomic(const fs::path& path, const std::string& bytes)
+{
+	fs::path tmp = path;
+	tmp += L".tmp";
+	{
+		std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+		if (!f) return false;
+		f.write(bytes.data(), (std::streamsize)bytes.size());
+		if (!f) { f.close(); std::error_code ec; fs::remove(tmp, ec); return false; }
+	}
+	if (!MoveReplace(tmp, path))
+	{
+		std::error_code ec;
+		fs::remove(tmp, ec);
+		return false;
+	}
+	return true;
+}
+static void HttpCacheStore(const std::string& url, const HttpConditional& cond, const std::string& sha256, const std::string* body)
+{
+	fs::path base = HttpCacheFileBase(url);
+	if (base.empty() || !IsHex64(sha256)) return;
+	fs::path metaPath = base; metaPath += L".meta";
+	fs::path bodyPath = base; bodyPath += L".body";
+
+	const std::string etag = StripHeaderUnsafeChars(cond.respEtag);
+	const std::string lastModified = StripHeaderUnsafeChars(cond.respLastModified);
+
+	std::lock_guard<std::mutex> guard(g_httpCacheLock);
+	std::error_code ec;
+	if (etag.empty() && lastModified.empty())
+	{
+		// Server sent no validators; a stale record would only cause wasted conditional requests.
+		fs::remove(metaPath, ec);
+		fs::remove(bodyPath, ec);
+		return;
+	}
+	fs::create_directories(base.parent_path(), ec);
+	if (ec) return;
+	if (body && !HttpCacheWriteFileAtomic(bodyPath, *body))
+		return;
+	const std::string meta = "url\t" + url + "\r\netag\t" + etag + "\r\nlast-modified\t" + lastModified + "\r\nsha256\t" + sha256 + "\r\n";
+	(void)HttpCacheWriteFileAtomic(metaPath, meta);
+}
+static bool HttpCacheLoadBody(const std::string& url, const HttpCacheMeta& meta, std::string& outBody)
+{
+	outBody.clear();
+	fs::path bodyPath = HttpCacheFileBase(url);
+	if (bodyPath.empty()) return false;
+	bodyPath += L".body";
+
+	{
+		std::lock_guard<std::mutex> guard(g_httpCacheLock);
+		std::ifstream f(bodyPath, std::ios::binary);
+		if (!f) return false;
+		std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		if (data.size() > (size_t)AppConstants::kMaxTextDownloadBytes) return false;
+		outBody.swap(data);
+	}
+	std::string sha;
+	if (!Sha256StringHexLower(outBody, sha) || sha != meta.sha256)
+	{
+		outBody.clear();
+		return false;
+	}
+	return true;
+}
+static void HttpCacheRememberFile(const std::string& url, const HttpConditional& cond, const fs::path& file)
+{
+	std::string sha;
+	if (Sha256FileHexLower(file, sha))
+		HttpCacheStore(url, cond, sha, nullptr);
+}
+// <key>.missing: the URL answered 403/404 (kept across sessions, re-checked after maxAgeMs).
+static bool HttpCacheRecentlyMissing(const std::string& url, unsigned long long maxAgeMs)
+{
+	fs::path path = HttpCacheFileBase(url);
+	if (path.empty()) return false;
+	path += L".missing";
+	std::lock_guard<std::mutex> guard(g_httpCacheLock);
+	std::error_code ec;
+	const auto written = fs::last_write_time(path, ec);
+	if (ec) return false;
+	const auto age = std::chrono::duration_cast<std::chrono::milliseconds>(fs::file_time_type::clock::now() - written).count();
+	return age >= 0 && (unsigned long long)age < maxAgeMs;
+}
+static void HttpCacheRememberMissing(const std::string& url)
+{
+	fs::path path = HttpCacheFileBase(url);
+	if (path.empty()) return;
+	path += L".missing";
+	std::lock_guard<std::mutex> guard(g_httpCacheLock);
+	std::error_code ec;
+	fs::create_directories(path.parent_path(), ec);
+	std::ofstream f(path, std::ios::binary | std::ios::trunc);
+}
+
+static bool DownloadUrlCached(const std::string& url, std::string& out, const CancelToken& cancel, std::string* outErr, long* outHttp)
+{
+	const long connectMs = AppConstants::kManifestConnectTimeoutSec * 1000L;
+	const long totalMs = AppConstants::kManifestTimeoutSec * 1000L;
+
+	// Manifests rarely change: revalidate against the cached copy instead of re-downloading it.
+	HttpConditional cond;
+	HttpCacheMeta meta;
+	std::string cachedBody;
+	if (HttpCacheLoadMeta(url, meta) && HttpCacheLoadBody(url, meta, cachedBody))
+	{
+		cond.etag = meta.etag;
+		cond.lastModified = meta.lastModified;
+	}
+
+	if (!WinHttpGetToString_NoRedirects(url, out, cancel, connectMs, totalMs, outErr, outHttp, &cond))
+		return false;
+	if (cond.notModified)
+	{
+		out.swap(cachedBody);
+		return true;
+	}
+
+	std::string sha;
+	if (Sha256StringHexLower(out, sha))
+		HttpCacheStore(url, cond, sha, &out);
+	return true;
+}
+
+// "*.json" resources may have a pre-compressed "*.json.gz" twin (ManifestSha256 / ManifestOld
+// publish both). The twin is only a transport: it is used when the caller passes the sha256 the
+// plain file must have (its published head) and the inflated body matches, so a stale .gz can
+// never stand in for the authoritative .json. A missing twin is remembered in the HTTP cache
+// (<key>.missing) for kGzipMissingRecheckMs, so hosts without twins pay for it once a week.
+static constexpr unsigned long long kGzipMissingRecheckMs = 7ull * 24ull * 60ull * 60ull * 1000ull;
+static std::mutex g_gzipVariantLock;
+static std::unordered_set<std::string> g_gzipVariantMissing;   // this session, in front of the cache
+
+static bool DownloadUrl(const std::string& url, std::string& out, const CancelToken& cancel, std::string* outErr = nullptr, long* outHttp = nullptr,
+	const std::string& gzipExpectedSha256Lower = std::string())
+{
+	const bool isJson = url.size() > 5 && url.compare(url.size() - 5, 5, ".json") == 0;
+	const std::string gzUrl = url + ".gz";
+	bool tryGzip = isJson && IsHex64(gzipExpectedSha256Lower);
+	if (tryGzip)
+	{
+		std::lock_guard<std::mutex> guard(g_gzipVariantLock);
+		tryGzip = g_gzipVariantMissing.find(url) == g_gzipVariantMissing.end();
+	}
+	if (tryGzip && HttpCacheRecentlyMissing(gzUrl, kGzipMissingRecheckMs))
+	{
+		std::lock_guard<std::mutex> guard(g_gzipVariantLock);
+		g_gzipVariantMissing.insert(url);
+		tryGzip = false;
+	}
+	if (tryGzip)
+	{
+		std::string gz, gzErr;
+		long gzHttp = 0;
+		if (DownloadUrlCached(gzUrl, gz, cancel, &gzErr, &gzHttp))
+		{
+			std::string inflateErr, sha;
+			if (GzipDecompress(gz, out, static_cast<size_t>(AppConstants::kMaxTextDownloadBytes), &inflateErr)
+				&& Sha256StringHexLower(out, sha) && sha == gzipExpectedSha256Lower)
+			{
+				if (outHttp) *outHttp = gzHttp;
+				return true;
+			}
+			out.clear();   // stale or damaged twin: the plain file decides
+		}
+		if (cancel.IsCanceled())
+		{
+			if (outErr) *outErr = "Canceled";
+			return false;
+		}
+		// S3 answers 403 (not 404) for missing keys when listing is not public.
+		if (gzHttp == 403 || gzHttp == 404)
+		{
+			HttpCacheRememberMissing(gzUrl);
+			std::lock_guard<std::mutex> guard(g_gzipVariantLock);
+			g_gzipVariantMissing.insert(url);
+		}
+	}
+	return DownloadUrlCached(url, out, cancel, outErr, outHttp);
+}
+static std::string JoinUrl(const std::string& base, const std::string& path)
 {
 	if (base.empty()) return path;
 	if (path.empty()) return base;
@@ -3769,46 +5599,230 @@ static std::string JoinUrl(const std::string& base, const std::string& path)
 // --------------------------------------------------
 struct DlFileHashCtx
 {
-	FILE* f = nullptr;
-	BCRYPT_ALG_HANDLE hAlg = nullptr;
-	BCRYPT_HASH_HANDLE hHash = nullptr;
-	std::vector<UCHAR> obj;
-	std::vector<UCHAR> hash;
+	HANDLE file = INVALID_HANDLE_VALUE;   // overlapped; see DlOpenOutputFile
+	unsigned long long writeOffset = 0;   // next write position (= bytes in the file)
+	sha256lib::Hasher hasher;
+	bool hashing = false;                 // false = download without hashing
 	bool ok = true;
 };
 static void DlCloseHash(DlFileHashCtx& ctx)
 {
-	if (ctx.hHash) { BCryptDestroyHash(ctx.hHash); ctx.hHash = nullptr; }
-	if (ctx.hAlg) { BCryptCloseAlgorithmProvider(ctx.hAlg, 0); ctx.hAlg = nullptr; }
+	ctx.hashing = false;   // the hasher itself is reset by the next Begin
 }
 static bool DlInitSha256(DlFileHashCtx& ctx)
 {
-	NTSTATUS st = BCryptOpenAlgorithmProvider(&ctx.hAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
-	if (st != 0) return false;
-	DWORD objLen = 0, cbData = 0, hashLen = 0;
-	st = BCryptGetProperty(ctx.hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&objLen, sizeof(objLen), &cbData, 0);
-	if (st != 0) { DlCloseHash(ctx); return false; }
-	st = BCryptGetProperty(ctx.hAlg, BCRYPT_HASH_LENGTH, (PUCHAR)&hashLen, sizeof(hashLen), &cbData, 0);
-	if (st != 0) { DlCloseHash(ctx); return false; }
-	ctx.obj.assign(objLen, 0);
-	ctx.hash.assign(hashLen, 0);
-	st = BCryptCreateHash(ctx.hAlg, &ctx.hHash, ctx.obj.data(), (ULONG)ctx.obj.size(), nullptr, 0, 0);
-	if (st != 0) { DlCloseHash(ctx); return false; }
-	return true;
+	ctx.hashing = ctx.hasher.Begin();
+	return ctx.hashing;
 }
 static bool DlFinishSha256HexLower(DlFileHashCtx& ctx, std::string& outHexLower)
 {
 	outHexLower.clear();
-	if (!ctx.hHash) return false;
-	NTSTATUS st = BCryptFinishHash(ctx.hHash, ctx.hash.data(), (ULONG)ctx.hash.size(), 0);
-	if (st != 0) return false;
-	static const char* kHex = "0123456789abcdef";
-	outHexLower.reserve(ctx.hash.size() * 2);
-	for (UCHAR b : ctx.hash)
+	if (!ctx.hashing) return false;
+	ctx.hashing = false;
+	return ctx.hasher.FinishHex(outHexLower);
+}
+// Feeds the bytes already on disk into the hash. Returns false on a short read.
+// The caller already holds the file open for writing, so this reader must share write access
+// (a plain read-only open is refused and every resume would silently start from zero).
+static bool DlHashExistingBytes(DlFileHashCtx& ctx, const fs::path& file, unsigned long long bytes)
+{
+	if (!ctx.hashing) return false;
+	unique_handle h(CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+	if (!h) return false;
+	std::vector<char> buf(64 * 1024);
+	while (bytes > 0)
+	{
+		const DWORD want = (DWORD)(std::min)(bytes, (unsigned long long)buf.size());
+		DWORD got = 0;
+		if (!ReadFile(h.get(), buf.data(), want, &got, nullptr) || got != want)
+			return false;
+		if (!ctx.hasher.Update(buf.data(), got))
+			return false;
+		bytes -= got;
+	}
+	return true;
+}
+// Output file for the download loop. append = keep existing bytes and continue after them.
+// shareMode FILE_SHARE_READ lets status readers in but keeps a second writer out.
+static bool DlOpenOutputFile(DlFileHashCtx& ctx, const fs::path& file, bool append, DWORD shareMode)
+{
+	ctx.file = CreateFileW(file.c_str(), GENERIC_WRITE, shareMode, nullptr,
+		append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+	ctx.writeOffset = 0;
+	if (ctx.file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size{};
+	if (append && GetFileSizeEx(ctx.file, &size))
+		ctx.writeOffset = (unsigned long long)size.QuadPart;
+	return true;
+}
+static void DlCloseOutputFile(DlFileHashCtx& ctx)
+{
+	if (ctx.file != INVALID_HANDLE_VALUE)
+		CloseHandle(ctx.file);
+	ctx.file = INVALID_HANDLE_VALUE;
+}
+// The server answered a ranged request with the whole file: drop what we kept and start over.
+static bool DlRestartFromZero(DlFileHashCtx& ctx)
+{
+	if (ctx.file != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER zero{};
+		if (!SetFilePointerEx(ctx.file, zero, nullptr, FILE_BEGIN) || !SetEndOfFile(ctx.file)) return false;
+		ctx.writeOffset = 0;
+	}
+	if (ctx.hashing && !DlInitSha256(ctx))
+		return false;
+	return true;
+}
+// --------------------------------------------------
+// Download bandwidth cap ([Preferences] MaxDownloadKBps)
+// - One token bucket shared by every download thread, so the cap is global, not per connection.
+// - Readers pay after each chunk; once the bucket is in debt they sleep it off in short slices
+//   (Cancel still responds). Idle time refills at most kBandwidthBurstMs worth of tokens.
+// --------------------------------------------------
+static constexpr ULONGLONG kBandwidthBurstMs = 250;
+static constexpr DWORD kBandwidthSleepSliceMs = 50;
+struct BandwidthLimiter
+{
+	std::mutex lock;
+	unsigned long long bytesPerSec = 0;   // 0 = unlimited
+	double tokens = 0.0;                  // bytes; negative = debt
+	ULONGLONG lastTick = 0;
+	int activeRuns = 0;                   // concurrent syncs sharing the bucket (headless /sync batch)
+};
+static BandwidthLimiter g_bandwidth;
+// The cap applies while at least one sync runs; it is lifted when the last one ends.
+static void BandwidthLimiterBegin(unsigned long long bytesPerSec)
+{
+	std::lock_guard<std::mutex> guard(g_bandwidth.lock);
+	if (g_bandwidth.activeRuns++ == 0)
+	{
+		g_bandwidth.tokens = 0.0;
+		g_bandwidth.lastTick = GetTickCount64();
+	}
+	g_bandwidth.bytesPerSec = bytesPerSec;
+}
+static void BandwidthLimiterEnd()
+{
+	std::lock_guard<std::mutex> guard(g_bandwidth.lock);
+	if (g_bandwidth.activeRuns > 0 && --g_bandwidth.activeRuns == 0)
+		g_bandwidth.bytesPerSec = 0;
+}
+static void BandwidthLimiterConsume(unsigned long long bytes, const CancelToken& cancel)
+{
+	ULONGLONG waitMs = 0;
+	{
+		std::lock_guard<std::mutex> guard(g_bandwidth.lock);
+		const double rate = (double)g_bandwidth.bytesPerSec;
+		if (rate <= 0.0)
+			return;
+		const ULONGLONG now = GetTickCount64();
+		g_bandwidth.tokens += (double)(now - g_bandwidth.lastTick) * rate / 1000.0;
+		g_bandwidth.lastTick = now;
+		const double burst = rate * (double)kBandwidthBurstMs / 1000.0;
+		if (g_bandwidth.tokens > burst)
+			g_bandwidth.tokens = burst;
+		g_bandwidth.tokens -= (double)bytes;
+		if (g_bandwidth.tokens < 0.0)
+			waitMs = (ULONGLONG)(-g_bandwidth.tokens * 1000.0 / rate);
+	}
+	while (waitMs > 0 && !cancel.IsCanceled())
+	{
+		const DWORD step = (DWORD)(std::min)(waitMs, (ULONGLONG)kBandwidthSleepSliceMs);
+		Sleep(step);
+		waitMs -= step;
+	}
+}
+
+// --------------------------------------------------
+// Download pipeline buffers
+// - kDownloadPipelineDepth page-aligned chunks per thread, allocated once and reused by every
+//   download that thread runs: the loop itself never allocates.
+// - Chunk N is handed to an overlapped WriteFile and hashed while the disk works; the next
+//   WinHttpReadData fills chunk N+1 meanwhile. A chunk is reused only after its write landed.
+// --------------------------------------------------
+struct DlChunk
+{
+	char* data = nullptr;
+	DWORD size = 0;          // bytes in flight
+	OVERLAPPED ov{};
+	bool pending = false;    // overlapped write issued and not yet collected
+};
+struct DlBufferPool
+{
+	DlChunk chunks[AppConstants::kDownloadPipelineDepth];
+	void* block = nullptr;
+	unique_handle events[AppConstants::kDownloadPipelineDepth];
+
+	DlBufferPool()
+	{
+		block = VirtualAlloc(nullptr, (SIZE_T)AppConstants::kDownloadChunkBytes * AppConstants::kDownloadPipelineDepth,
+			MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		for (int i = 0; i < AppConstants::kDownloadPipelineDepth; ++i)
+		{
+			events[i].reset(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+			if (block)
+				chunks[i].data = static_cast<char*>(block) + (size_t)i * AppConstants::kDownloadChunkBytes;
+		}
+	}
+	~DlBufferPool()
+	{
+		if (block) VirtualFree(block, 0, MEM_RELEASE);
+	}
+	DlBufferPool(const DlBufferPool&) = delete;
+	DlBufferPool& operator=(const DlBufferPool&) = delete;
+
+	bool Ready() const
+	{
+		if (!block) return false;
+		for (const auto& e : events)
+			if (!e) return false;
+		return true;
+	}
+};
+static DlBufferPool& ThreadDownloadBuffers()
+{
+	thread_local DlBufferPool pool;
+	return pool;
+}
+// Collects the chunk's write (if any). False when it failed or came up short.
+static bool DlWaitChunk(DlFileHashCtx& ctx, DlChunk& c)
+{
+	if (!c.pending) return true;
+	c.pending = false;
+	DWORD wrote = 0;
+	if (!GetOverlappedResult(ctx.file, &c.ov, &wrote, TRUE) || wrote != c.size)
+	{
+		ctx.ok = false;
+		return false;
+	}
+	return true;
+}
+static bool DlWaitAllChunks(DlFileHashCtx& ctx, DlBufferPool& buffers)
+{
+	bool ok = true;
+	for (auto& c : buffers.chunks)
+		ok = DlWaitChunk(ctx, c) && ok;
+	return ok;
+}
+static bool DlBeginWrite(DlFileHashCtx& ctx, DlChunk& c, HANDLE doneEvent, DWORD bytes)
+{
+	c.ov = OVERLAPPED{};
+	c.ov.Offset = (DWORD)(ctx.writeOffset & 0xFFFFFFFFull);
+	c.ov.OffsetHigh = (DWORD)(ctx.writeOffset >> 32);
+	c.ov.hEvent = doneEvent;
+	ResetEvent(doneEvent);
+	c.size = bytes;
+	if (!WriteFile(ctx.file, c.data, bytes, nullptr, &c.ov) && GetLastError() != ERROR_IO_PENDING)
 	{
-		outHexLower.push_back(kHex[(b >> 4) & 0xF]);
-		outHexLower.push_back(kHex[b & 0xF]);
+		ctx.ok = false;
+		return false;
 	}
+	// Completed inline or queued: either way GetOverlappedResult collects it.
+	c.pending = true;
+	ctx.writeOffset += bytes;
 	return true;
 }
 static bool WinHttpDownloadToFileAndHash_NoRedirects(
@@ -3819,21 +5833,57 @@ static bool WinHttpDownloadToFileAndHash_NoRedirects(
 	long totalTimeoutMs,
 	std::string* outErr,
 	long* outHttp,
-	unsigned long long maxBytes)
+	unsigned long long maxBytes,
+	HttpConditional* cond = nullptr,
+	HttpRangeRequest* range = nullptr)
 {
 	if (outErr) outErr->clear();
 	if (outHttp) *outHttp = 0;
 
 	WinHttpGetCtx http;
-	if (!WinHttpOpenGet_NoRedirects(urlUtf8, http, cancel, connectTimeoutMs, totalTimeoutMs, outErr, outHttp))
+	if (!WinHttpOpenGet_NoRedirects(urlUtf8, http, cancel, connectTimeoutMs, totalTimeoutMs, outErr, outHttp, cond, false, range))
+		return false;
+	if (cond && cond->notModified)
+		return true;
+	if (range && range->offset > 0 && !range->partial && !DlRestartFromZero(ctx))
+	{
+		if (outErr) *outErr = "Failed to restart partial download";
 		return false;
+	}
 
-	unsigned long long downloadedBytes = 0;
+	// The size cap covers the whole file, including bytes resumed from an earlier attempt.
+	unsigned long long downloadedBytes = (range && range->partial) ? range->offset : 0;
 
-	for (;;)
+	DlBufferPool& buffers = ThreadDownloadBuffers();
+	if (!buffers.Ready())
+	{
+		if (outErr) *outErr = "Failed to allocate download buffers";
+		return false;
+	}
+	const bool toFile = (ctx.file != INVALID_HANDLE_VALUE);
+	// Every exit path waits for in-flight writes: the chunks outlive this call.
+	ScopeExit drainWrites{ [&]() { if (toFile) DlWaitAllChunks(ctx, buffers); } };
+
+	// Reserve the clusters up front when the length is known; EOF stays put, so a dropped
+	// connection still leaves a file whose size is exactly the bytes received.
+	if (toFile && http.contentLength > 0)
+	{
+		FILE_ALLOCATION_INFO alloc{};
+		alloc.AllocationSize.QuadPart = (LONGLONG)(ctx.writeOffset + (unsigned long long)http.contentLength);
+		(void)SetFileInformationByHandle(ctx.file, FileAllocationInfo, &alloc, sizeof(alloc));
+	}
+
+	for (int slot = 0;; slot = (slot + 1) % AppConstants::kDownloadPipelineDepth)
 	{
 		if (cancel.IsCanceled()) { if (outErr) *outErr = "Canceled"; return false; }
 
+		DlChunk& chunk = buffers.chunks[slot];
+		if (toFile && !DlWaitChunk(ctx, chunk))
+		{
+			if (outErr) *outErr = "File write failed (" + std::to_string(GetLastError()) + ")";
+			return false;
+		}
+
 		DWORD avail = 0;
 		if (!WinHttpQueryDataAvailable((HINTERNET)http.request.get(), &avail))
 		{
@@ -3842,42 +5892,43 @@ static bool WinHttpDownloadToFileAndHash_NoRedirects(
 		}
 		if (avail == 0) break;
 
-		if (maxBytes > 0 && downloadedBytes + static_cast<unsigned long long>(avail) > maxBytes)
+		const DWORD want = (std::min)(avail, AppConstants::kDownloadChunkBytes);
+		if (maxBytes > 0 && downloadedBytes + static_cast<unsigned long long>(want) > maxBytes)
 		{
 			if (outErr) *outErr = "Download too large; exceeded " + std::to_string(maxBytes) + " bytes";
 			return false;
 		}
 
-		std::vector<char> buf(avail);
 		DWORD read = 0;
-		if (!WinHttpReadData((HINTERNET)http.request.get(), buf.data(), avail, &read))
+		if (!WinHttpReadData((HINTERNET)http.request.get(), chunk.data, want, &read))
 		{
 			if (outErr) *outErr = "WinHttpReadData failed (" + std::to_string(GetLastError()) + ")";
 			return false;
 		}
 		if (read == 0) break;
 		downloadedBytes += static_cast<unsigned long long>(read);
+		ProgressReporterAddNetBytes(read);
+		PerfNoteReceivedBytes(read);
+		BandwidthLimiterConsume(read, cancel);
 
-		if (ctx.f)
+		if (toFile && !DlBeginWrite(ctx, chunk, buffers.events[slot].get(), read))
 		{
-			size_t wrote = fwrite(buf.data(), 1, read, ctx.f);
-			if (wrote != read)
-			{
-				if (outErr) *outErr = "fwrite failed";
-				return false;
-			}
+			if (outErr) *outErr = "File write failed (" + std::to_string(GetLastError()) + ")";
+			return false;
 		}
-		if (ctx.hHash)
+		// Hashing overlaps the write just queued; WriteFile only reads the chunk.
+		if (ctx.hashing && !ctx.hasher.Update(chunk.data, read))
 		{
-			NTSTATUS st = BCryptHashData(ctx.hHash, (PUCHAR)buf.data(), (ULONG)read, 0);
-			if (st != 0)
-			{
-				if (outErr) *outErr = "BCryptHashData failed";
-				return false;
-			}
+			if (outErr) *outErr = "SHA-256 update failed";
+			return false;
 		}
 	}
 
+	if (toFile && !DlWaitAllChunks(ctx, buffers))
+	{
+		if (outErr) *outErr = "File write failed (" + std::to_string(GetLastError()) + ")";
+		return false;
+	}
 	return true;
 }
 static bool MoveReplace(const fs::path& from, const fs::path& to)
@@ -3886,10 +5937,117 @@ static bool MoveReplace(const fs::path& from, const fs::path& to)
 	std::wstring wTo = to.wstring();
 	return MoveFileExW(wFrom.c_str(), wTo.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
 }
+// --------------------------------------------------
+// Resumable downloads
+// - Failed or canceled downloads keep their bytes in <install>\MapPackSyncTool_partial\<sha256>.part,
+//   named by the expected hash so a retry (this run or a later one) finds them.
+// - <sha256>.part.meta holds the strong ETag (or Last-Modified) the bytes came from; the resume
+//   sends it as If-Range, so a changed file comes back whole (200) instead of being spliced.
+// - The SHA-256 state is rebuilt over the kept bytes first; a mismatch at the end discards them.
+// - The folder lives outside the sync root, so orphan cleanup never deletes a partial file.
+// - <sha256>.staged is a complete file the background prefetch fetched ahead of a Sync; it is
+//   re-hashed and moved into place (TakeStagedDownload) and never outlives the next Sync or
+//   Remove, whichever folder that one targets (DiscardPrefetchForOtherFolder).
+// --------------------------------------------------
+static fs::path PartialDownloadPath(const fs::path& partialDir, const std::string& sha256Lower)
+{
+	return partialDir / (Utf8ToWide(sha256Lower) + L".part");
+}
+static fs::path StagedDownloadPath(const fs::path& partialDir, const std::string& sha256Lower)
+{
+	return partialDir / (Utf8ToWide(sha256Lower) + L".staged");
+}
+static fs::path PartialDownloadMetaPath(const fs::path& partialPath)
+{
+	fs::path meta = partialPath;
+	meta += L".meta";
+	return meta;
+}
+static void DiscardPartialDownload(const fs::path& partialPath)
+{
+	std::error_code ec;
+	fs::remove(partialPath, ec);
+	fs::remove(PartialDownloadMetaPath(partialPath), ec);
+}
+static std::string ReadPartialDownloadValidator(const fs::path& partialPath)
+{
+	std::ifstream in(PartialDownloadMetaPath(partialPath), std::ios::binary);
+	std::string line;
+	if (!in || !std::getline(in, line)) return std::string();
+	while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) line.pop_back();
+	return line;
+}
+static bool WritePartialDownloadValidator(const fs::path& partialPath, const std::string& validator)
+{
+	std::ofstream out(PartialDownloadMetaPath(partialPath), std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+	out << validator << "\n";
+	return (bool)out;
+}
+// Removes kept partials whose hash is no longer wanted (the manifest moved on) and every staged
+// prefetch (the sync that could use it has run), then the folder itself once it is empty.
+static void PrunePartialDownloads(const fs::path& partialDir, const std::unordered_set<std::string>& wantedSha256Lower)
+{
+	std::error_code ec;
+	if (!fs::is_directory(partialDir, ec))
+		return;
+	for (auto it = fs::directory_iterator(partialDir, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+	{
+		const std::wstring name = it->path().filename().wstring();
+		const size_t dot = name.find(L'.');
+		const std::string sha = ToLowerAsciiCopy(WideToUtf8(name.substr(0, dot)));
+		const bool staged = it->path().extension() == L".staged";
+		if (staged || wantedSha256Lower.find(sha) == wantedSha256Lower.end())
+		{
+			std::error_code rmEc;
+			fs::remove(it->path(), rmEc);
+		}
+	}
+	ec.clear();
+	if (fs::is_empty(partialDir, ec) && !ec)
+		fs::remove(partialDir, ec);
+}
+// Staged prefetches only; kept partials stay resumable for a later Sync of that install.
+static void PruneStagedDownloads(const fs::path& partialDir)
+{
+	std::error_code ec;
+	if (!fs::is_directory(partialDir, ec))
+		return;
+	for (auto it = fs::directory_iterator(partialDir, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+	{
+		if (it->path().extension() != L".staged")
+			continue;
+		std::error_code rmEc;
+		fs::remove(it->path(), rmEc);
+	}
+	ec.clear();
+	if (fs::is_empty(partialDir, ec) && !ec)
+		fs::remove(partialDir, ec);
+}
+// Moves a staged prefetch of this content into place once it hashes right. False = none (or a bad
+// one, which is removed); the caller downloads as usual.
+static bool TakeStagedDownload(const fs::path& partialDir, const std::string& shaLower, long long expectedSize, const fs::path& destFile)
+{
+	const fs::path staged = StagedDownloadPath(partialDir, shaLower);
+	std::error_code ec;
+	const unsigned long long size = fs::file_size(staged, ec);
+	if (ec)
+		return false;
+	std::string got;
+	if ((expectedSize >= 0 && size != (unsigned long long)expectedSize) || !Sha256FileHexLower(staged, got) || got != shaLower)
+	{
+		fs::remove(staged, ec);
+		return false;
+	}
+	fs::create_directories(destFile.parent_path(), ec);
+	return MoveReplace(staged, destFile);
+}
 static bool DownloadUrlToFileVerifySha256(
 	const std::string& url,
 	const fs::path& destFile,
 	const std::string& expectedSha256HexLower,
+	const fs::path& partialDir,
+	long long expectedSize,
 	const CancelToken& cancel,
 	std::string* outErr = nullptr,
 	long* outHttp = nullptr)
@@ -3903,45 +6061,87 @@ static bool DownloadUrlToFileVerifySha256(
 		if (outErr) *outErr = "create_directories failed: " + ec.message();
 		return false;
 	}
-	fs::path tmp = destFile;
-	tmp += L".tmp";
-	tmp += std::to_wstring(GetCurrentProcessId());
-	tmp += L".";
-	tmp += std::to_wstring(GetTickCount64());
+	fs::create_directories(partialDir, ec);
+	if (ec)
+	{
+		if (outErr) *outErr = "create_directories failed: " + ec.message();
+		return false;
+	}
 	DlFileHashCtx ctx{};
 	if (!DlInitSha256(ctx))
 	{
 		if (outErr) *outErr = "BCrypt SHA-256 init failed";
 		return false;
 	}
-	_wfopen_s(&ctx.f, tmp.wstring().c_str(), L"wb");
-	if (!ctx.f)
+
+	// Opened deny-write, so two workers fetching the same content never share one file; the
+	// second one falls back to a private temp file that is not kept.
+	fs::path part = PartialDownloadPath(partialDir, ToLowerAsciiCopy(expectedSha256HexLower));
+	bool resumable = true;
+	if (!DlOpenOutputFile(ctx, part, true, FILE_SHARE_READ))
+	{
+		resumable = false;
+		part += L".tmp";
+		part += std::to_wstring(GetCurrentProcessId());
+		part += L".";
+		part += std::to_wstring(GetTickCount64());
+		(void)DlOpenOutputFile(ctx, part, false, FILE_SHARE_READ);
+	}
+	if (ctx.file == INVALID_HANDLE_VALUE)
 	{
 		DlCloseHash(ctx);
-		if (outErr) *outErr = "Failed to open temp file for writing";
+		if (outErr) *outErr = "Failed to open partial download file for writing";
 		return false;
 	}
+
+	// Resume only what we can validate: bytes with a recorded validator, short of the full size.
+	HttpRangeRequest range;
+	const long long kept = resumable ? (long long)ctx.writeOffset : 0;
+	if (kept > 0 && (expectedSize < 0 || kept < expectedSize))
+	{
+		range.ifRange = ReadPartialDownloadValidator(part);
+		if (!range.ifRange.empty() && DlHashExistingBytes(ctx, part, (unsigned long long)kept))
+			range.offset = (unsigned long long)kept;
+	}
+	if (range.offset == 0 && kept != 0)
+	{
+		// Unusable leftovers (no validator, unreadable, or already full size): start over.
+		range = HttpRangeRequest{};
+		if (!DlRestartFromZero(ctx))
+		{
+			DlCloseOutputFile(ctx);
+			DlCloseHash(ctx);
+			DiscardPartialDownload(part);
+			if (outErr) *outErr = "Failed to reset partial download file";
+			return false;
+		}
+	}
 	const long connectMs = AppConstants::kFileConnectTimeoutMs;
 	const long totalMs = AppConstants::kFileTimeoutMs;
 	std::string dlErr;
 	long code = 0;
 	bool ok = WinHttpDownloadToFileAndHash_NoRedirects(url, ctx, cancel, connectMs, totalMs,
-		&dlErr, &code, AppConstants::kMaxSyncedFileDownloadBytes);
+		&dlErr, &code, AppConstants::kMaxSyncedFileDownloadBytes, nullptr, &range);
 	if (outHttp) *outHttp = code;
-	fflush(ctx.f);
-	fclose(ctx.f);
-	ctx.f = nullptr;
+	DlCloseOutputFile(ctx);
 	if (!ok)
 	{
 		DlCloseHash(ctx);
-		fs::remove(tmp, ec);
+		// Keep the bytes for the next attempt when we know how to validate them: the new reply's
+		// validator once a body was streaming, otherwise (no reply, error status) the old one.
+		const bool bodyStarted = (code >= 200 && code < 300);
+		const std::string validator = bodyStarted ? range.respValidator : range.ifRange;
+		const unsigned long long have = fs::file_size(part, ec);
+		if (!resumable || range.notSatisfiable || ec || have == 0 || validator.empty()
+			|| !WritePartialDownloadValidator(part, validator))
+			DiscardPartialDownload(part);
 		if (outErr) *outErr = dlErr.empty() ? "Download failed" : dlErr;
 		return false;
 	}
 	if (!ctx.ok)
 	{
 		DlCloseHash(ctx);
-		fs::remove(tmp, ec);
+		DiscardPartialDownload(part);
 		if (outErr) *outErr = "Write/hash failure during download";
 		return false;
 	}
@@ -3949,23 +6149,24 @@ static bool DownloadUrlToFileVerifySha256(
 	if (!DlFinishSha256HexLower(ctx, gotHex))
 	{
 		DlCloseHash(ctx);
-		fs::remove(tmp, ec);
+		DiscardPartialDownload(part);
 		if (outErr) *outErr = "BCryptFinishHash failed";
 		return false;
 	}
 	DlCloseHash(ctx);
 	if (!EqualIcaseAscii(gotHex, expectedSha256HexLower))
 	{
-		fs::remove(tmp, ec);
-		if (outErr) *outErr = "SHA-256 mismatch after download";
+		DiscardPartialDownload(part);
+		if (outErr) *outErr = range.partial ? "SHA-256 mismatch after resumed download" : "SHA-256 mismatch after download";
 		return false;
 	}
-	if (!MoveReplace(tmp, destFile))
+	if (!MoveReplace(part, destFile))
 	{
-		fs::remove(tmp, ec);
+		DiscardPartialDownload(part);
 		if (outErr) *outErr = "Failed to replace destination file";
 		return false;
 	}
+	fs::remove(PartialDownloadMetaPath(part), ec);
 	return true;
 }
 static bool DownloadUrlToFileNoVerify(
@@ -3974,7 +6175,8 @@ static bool DownloadUrlToFileNoVerify(
 	const CancelToken& cancel,
 	std::string* outErr,
 	long* outHttp,
-	unsigned long long maxBytes)
+	unsigned long long maxBytes,
+	HttpConditional* cond)
 {
 	if (outErr) outErr->clear();
 	if (outHttp) *outHttp = 0;
@@ -3993,8 +6195,7 @@ static bool DownloadUrlToFileNoVerify(
 	ec.clear();
 
 	DlFileHashCtx ctx{};
-	_wfopen_s(&ctx.f, tmp.wstring().c_str(), L"wb");
-	if (!ctx.f)
+	if (!DlOpenOutputFile(ctx, tmp, false, FILE_SHARE_READ))
 	{
 		if (outErr) *outErr = "Failed to open temp download file for writing";
 		return false;
@@ -4005,12 +6206,17 @@ static bool DownloadUrlToFileNoVerify(
 	std::string dlErr;
 	long code = 0;
 	bool ok = WinHttpDownloadToFileAndHash_NoRedirects(url, ctx, cancel, connectMs, totalMs,
-		&dlErr, &code, maxBytes);
+		&dlErr, &code, maxBytes, cond);
 	if (outHttp) *outHttp = code;
 
-	fflush(ctx.f);
-	fclose(ctx.f);
-	ctx.f = nullptr;
+	DlCloseOutputFile(ctx);
+
+	// 304: nothing was written; the caller keeps its existing copy.
+	if (ok && cond && cond->notModified)
+	{
+		fs::remove(tmp, ec);
+		return true;
+	}
 
 	if (!ok || !ctx.ok)
 	{
@@ -4031,91 +6237,910 @@ static bool DownloadUrlToFileNoVerify(
 }
 
 // --------------------------------------------------
-// Helpers
+// Mirror hosts (file downloads only)
+// - Candidates: kRemoteHost, [Preferences] MirrorHosts (comma separated base URLs) and the list
+//   published as mappack_mirrors.txt on kRemoteHost (one base URL per line, '#' comments).
+//   Mirrors are full copies of the bucket and must be https.
+// - A startup thread of its own (MirrorProbeThreadProc, so it never delays the manifest check
+//   result) probes every candidate (warm-up GET of the head file, then a timed ranged GET of the
+//   first kMirrorProbeBytes of the manifest: one round trip plus the transfer) and ranks them
+//   fastest first. Until that finishes kRemoteHost goes first.
+// - The published list is fetched at most once per kMirrorListMaxAgeMs; in between the copy
+//   saved next to the INI (kMirrorListCacheFileName) is used without a request.
+// - The manifest, head, deltas, old-file list and pack index always come from kRemoteHost; that
+//   is what anchors integrity. A mirror only serves bytes that are checked against its SHA-256.
+// - Each file download fails over to the next host; a host failing kMirrorMaxConsecutiveFailures
+//   requests in a row drops behind the healthy ones for the rest of the session.
 // --------------------------------------------------
-struct EmptyDirRemovalStats
+static constexpr unsigned long long kMirrorProbeBytes = 256ull * 1024ull;
+static constexpr long kMirrorProbeConnectTimeoutMs = 5000L;
+static constexpr long kMirrorProbeTimeoutMs = 10000L;
+static constexpr int kMirrorMaxConsecutiveFailures = 3;
+static constexpr unsigned long long kMirrorListMaxAgeMs = 24ull * 60ull * 60ull * 1000ull;
+struct MirrorHost
+{
+	std::string base;                // "https://host[/prefix]", no trailing slash
+	long long probeMs = -1;          // -1 = not probed, or the probe failed
+	int consecutiveFailures = 0;
+};
+struct MirrorSet
 {
-	int removed = 0;
-	int failed = 0;
-
-	EmptyDirRemovalStats& operator+=(const EmptyDirRemovalStats& rhs)
+	std::mutex lock;
+	std::vector<MirrorHost> hosts;   // ranked; empty = not configured yet
+};
+static MirrorSet g_mirrors;
+static bool NormalizeMirrorBase(std::string s, std::string& out)
+{
+	out.clear();
+	s.erase(std::remove_if(s.begin(), s.end(), [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }), s.end());
+	while (!s.empty() && s.back() == '/') s.pop_back();
+	// Bytes are verified either way, but downloads must not be observable or tamperable in transit.
+	if (s.size() <= 8 || !EqualIcaseAscii(s.substr(0, 8), "https://"))
+		return false;
+	std::wstring host, path;
+	INTERNET_PORT port = 0;
+	bool secure = false;
+	if (!CrackUrlWinHttp(s + "/", host, path, port, secure, nullptr) || !secure || host.empty())
+		return false;
+	out = s;
+	return true;
+}
+static void AddMirrorCandidates(const std::string& list, std::vector<std::string>& ioHosts)
+{
+	size_t i = 0;
+	while (i < list.size())
 	{
-		removed += rhs.removed;
-		failed += rhs.failed;
-		return *this;
+		size_t end = list.find_first_of(",;\r\n", i);
+		if (end == std::string::npos) end = list.size();
+		std::string item = list.substr(i, end - i);
+		const size_t hash = item.find('#');
+		if (hash != std::string::npos) item.resize(hash);
+		std::string base;
+		if (NormalizeMirrorBase(item, base)
+			&& std::none_of(ioHosts.begin(), ioHosts.end(), [&base](const std::string& h) { return EqualIcaseAscii(h, base); }))
+			ioHosts.push_back(base);
+		i = end + 1;
 	}
-};
-
-static EmptyDirRemovalStats RemoveEmptyDirsBottomUp(const fs::path& root, bool removeRoot = false)
+}
+static fs::path GetMirrorListCachePath()
 {
+	return fs::path(GetSettingsIniPath()).parent_path() / kMirrorListCacheFileName;
+}
+// The saved published list while it is younger than kMirrorListMaxAgeMs.
+static bool LoadRecentMirrorList(std::string& out)
+{
+	out.clear();
+	const fs::path path = GetMirrorListCachePath();
 	std::error_code ec;
-	EmptyDirRemovalStats stats;
-	if (!fs::exists(root, ec) || !fs::is_directory(root, ec))
-		return stats;
-	std::vector<fs::path> dirs;
-	for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
-		it != fs::recursive_directory_iterator(); it.increment(ec))
+	const auto written = fs::last_write_time(path, ec);
+	if (ec) return false;
+	const auto age = std::chrono::duration_cast<std::chrono::milliseconds>(fs::file_time_type::clock::now() - written).count();
+	if (age < 0 || (unsigned long long)age >= kMirrorListMaxAgeMs)
+		return false;
+	std::ifstream f(path, std::ios::binary);
+	if (!f) return false;
+	out.assign((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	return true;
+}
+// Best effort; rewritten on every fetch so its age is that of the last check.
+static void SaveMirrorList(const std::string& text)
+{
+	(void)HttpCacheWriteFileAtomic(GetMirrorListCachePath(), text);
+}
+// kRemoteHost first, then the INI list, then (when allowed) the published list.
+static std::vector<std::string> CollectMirrorCandidates(bool includeRemoteList, const CancelToken& cancel)
+{
+	std::vector<std::string> hosts{ kRemoteHost };
+	AddMirrorCandidates(WideToUtf8(IniReadMirrorHosts()), hosts);
+	if (includeRemoteList)
+	{
+		std::string text;
+		if (LoadRecentMirrorList(text))
+			AddMirrorCandidates(text, hosts);
+		else
+		{
+			long http = 0;
+			if (DownloadUrl(JoinUrl(kRemoteHost, kMirrorListPath), text, cancel, nullptr, &http))
+				AddMirrorCandidates(text, hosts);
+			// A missing list (403/404) is remembered as an empty one, so it is not asked for again either.
+			if (http == 200 || http == 304 || http == 403 || http == 404)
+				SaveMirrorList(http == 200 || http == 304 ? text : std::string());
+		}
+	}
+	return hosts;
+}
+// Milliseconds for the timed request, or -1 if the host failed either request.
+static long long ProbeMirrorHost(const std::string& base, const CancelToken& cancel)
+{
+	std::string head;
+	if (!WinHttpGetToString_NoRedirects(JoinUrl(base, kManifestHeadPath), head, cancel,
+		kMirrorProbeConnectTimeoutMs, kMirrorProbeTimeoutMs, nullptr, nullptr))
+		return -1;
+
+	const ULONGLONG started = GetTickCount64();
+	HttpRangeRequest range;
+	range.spans = "0-" + std::to_string(kMirrorProbeBytes - 1);
+	WinHttpGetCtx ctx;
+	if (!WinHttpOpenGet_NoRedirects(JoinUrl(base, kManifestPath), ctx, cancel, kMirrorProbeConnectTimeoutMs, kMirrorProbeTimeoutMs,
+		nullptr, nullptr, nullptr, false, &range))
+		return -1;
+	// A server without range support sends the whole manifest; only the first bytes are timed.
+	std::vector<char> buf(64 * 1024);
+	unsigned long long got = 0;
+	while (got < kMirrorProbeBytes)
+	{
+		if (cancel.IsCanceled()) return -1;
+		DWORD read = 0;
+		if (!WinHttpReadData((HINTERNET)ctx.request.get(), buf.data(), (DWORD)buf.size(), &read))
+			return -1;
+		if (read == 0) break;
+		got += read;
+	}
+	return got > 0 ? (long long)(GetTickCount64() - started) : -1;
+}
+// Startup mirror-probe thread (and headless batches). A single candidate is not probed at all.
+static void RefreshMirrorHosts(const CancelToken& cancel)
+{
+	const std::vector<std::string> candidates = CollectMirrorCandidates(true, cancel);
+	std::vector<MirrorHost> ranked;
+	for (const auto& base : candidates)
 	{
-		if (ec) { ec.clear(); continue; }
-		if (it->is_directory(ec) && !ec) dirs.push_back(it->path());
-		else ec.clear();
+		MirrorHost h;
+		h.base = base;
+		if (candidates.size() > 1)
+			h.probeMs = ProbeMirrorHost(base, cancel);
+		ranked.push_back(std::move(h));
 	}
-	std::sort(dirs.begin(), dirs.end(), [](const fs::path& a, const fs::path& b)
+	// Failed probes go last but stay as a final resort; ties keep kRemoteHost first.
+	std::stable_sort(ranked.begin(), ranked.end(), [](const MirrorHost& a, const MirrorHost& b)
 		{
-			return a.native().size() > b.native().size();
+			if ((a.probeMs < 0) != (b.probeMs < 0)) return b.probeMs < 0;
+			return a.probeMs < b.probeMs;
 		});
-	for (const auto& d : dirs)
+	if (cancel.IsCanceled())
+		return;   // half-probed ranking: keep what there is
+	std::lock_guard<std::mutex> guard(g_mirrors.lock);
+	g_mirrors.hosts.swap(ranked);
+}
+// Sync start: without a finished probe, use kRemoteHost and the INI mirrors in that order.
+static void EnsureMirrorHostsConfigured()
+{
+	{
+		std::lock_guard<std::mutex> guard(g_mirrors.lock);
+		if (!g_mirrors.hosts.empty()) return;
+	}
+	std::vector<MirrorHost> hosts;
+	for (const auto& base : CollectMirrorCandidates(false, CancelToken{}))
+	{
+		MirrorHost h;
+		h.base = base;
+		hosts.push_back(std::move(h));
+	}
+	std::lock_guard<std::mutex> guard(g_mirrors.lock);
+	if (g_mirrors.hosts.empty())
+		g_mirrors.hosts.swap(hosts);
+}
+// Healthy hosts in rank order, then the ones that kept failing.
+static std::vector<std::string> MirrorHostsInOrder()
+{
+	std::vector<std::string> healthy, failing;
+	{
+		std::lock_guard<std::mutex> guard(g_mirrors.lock);
+		for (const auto& h : g_mirrors.hosts)
+			(h.consecutiveFailures < kMirrorMaxConsecutiveFailures ? healthy : failing).push_back(h.base);
+	}
+	healthy.insert(healthy.end(), failing.begin(), failing.end());
+	if (healthy.empty())
+		healthy.push_back(kRemoteHost);
+	return healthy;
+}
+static void MirrorNoteResult(const std::string& base, bool ok)
+{
+	std::lock_guard<std::mutex> guard(g_mirrors.lock);
+	for (auto& h : g_mirrors.hosts)
+	{
+		if (h.base == base)
+			h.consecutiveFailures = ok ? 0 : h.consecutiveFailures + 1;
+	}
+}
+static std::string MakeFileUrlFromHost(const std::string& host, const std::string& remotePath)
+{
+	// Hosts have no trailing slash. remotePath in the manifest is expected to be relative,
+	// but we defensively handle a leading '/' as well.
+	std::string url = host;
+	if (!url.empty() && url.back() != '/') url.push_back('/');
+	if (!remotePath.empty() && remotePath.front() == '/')
+		return url + remotePath.substr(1);
+	return url + remotePath;
+}
+// DownloadUrlToFileVerifySha256 against each host in turn. A partial file kept from another host
+// is resumed only if its If-Range validator still matches; otherwise the server restarts it.
+static bool DownloadFileFromMirrors(const std::string& remotePath, const fs::path& destFile, const std::string& expectedSha256,
+	const fs::path& partialDir, long long expectedSize, const CancelToken& cancel, std::string* outErr, long* outHttp)
+{
+	const std::vector<std::string> hosts = MirrorHostsInOrder();
+	for (size_t h = 0; h < hosts.size(); ++h)
+	{
+		std::string err;
+		if (DownloadUrlToFileVerifySha256(MakeFileUrlFromHost(hosts[h], remotePath), destFile, expectedSha256,
+			partialDir, expectedSize, cancel, &err, outHttp))
+		{
+			MirrorNoteResult(hosts[h], true);
+			return true;
+		}
+		if (outErr) *outErr = (hosts.size() > 1) ? err + " [" + hosts[h] + "]" : err;
+		if (cancel.IsCanceled())
+			return false;
+		MirrorNoteResult(hosts[h], false);
+	}
+	return false;
+}
+
+// --------------------------------------------------
+// Local tree snapshot
+// - One FindFirstFileExW walk (FindExInfoBasic + FIND_FIRST_EX_LARGE_FETCH, Win7+; Vista gets
+//   FindExInfoStandard) of <install>\resources_override per run, which covers the sync root and
+//   the MapPack 4.0 folders.
+// - Every phase queries the snapshot instead of walking or stat'ing the disk again: existence
+//   checks before downloads, orphan detection, old-manifest cleanup and empty-dir removal.
+// - Phases keep it current (LocalTreeNoteFileAdded / LocalTreeNoteRemoved), so directory child
+//   counts stay exact and "is this folder empty" needs no further I/O.
+// - Junctions and directory symlinks are entered like folders (installs often move
+//   resources_override or mappack to another drive that way), but never removed themselves and
+//   never followed from inside another one, so a link back up the tree cannot loop. Other
+//   directory reparse points are recorded as leaves.
+// --------------------------------------------------
+static constexpr size_t kLocalTreeNone = (size_t)-1;
+struct LocalTreeEntry
+{
+	std::wstring rel;                   // relative to the snapshot root, '\\' separated, on-disk case
+	size_t parent = kLocalTreeNone;     // containing directory entry; kLocalTreeNone = snapshot root
+	unsigned long long size = 0;
+	unsigned long long lastWrite = 0;   // FILETIME as 100ns ticks (scan time)
+	DWORD attributes = 0;
+	size_t childCount = 0;              // directories: live entries directly inside
+	bool isDir = false;                 // directory, or a followed link (see linked); other reparse points are leaves
+	bool linked = false;                // junction / directory symlink the scan entered; never removed
+	bool listed = false;                // directory contents were enumerated
+	bool removed = false;
+	unsigned long long dirId = 0;       // directories: NTFS file reference number once known (tree cache); 0 = unknown
+};
+struct LocalTreeSnapshot
+{
+	fs::path root;
+	std::wstring rootKey;                              // LocalTreeKey(root)
+	std::vector<LocalTreeEntry> entries;
+	std::unordered_map<std::wstring, size_t> byKey;    // LocalTreeKey(rel) -> entry index
+	size_t fileCount = 0;
+	size_t dirCount = 0;
+};
+// '/' -> '\\', no repeated or trailing separators. Keeps the length equal to LocalTreeKey's.
+static std::wstring LocalTreeCleanPath(const std::wstring& in)
+{
+	std::wstring s;
+	s.reserve(in.size());
+	for (wchar_t ch : in)
+	{
+		if (ch == L'/') ch = L'\\';
+		if (ch == L'\\' && !s.empty() && s.back() == L'\\' && s.size() > 1) continue;
+		s.push_back(ch);
+	}
+	while (s.size() > 1 && s.back() == L'\\') s.pop_back();
+	return s;
+}
+static std::wstring LocalTreeKey(const std::wstring& path)
+{
+	std::wstring s = LocalTreeCleanPath(path);
+	std::transform(s.begin(), s.end(), s.begin(), [](wchar_t ch) { return (wchar_t)towlower(ch); });
+	return s;
+}
+// Lexical: callers pass paths built from the same install root (MakeDestPath and friends).
+// outRel is empty for the snapshot root itself.
+static bool LocalTreeRelOf(const LocalTreeSnapshot& tree, const fs::path& full, std::wstring& outRel)
+{
+	outRel.clear();
+	const std::wstring clean = LocalTreeCleanPath(full.wstring());
+	const std::wstring key = LocalTreeKey(clean);
+	const std::wstring& rk = tree.rootKey;
+	if (rk.empty() || key.size() < rk.size() || key.compare(0, rk.size(), rk) != 0)
+		return false;
+	if (key.size() == rk.size())
+		return true;
+	if (key[rk.size()] != L'\\')
+		return false;
+	outRel = clean.substr(rk.size() + 1);
+	return true;
+}
+// Inserts (or revives a removed) entry and counts it in its parent. Returns the entry index.
+static size_t LocalTreeInsert(LocalTreeSnapshot& tree, LocalTreeEntry&& e)
+{
+	std::wstring key = LocalTreeKey(e.rel);
+	size_t index = kLocalTreeNone;
+	auto it = tree.byKey.find(key);
+	if (it != tree.byKey.end())
+	{
+		index = it->second;
+		if (!tree.entries[index].removed)
+			return index;
+		tree.entries[index] = std::move(e);
+	}
+	else
+	{
+		index = tree.entries.size();
+		tree.entries.push_back(std::move(e));
+		tree.byKey.emplace(std::move(key), index);
+	}
+	const LocalTreeEntry& added = tree.entries[index];
+	if (added.parent != kLocalTreeNone)
+		++tree.entries[added.parent].childCount;
+	if (added.isDir) ++tree.dirCount;
+	else if (!(added.attributes & FILE_ATTRIBUTE_DIRECTORY)) ++tree.fileCount;
+	return index;
+}
+// Vista rejects FindExInfoBasic and FIND_FIRST_EX_LARGE_FETCH with ERROR_INVALID_PARAMETER;
+// after the first such failure every directory is opened the Vista way.
+static HANDLE LocalTreeFindFirst(const std::wstring& pattern, WIN32_FIND_DATAW& fd)
+{
+	static std::atomic<bool> basicUnsupported{ false };
+	if (!basicUnsupported.load(std::memory_order_relaxed))
+	{
+		HANDLE h = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &fd, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		if (h != INVALID_HANDLE_VALUE || GetLastError() != ERROR_INVALID_PARAMETER)
+			return h;
+		basicUnsupported.store(true, std::memory_order_relaxed);
+	}
+	return FindFirstFileExW(pattern.c_str(), FindExInfoStandard, &fd, FindExSearchNameMatch, nullptr, 0);
+}
+// dwReserved0 is the reparse tag when FILE_ATTRIBUTE_REPARSE_POINT is set.
+static bool LocalTreeIsFollowableLink(const WIN32_FIND_DATAW& fd)
+{
+	return (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+		&& (fd.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT || fd.dwReserved0 == IO_REPARSE_TAG_SYMLINK);
+}
+static bool LocalTreeIsInsideLink(const LocalTreeSnapshot& tree, size_t dirIndex)
+{
+	for (size_t p = dirIndex; p != kLocalTreeNone; p = tree.entries[p].parent)
+	{
+		if (tree.entries[p].linked)
+			return true;
+	}
+	return false;
+}
+// Enumerates startDir (kLocalTreeNone = the snapshot root) and everything below it into the
+// snapshot. Returns false only when canceled.
+static bool LocalTreeScanFrom(LocalTreeSnapshot& out, size_t startDir, const CancelToken& cancel)
+{
+	const std::wstring rootDir = LocalTreeCleanPath(out.root.wstring());
+	std::vector<size_t> pending{ startDir };   // directories still to enumerate
+	while (!pending.empty())
+	{
+		if (cancel.IsCanceled())
+			return false;
+		const size_t dirIndex = pending.back();
+		pending.pop_back();
+
+		const std::wstring dirRel = (dirIndex == kLocalTreeNone) ? std::wstring() : out.entries[dirIndex].rel;
+		const std::wstring pattern = rootDir + (dirRel.empty() ? L"" : L"\\" + dirRel) + L"\\*";
+		WIN32_FIND_DATAW fd{};
+		unique_hfind h(LocalTreeFindFirst(pattern, fd));
+		if (!h)
+			continue;   // unreadable (or missing root): left unlisted, so it is never treated as empty
+		if (dirIndex != kLocalTreeNone)
+			out.entries[dirIndex].listed = true;
+		do
+		{
+			const wchar_t* name = fd.cFileName;
+			if (name[0] == L'.' && (name[1] == 0 || (name[1] == L'.' && name[2] == 0)))
+				continue;
+			LocalTreeEntry e;
+			e.rel = dirRel.empty() ? std::wstring(name) : dirRel + L"\\" + name;
+			e.parent = dirIndex;
+			e.attributes = fd.dwFileAttributes;
+			e.size = ((unsigned long long)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+			e.lastWrite = ((unsigned long long)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+			e.isDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !(fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT);
+			if (LocalTreeIsFollowableLink(fd) && !LocalTreeIsInsideLink(out, dirIndex))
+				e.isDir = e.linked = true;
+			const size_t index = LocalTreeInsert(out, std::move(e));
+			if (out.entries[index].isDir)
+				pending.push_back(index);
+		} while (FindNextFileW(h.get(), &fd));
+	}
+	return true;
+}
+// Returns false only when canceled. A missing root yields an empty snapshot.
+static bool ScanLocalTree(const fs::path& root, LocalTreeSnapshot& out, const CancelToken& cancel)
+{
+	out = LocalTreeSnapshot{};
+	out.root = root;
+	out.rootKey = LocalTreeKey(root.wstring());
+	return LocalTreeScanFrom(out, kLocalTreeNone, cancel);
+}
+static fs::path LocalTreeFullPath(const LocalTreeSnapshot& tree, size_t index)
+{
+	return tree.root / tree.entries[index].rel;
+}
+static bool LocalTreeIsFile(const LocalTreeEntry& e)
+{
+	return !(e.attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+// Live entry for a path below the snapshot root, or kLocalTreeNone.
+static size_t LocalTreeFind(const LocalTreeSnapshot& tree, const fs::path& full)
+{
+	std::wstring rel;
+	if (!LocalTreeRelOf(tree, full, rel) || rel.empty())
+		return kLocalTreeNone;
+	auto it = tree.byKey.find(LocalTreeKey(rel));
+	if (it == tree.byKey.end() || tree.entries[it->second].removed)
+		return kLocalTreeNone;
+	return it->second;
+}
+static void LocalTreeNoteRemoved(LocalTreeSnapshot& tree, size_t index)
+{
+	LocalTreeEntry& e = tree.entries[index];
+	if (e.removed) return;
+	e.removed = true;
+	if (e.parent != kLocalTreeNone && tree.entries[e.parent].childCount > 0)
+		--tree.entries[e.parent].childCount;
+	if (e.isDir) --tree.dirCount;
+	else if (LocalTreeIsFile(e)) --tree.fileCount;
+}
+// Records a file written after the scan (and any folders created for it).
+static void LocalTreeNoteFileAdded(LocalTreeSnapshot& tree, const fs::path& full, unsigned long long size)
+{
+	std::wstring rel;
+	if (!LocalTreeRelOf(tree, full, rel) || rel.empty())
+		return;
+	size_t parent = kLocalTreeNone;
+	size_t pos = 0;
+	for (;;)
 	{
-		if (IsExcludedOrContainsExcludedPath(d))
+		const size_t sep = rel.find(L'\\', pos);
+		LocalTreeEntry e;
+		e.rel = rel.substr(0, sep);
+		e.parent = parent;
+		if (sep == std::wstring::npos)
 		{
-			ec.clear();
+			e.attributes = FILE_ATTRIBUTE_NORMAL;
+			e.size = size;
+			const size_t index = LocalTreeInsert(tree, std::move(e));
+			tree.entries[index].size = size;
+			return;
+		}
+		e.attributes = FILE_ATTRIBUTE_DIRECTORY;
+		e.isDir = true;
+		e.listed = true;
+		parent = LocalTreeInsert(tree, std::move(e));
+		pos = sep + 1;
+	}
+}
+// Live entries strictly below subRoot, in scan order. Empty if subRoot is not a scanned folder.
+static std::vector<size_t> LocalTreeListUnder(const LocalTreeSnapshot& tree, const fs::path& subRoot, bool wantDirs)
+{
+	std::vector<size_t> out;
+	std::wstring rel;
+	if (!LocalTreeRelOf(tree, subRoot, rel))
+		return out;
+	size_t ancestor = kLocalTreeNone;
+	if (!rel.empty())
+	{
+		ancestor = LocalTreeFind(tree, subRoot);
+		if (ancestor == kLocalTreeNone || !tree.entries[ancestor].isDir)
+			return out;
+	}
+	for (size_t i = 0; i < tree.entries.size(); ++i)
+	{
+		const LocalTreeEntry& e = tree.entries[i];
+		if (e.removed || (wantDirs ? !e.isDir : !LocalTreeIsFile(e)))
 			continue;
+		bool under = (ancestor == kLocalTreeNone);
+		for (size_t p = e.parent; !under && p != kLocalTreeNone; p = tree.entries[p].parent)
+			under = (p == ancestor);
+		if (under)
+			out.push_back(i);
+	}
+	return out;
+}
+
+// --------------------------------------------------
+// Local tree cache + NTFS change journal (MapPackSyncTool.<root>.treecache, next to the INI)
+// - After a clean sync the snapshot is saved together with the volume's USN journal ID and the
+//   journal position read before the snapshot was taken; every folder carries its NTFS file
+//   reference number.
+// - The next run reads the journal from that position. Records whose parent folder is in the
+//   snapshot name the folders that changed; only those subtrees are enumerated again (topmost
+//   ones only) and the rest comes from the cache, so an untouched install is never walked.
+// - This sync's own writes land after the saved position, so the next run re-reads exactly the
+//   folders it touched.
+// - Anything doubtful falls back to ScanLocalTree: not NTFS, no journal, no rights to open the
+//   volume (reading the journal needs an elevated process), another journal ID, records already
+//   overwritten, more than kMaxUsnReplayBytes of records to read, the root folder replaced, or
+//   a change directly inside the root.
+// - A tree with a directory reparse point is never cached: a followed junction can lead to
+//   another volume whose journal this one does not see, so those installs are scanned each run.
+// File format (UTF-8, one record per line, tab separated):
+//   MapPackSyncToolTreeCache 1
+//   root<TAB><LocalTreeKey of the snapshot root>
+//   journal<TAB><journal ID><TAB><USN><TAB><root folder file reference number>
+//   <attributes><TAB><listed 0/1><TAB><size><TAB><lastWriteFileTime><TAB><folder file reference number><TAB><rel>
+// --------------------------------------------------
+static constexpr const char* kTreeCacheHeader = "MapPackSyncToolTreeCache 1";
+struct UsnJournalMark
+{
+	unsigned long long journalId = 0;
+	long long usn = 0;        // journal position the snapshot is current from
+	bool valid = false;       // false = journal unusable; no cache is written
+};
+static fs::path GetTreeCachePath(const std::wstring& rootKey)
+{
+	std::string sha;
+	if (!Sha256StringHexLower(WideToUtf8(rootKey), sha))
+		return fs::path();
+	return fs::path(GetSettingsIniPath()).parent_path() / (L"MapPackSyncTool." + Utf8ToWide(sha.substr(0, 16)) + L".treecache");
+}
+static bool QueryDirectoryFileId(const fs::path& dir, unsigned long long& outId)
+{
+	outId = 0;
+	unique_handle h(CreateFileW(dir.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+	if (!h) return false;
+	BY_HANDLE_FILE_INFORMATION bhfi{};
+	if (!GetFileInformationByHandle(h.get(), &bhfi) || !(bhfi.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) return false;
+	outId = ((unsigned long long)bhfi.nFileIndexHigh << 32) | bhfi.nFileIndexLow;
+	return outId != 0;
+}
+// Handle to the NTFS volume holding `path`, for FSCTL_*_USN_JOURNAL. Empty on failure (outWhy says why).
+static unique_handle OpenUsnVolume(const fs::path& path, std::string& outWhy)
+{
+	wchar_t mount[MAX_PATH]{};
+	wchar_t volumeName[64]{};   // \\?\Volume{GUID}\ (50 chars)
+	if (!GetVolumePathNameW(path.c_str(), mount, MAX_PATH)
+		|| !GetVolumeNameForVolumeMountPointW(mount, volumeName, (DWORD)_countof(volumeName)))
+	{
+		outWhy = "volume not found";
+		return unique_handle();
+	}
+	wchar_t fsName[MAX_PATH + 1]{};
+	if (!GetVolumeInformationW(mount, nullptr, 0, nullptr, nullptr, nullptr, fsName, (DWORD)_countof(fsName)) || _wcsicmp(fsName, L"NTFS") != 0)
+	{
+		outWhy = "not an NTFS volume";
+		return unique_handle();
+	}
+	std::wstring device = volumeName;
+	if (!device.empty() && device.back() == L'\\')
+		device.pop_back();   // a trailing backslash would open the root folder instead of the volume
+	unique_handle h(CreateFileW(device.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr));
+	if (!h)
+		outWhy = IsLikelyAccessDeniedError(GetLastError()) ? "reading it needs administrator rights" : "volume could not be opened";
+	return h;
+}
+static bool LoadTreeCache(const fs::path& cachePath, const fs::path& root, LocalTreeSnapshot& out, UsnJournalMark& outMark,
+	unsigned long long& outRootId)
+{
+	out = LocalTreeSnapshot{};
+	out.root = root;
+	out.rootKey = LocalTreeKey(root.wstring());
+	outMark = UsnJournalMark{};
+	outRootId = 0;
+
+	std::ifstream f(cachePath, std::ios::binary);
+	if (!f) return false;
+	std::string line;
+	auto nextLine = [&]() {
+		if (!std::getline(f, line)) return false;
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		return true;
+	};
+	if (!nextLine() || line != kTreeCacheHeader) return false;
+	if (!nextLine() || !StartsWith(line, "root\t") || Utf8ToWide(line.substr(5)) != out.rootKey) return false;
+	if (!nextLine() || !StartsWith(line, "journal\t")) return false;
+	{
+		char* endp = nullptr;
+		const char* p = line.c_str() + 8;
+		outMark.journalId = _strtoui64(p, &endp, 10); if (!endp || *endp != '\t') return false;
+		outMark.usn = _strtoi64(endp + 1, &endp, 10); if (!endp || *endp != '\t') return false;
+		outRootId = _strtoui64(endp + 1, &endp, 10); if (!endp || *endp || outRootId == 0) return false;
+		outMark.valid = true;
+	}
+
+	while (nextLine())
+	{
+		if (line.empty()) continue;
+		// 5 numeric fields, then the rel path (which takes the rest of the line).
+		unsigned long long v[5]{};
+		const char* p = line.c_str();
+		for (int k = 0; k < 5; ++k)
+		{
+			char* endp = nullptr;
+			v[k] = _strtoui64(p, &endp, 10);
+			if (!endp || *endp != '\t') return false;
+			p = endp + 1;
+		}
+		LocalTreeEntry e;
+		e.rel = Utf8ToWide(p);
+		if (e.rel.empty()) return false;
+		e.attributes = (DWORD)v[0];
+		e.listed = v[1] != 0;
+		e.size = v[2];
+		e.lastWrite = v[3];
+		e.dirId = v[4];
+		if ((e.attributes & FILE_ATTRIBUTE_DIRECTORY) && (e.attributes & FILE_ATTRIBUTE_REPARSE_POINT)) return false;   // written before links were followed
+		e.isDir = (e.attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		if (e.isDir && e.dirId == 0) return false;   // changes inside it could not be recognized
+		const size_t sep = e.rel.rfind(L'\\');
+		if (sep != std::wstring::npos)
+		{
+			auto parent = out.byKey.find(LocalTreeKey(e.rel.substr(0, sep)));
+			if (parent == out.byKey.end() || !out.entries[parent->second].isDir) return false;
+			e.parent = parent->second;
+		}
+		LocalTreeInsert(out, std::move(e));
+	}
+	return true;
+}
+// Only worth writing with a usable journal mark and a file reference number for every folder.
+static bool WriteTreeCache(const fs::path& cachePath, LocalTreeSnapshot& tree, const UsnJournalMark& mark)
+{
+	unsigned long long rootId = 0;
+	if (!mark.valid || cachePath.empty() || !QueryDirectoryFileId(tree.root, rootId))
+		return false;
+	for (auto& e : tree.entries)
+	{
+		if (!e.removed && (e.attributes & FILE_ATTRIBUTE_DIRECTORY) && (e.attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+			return false;
+		if (!e.removed && e.isDir && e.dirId == 0 && !QueryDirectoryFileId(tree.root / e.rel, e.dirId))
+			return false;
+	}
+
+	std::string text;
+	text.reserve(128 + tree.entries.size() * 120);
+	text += kTreeCacheHeader;
+	text += "\r\nroot\t" + WideToUtf8(tree.rootKey) + "\r\n";
+	text += "journal\t" + std::to_string(mark.journalId) + "\t" + std::to_string(mark.usn) + "\t" + std::to_string(rootId) + "\r\n";
+	// Index order keeps every folder ahead of its contents (LocalTreeInsert revives entries in place).
+	for (const auto& e : tree.entries)
+	{
+		if (e.removed) continue;
+		text += std::to_string(e.attributes);
+		text += e.listed ? "\t1\t" : "\t0\t";
+		text += std::to_string(e.size);
+		text += '\t'; text += std::to_string(e.lastWrite);
+		text += '\t'; text += std::to_string(e.isDir ? e.dirId : 0ull);
+		text += '\t'; text += WideToUtf8(e.rel);
+		text += "\r\n";
+	}
+	return HttpCacheWriteFileAtomic(cachePath, text);
+}
+// Reads the journal from `from` up to stopUsn and collects the snapshot folders (kLocalTreeNone =
+// root) that had something inside them created, deleted, renamed or modified. False = the cache
+// cannot be trusted (outWhy says why).
+static bool CollectUsnChangedDirs(HANDLE volume, const UsnJournalMark& from, long long stopUsn, const LocalTreeSnapshot& tree,
+	unsigned long long rootId, std::vector<size_t>& outDirs, std::string& outWhy)
+{
+	outDirs.clear();
+	std::unordered_map<unsigned long long, size_t> dirsById;
+	dirsById.emplace(rootId, kLocalTreeNone);
+	for (size_t i = 0; i < tree.entries.size(); ++i)
+	{
+		const LocalTreeEntry& e = tree.entries[i];
+		if (!e.removed && e.isDir)
+			dirsById.emplace(e.dirId, i);
+	}
+
+	std::unordered_set<size_t> changed;
+	READ_USN_JOURNAL_DATA_V0 rd{};
+	rd.StartUsn = from.usn;
+	rd.ReasonMask = 0xFFFFFFFF;
+	rd.UsnJournalID = from.journalId;
+	std::vector<unsigned long long> buf(AppConstants::kUsnReadBufferBytes / sizeof(unsigned long long));   // 8-byte aligned records
+	while (rd.StartUsn < stopUsn)
+	{
+		DWORD got = 0;
+		if (!DeviceIoControl(volume, FSCTL_READ_USN_JOURNAL, &rd, sizeof(rd), buf.data(), (DWORD)(buf.size() * sizeof(buf[0])), &got, nullptr))
+		{
+			outWhy = (GetLastError() == ERROR_JOURNAL_ENTRY_DELETED) ? "records since the last sync were overwritten" : "journal read failed";
+			return false;
 		}
-		if (fs::is_directory(d, ec) && fs::is_empty(d, ec))
+		if (got <= sizeof(USN))
+			break;
+		const BYTE* base = reinterpret_cast<const BYTE*>(buf.data());
+		for (DWORD off = sizeof(USN); off + sizeof(USN_RECORD_V2) <= got;)
 		{
-			ec.clear();
-			if (fs::remove(d, ec) && !ec)
+			const USN_RECORD_V2* rec = reinterpret_cast<const USN_RECORD_V2*>(base + off);
+			if (rec->RecordLength == 0 || off + rec->RecordLength > got)
+				break;
+			if (rec->MajorVersion != 2)
 			{
-				Log("  REMOVED EMPTY DIR: " + PathToUtf8(d) + "\r\n");
-				++stats.removed;
+				outWhy = "unsupported journal record version";
+				return false;
 			}
-			else
+			if (rec->FileReferenceNumber == rootId && (rec->Reason & (USN_REASON_RENAME_OLD_NAME | USN_REASON_FILE_DELETE)))
 			{
-				++stats.failed;
-				Log("  FAILED REMOVE EMPTY DIR: " + PathToUtf8(d) + " (" + (ec ? ec.message() : std::string("unknown")) + ")\r\n");
-				ec.clear();
+				outWhy = "the scanned folder was moved or deleted";
+				return false;
 			}
+			auto parent = dirsById.find(rec->ParentFileReferenceNumber);
+			if (parent != dirsById.end())
+				changed.insert(parent->second);
+			off += rec->RecordLength;
 		}
-		else
-		{
-			ec.clear();
-		}
+		const USN next = *reinterpret_cast<const USN*>(base);
+		if (next <= rd.StartUsn)
+			break;
+		rd.StartUsn = next;
+	}
+
+	// A changed folder below another changed folder is covered by the outer rescan.
+	if (changed.count(kLocalTreeNone))
+	{
+		outDirs.push_back(kLocalTreeNone);
+		return true;
 	}
-	if (removeRoot)
+	for (size_t dir : changed)
 	{
-		if (IsExcludedOrContainsExcludedPath(root))
+		bool covered = false;
+		for (size_t p = tree.entries[dir].parent; !covered && p != kLocalTreeNone; p = tree.entries[p].parent)
+			covered = changed.count(p) != 0;
+		if (!covered)
+			outDirs.push_back(dir);
+	}
+	return true;
+}
+// Replaces everything the snapshot holds below each folder in `dirs` with a fresh enumeration.
+// Returns false only when canceled.
+static bool LocalTreeRescanDirs(LocalTreeSnapshot& tree, const std::vector<size_t>& dirs, const CancelToken& cancel)
+{
+	std::vector<std::vector<size_t>> children(tree.entries.size());
+	for (size_t i = 0; i < tree.entries.size(); ++i)
+	{
+		const LocalTreeEntry& e = tree.entries[i];
+		if (!e.removed && e.parent != kLocalTreeNone)
+			children[e.parent].push_back(i);
+	}
+	for (size_t dir : dirs)
+	{
+		if (cancel.IsCanceled())
+			return false;
+		std::vector<size_t> stack = children[dir];
+		while (!stack.empty())
 		{
-			ec.clear();
-			return stats;
+			const size_t i = stack.back();
+			stack.pop_back();
+			LocalTreeNoteRemoved(tree, i);
+			stack.insert(stack.end(), children[i].begin(), children[i].end());
 		}
-		if (fs::is_directory(root, ec) && fs::is_empty(root, ec))
-		{
-			ec.clear();
-			if (fs::remove(root, ec) && !ec)
-			{
-				Log("  REMOVED EMPTY DIR: " + PathToUtf8(root) + "\r\n");
-				++stats.removed;
-			}
+		tree.entries[dir].listed = false;
+		if (!LocalTreeScanFrom(tree, dir, cancel))
+			return false;
+		if (!tree.entries[dir].listed && GetFileAttributesW(LocalTreeFullPath(tree, dir).c_str()) == INVALID_FILE_ATTRIBUTES)
+			LocalTreeNoteRemoved(tree, dir);
+	}
+	return true;
+}
+// Fills `tree` for root from the tree cache plus the change journal when it can, else scans it.
+// outMark is the journal position to save with the snapshot after a clean sync (WriteTreeCache),
+// taken before anything is read so no change can slip between the two. False only when canceled.
+static bool LoadOrScanLocalTree(const fs::path& root, const fs::path& cachePath, LocalTreeSnapshot& tree, UsnJournalMark& outMark,
+	const CancelToken& cancel)
+{
+	outMark = UsnJournalMark{};
+	std::string why;
+	unique_handle volume;
+	const DWORD rootAttrs = GetFileAttributesW(root.c_str());
+	if (rootAttrs != INVALID_FILE_ATTRIBUTES && (rootAttrs & FILE_ATTRIBUTE_REPARSE_POINT))
+		why = "the folder is a junction or symbolic link";   // its files live on the target's volume
+	else
+		volume = OpenUsnVolume(root, why);
+	USN_JOURNAL_DATA_V0 jd{};
+	DWORD got = 0;
+	if (volume && !DeviceIoControl(volume.get(), FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &jd, sizeof(jd), &got, nullptr))
+	{
+		why = "journal not active";
+		volume.reset();
+	}
+	if (volume)
+	{
+		outMark.journalId = jd.UsnJournalID;
+		outMark.usn = jd.NextUsn;
+		outMark.valid = true;
+
+		UsnJournalMark cached;
+		unsigned long long rootId = 0, liveRootId = 0;
+		std::vector<size_t> dirs;
+		if (cachePath.empty() || !LoadTreeCache(cachePath, root, tree, cached, rootId))
+			why = "no saved snapshot yet";
+		else if (cached.journalId != jd.UsnJournalID || cached.usn < jd.FirstUsn || cached.usn > jd.NextUsn)
+			why = "the journal was reset or has wrapped since the last sync";
+		else if ((unsigned long long)(jd.NextUsn - cached.usn) > AppConstants::kMaxUsnReplayBytes)
+			why = "too many changes on the volume since the last sync";
+		else if (!QueryDirectoryFileId(root, liveRootId) || liveRootId != rootId)
+			why = "the scanned folder was replaced";
+		else if (CollectUsnChangedDirs(volume.get(), cached, jd.NextUsn, tree, rootId, dirs, why))
+		{
+			if (std::find(dirs.begin(), dirs.end(), kLocalTreeNone) != dirs.end())
+				why = "files changed directly in resources_override";
 			else
 			{
-				++stats.failed;
-				Log("  FAILED REMOVE EMPTY DIR: " + PathToUtf8(root) + " (" + (ec ? ec.message() : std::string("unknown")) + ")\r\n");
-				ec.clear();
+				if (!LocalTreeRescanDirs(tree, dirs, cancel))
+					return false;
+				Log("INFO: Local files taken from the last snapshot; " + std::to_string(dirs.size())
+					+ " changed folder(s) re-scanned (NTFS change journal).\r\n");
+				return true;
 			}
 		}
+	}
+	Log("INFO: Scanning all local files (change journal not used: " + why + ").\r\n");
+	return ScanLocalTree(root, tree, cancel);
+}
+
+// --------------------------------------------------
+// Helpers
+// --------------------------------------------------
+struct EmptyDirRemovalStats
+{
+	int removed = 0;
+	int failed = 0;
+
+	EmptyDirRemovalStats& operator+=(const EmptyDirRemovalStats& rhs)
+	{
+		removed += rhs.removed;
+		failed += rhs.failed;
+		return *this;
+	}
+};
+
+// Every folder that is empty now is found from the snapshot's child counts, and removing one
+// re-checks only its parent, so a parent emptied by its children's removal is caught in the same
+// pass without listing, sorting or stat'ing any other folder.
+static EmptyDirRemovalStats RemoveEmptyDirsBottomUp(const ExclusionMatcher& exclusions, LocalTreeSnapshot& tree,
+	const fs::path& root, bool removeRoot = false)
+{
+	EmptyDirRemovalStats stats;
+	const size_t rootIndex = LocalTreeFind(tree, root);
+	if (rootIndex == kLocalTreeNone || !tree.entries[rootIndex].isDir)
+		return stats;
+	auto isCandidate = [&](size_t d) {
+		const LocalTreeEntry& e = tree.entries[d];
+		if (e.removed || !e.isDir || e.linked || !e.listed || e.childCount != 0)
+			return false;
+		if (d == rootIndex)
+			return removeRoot;
+		for (size_t p = e.parent; p != kLocalTreeNone; p = tree.entries[p].parent)
+		{
+			if (p == rootIndex)
+				return true;
+		}
+		return false;
+	};
+	std::vector<size_t> pending;
+	for (size_t d = 0; d < tree.entries.size(); ++d)
+	{
+		if (isCandidate(d))
+			pending.push_back(d);
+	}
+	while (!pending.empty())
+	{
+		const size_t d = pending.back();
+		pending.pop_back();
+		if (!isCandidate(d))
+			continue;
+		const fs::path dir = LocalTreeFullPath(tree, d);
+		if (IsExcludedOrContainsExcludedPath(exclusions, dir))
+			continue;
+		std::error_code ec;
+		if (fs::remove(dir, ec) && !ec)
+		{
+			Log("  REMOVED EMPTY DIR: " + PathToUtf8(dir) + "\r\n");
+			++stats.removed;
+			LocalTreeNoteRemoved(tree, d);
+			const size_t parent = tree.entries[d].parent;
+			if (d != rootIndex && parent != kLocalTreeNone && isCandidate(parent))
+				pending.push_back(parent);
+		}
 		else
 		{
-			ec.clear();
+			++stats.failed;
+			Log("  FAILED REMOVE EMPTY DIR: " + PathToUtf8(dir) + " (" + (ec ? ec.message() : std::string("unknown")) + ")\r\n");
 		}
 	}
 	return stats;
@@ -4130,7 +7155,7 @@ static void UpdateClientPrefsMapPath(const SyncConfig& cfg, const CancelToken& c
 	try
 	{
 		const fs::path prefsFile = cfg.localBase / "prefs" / "ClientPrefs_Common.def";
-		if (IsPathExcluded(prefsFile))
+		if (IsPathExcluded(cfg.exclusions, prefsFile))
 		{
 			Log(std::string("\\prefs\\ClientPrefs_Common.def check: EXCLUSION SKIPPED: ") + PathToUtf8(prefsFile) + "\r\n");
 			return;
@@ -4289,17 +7314,94 @@ static bool ParseManifestOldPaths(const std::string& jsonText, std::vector<std::
 	return !outPaths.empty();
 }
 
-static void RemoveOldManifestListedFiles(const SyncConfig& cfg, const CancelToken& cancel)
+// --------------------------------------------------
+// MapPack 4.0 clean-up marker (per install, next to the INI)
+// - Written once a clean-up pass leaves nothing behind: no legacy file found, deleted or failed,
+//   none kept by an exclusion, no empty-folder failure. It records the sha256 of the
+//   mappack_manifest_old.json that pass used.
+// - While mappack_manifest_old.sha256 (published by ManifestOld) still names that sha256, later
+//   syncs/removals skip the old-manifest download and the whole clean-up. ForceFullVerify, a
+//   missing head file or any other mismatch runs it as before.
+// File format (UTF-8): header line, then root<TAB><rootKey> and manifest<TAB><sha256>.
+// --------------------------------------------------
+static constexpr const char* kLegacyCleanupHeader = "MapPackSyncToolLegacyCleanup 1";
+static fs::path GetLegacyCleanupMarkerPath(const std::wstring& rootKey)
 {
-	if (cancel.IsCanceled()) return;
-	LogSeparator();
-	Log("Downloading manifest for old MapPack 4.0 (applies to earlier versions, too) ... ");
-
-	const std::string url = JoinUrl(cfg.remoteHost, kManifestOldPath);
-	std::string jsonText;
+	std::string sha;
+	if (!Sha256StringHexLower(WideToUtf8(rootKey), sha))
+		return fs::path();
+	return fs::path(GetSettingsIniPath()).parent_path() / (L"MapPackSyncTool." + Utf8ToWide(sha.substr(0, 16)) + L".legacydone");
+}
+static bool LoadLegacyCleanupMarker(const fs::path& markerPath, const std::wstring& rootKey, std::string& outManifestSha)
+{
+	outManifestSha.clear();
+	if (markerPath.empty()) return false;
+	std::ifstream f(markerPath, std::ios::binary);
+	if (!f) return false;
+	std::string line;
+	bool headerOk = false, rootOk = false;
+	while (std::getline(f, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (!headerOk)
+		{
+			if (line != kLegacyCleanupHeader) return false;
+			headerOk = true;
+			continue;
+		}
+		const size_t tab = line.find('\t');
+		if (tab == std::string::npos) continue;
+		const std::string key = line.substr(0, tab);
+		const std::string value = line.substr(tab + 1);
+		if (key == "root")
+			rootOk = Utf8ToWide(value) == rootKey;
+		else if (key == "manifest")
+			outManifestSha = ToLowerAsciiCopy(value);
+	}
+	if (!rootOk || !IsHex64(outManifestSha))
+	{
+		outManifestSha.clear();
+		return false;
+	}
+	return true;
+}
+// Published sha256 of mappack_manifest_old.json; "" when the server has no (valid) head file.
+static std::string FetchManifestOldHead(const SyncConfig& cfg, const CancelToken& cancel)
+{
+	std::string headText, err;
+	long http = 0;
+	if (!DownloadUrl(JoinUrl(cfg.remoteHost, kManifestOldHeadPath), headText, cancel, &err, &http))
+		return std::string();
+	const std::string head = ToLowerAsciiCopy(headText.substr(0, std::min<size_t>(headText.size(), 64)));
+	return IsHex64(head) ? head : std::string();
+}
+
+static void RemoveOldManifestListedFiles(const SyncConfig& cfg, LocalTreeSnapshot& tree, const CancelToken& cancel)
+{
+	if (cancel.IsCanceled()) return;
+	LogSeparator();
+
+	const std::wstring rootKey = NormalizeExclusionPathForCompare(cfg.localSyncRoot);
+	const fs::path markerPath = GetLegacyCleanupMarkerPath(rootKey);
+	const std::string head = FetchManifestOldHead(cfg, cancel);
+	if (cancel.IsCanceled()) return;
+	std::string doneSha;
+	if (!cfg.forceFullVerify && LoadLegacyCleanupMarker(markerPath, rootKey, doneSha))
+	{
+		if (head == doneSha)
+		{
+			Log("MapPack 4.0 Clean-up: already complete for this install (old manifest unchanged); skipped.\r\n");
+			return;
+		}
+	}
+
+	Log("Downloading manifest for old MapPack 4.0 (applies to earlier versions, too) ... ");
+
+	const std::string url = JoinUrl(cfg.remoteHost, kManifestOldPath);
+	std::string jsonText;
 	std::string dlErr;
 	long http = 0;
-	if (!DownloadUrl(url, jsonText, cancel, &dlErr, &http))
+	if (!DownloadUrl(url, jsonText, cancel, &dlErr, &http, head))
 	{
 		Log("  (skipped) Could not download mappack_manifest_old.json (" + std::to_string(http) + "): " + dlErr + "\r\n");
 		return;
@@ -4320,28 +7422,30 @@ static void RemoveOldManifestListedFiles(const SyncConfig& cfg, const CancelToke
 
 	int deleted = 0;
 	int failed = 0;
+	int skippedExcluded = 0;
+	// Lookups go to the in-memory snapshot of resources_override (no stat per legacy path).
 	for (const auto& rp : relPaths)
 	{
 		if (cancel.IsCanceled()) return;
 
 		// Old files live directly under resources_override\resources\...
-		std::error_code ec;
 		fs::path local = oldRoot / fs::path(Utf8ToWide(rp));
-		if (!fs::exists(local, ec) || ec) continue;
-		ec.clear();
-		if (!fs::is_regular_file(local, ec) || ec) continue;
+		const size_t found = LocalTreeFind(tree, local);
+		if (found == kLocalTreeNone || !LocalTreeIsFile(tree.entries[found])) continue;
 
-		if (IsPathExcluded(local))
+		if (IsPathExcluded(cfg.exclusions, local))
 		{
+			++skippedExcluded;
 			Log("  EXCLUSION SKIPPED: " + PathToUtf8(local) + "\r\n");
 			continue;
 		}
 
-		ec.clear();
+		std::error_code ec;
 		fs::remove(local, ec);
 		if (!ec)
 		{
 			++deleted;
+			LocalTreeNoteRemoved(tree, found);
 			Log("  DELETED: " + rp + "\r\n");
 		}
 		else
@@ -4365,24 +7469,38 @@ static void RemoveOldManifestListedFiles(const SyncConfig& cfg, const CancelToke
 		Log("  No files found that needs deleted.\r\n");
 
 
-	if (!cancel.IsCanceled())
-	{
-		LogSeparator();
-		Log("MapPack 4.0 Clean-up: Searching empty sub-directories (maps/textures folders only) that exists (Needs deleted) ...\r\n");
+	if (cancel.IsCanceled())
+		return;
 
-		EmptyDirRemovalStats oldDirStats;
-		oldDirStats += RemoveEmptyDirsBottomUp(oldMapsRoot);
-		oldDirStats += RemoveEmptyDirsBottomUp(oldTexturesRoot);
+	LogSeparator();
+	Log("MapPack 4.0 Clean-up: Searching empty sub-directories (maps/textures folders only) that exists (Needs deleted) ...\r\n");
 
-		if (oldDirStats.removed == 0 && oldDirStats.failed == 0)
-			Log("  No empty sub-directories found that needs deleted.\r\n");
-		else
-		{
-			Log("\r\nEmpty Subdirectories Removal Summary:\r\n");
-			Log("  Deletions: " + std::to_string(oldDirStats.removed) + "\r\n");
-			Log("  Failed deletions: " + std::to_string(oldDirStats.failed) + "\r\n");
-		}
+	EmptyDirRemovalStats oldDirStats;
+	oldDirStats += RemoveEmptyDirsBottomUp(cfg.exclusions, tree, oldMapsRoot);
+	oldDirStats += RemoveEmptyDirsBottomUp(cfg.exclusions, tree, oldTexturesRoot);
+
+	if (oldDirStats.removed == 0 && oldDirStats.failed == 0)
+		Log("  No empty sub-directories found that needs deleted.\r\n");
+	else
+	{
+		Log("\r\nEmpty Subdirectories Removal Summary:\r\n");
+		Log("  Deletions: " + std::to_string(oldDirStats.removed) + "\r\n");
+		Log("  Failed deletions: " + std::to_string(oldDirStats.failed) + "\r\n");
+	}
+
+	// Marker only for a pass that had nothing left to do; anything else re-checks next time.
+	std::error_code ec;
+	std::string manifestSha;
+	if (cancel.IsCanceled() || markerPath.empty())
+		return;
+	if (deleted == 0 && failed == 0 && skippedExcluded == 0 && oldDirStats.removed == 0 && oldDirStats.failed == 0
+		&& Sha256StringHexLower(jsonText, manifestSha))
+	{
+		const std::string text = std::string(kLegacyCleanupHeader) + "\r\nroot\t" + WideToUtf8(rootKey) + "\r\nmanifest\t" + manifestSha + "\r\n";
+		(void)HttpCacheWriteFileAtomic(markerPath, text);   // best effort: without it the next run just checks again
 	}
+	else
+		fs::remove(markerPath, ec);
 }
 
 // which extensions to sync
@@ -4429,78 +7547,378 @@ static bool BrowseForFolder(HWND hwnd, std::wstring& outPath, const std::wstring
 // --------------------------------------------------
 // Manifest / Sync types
 // --------------------------------------------------
+// Counters are atomic because DownloadAndUpdateFiles updates them from its worker pool.
 struct SyncCounters
 {
-	size_t deleted = 0;
-	size_t downloaded = 0;
-	size_t updated = 0;
-	size_t unchanged = 0;
-	size_t failed = 0;
-	size_t skippedExcluded = 0;
+	std::atomic<size_t> deleted{ 0 };
+	std::atomic<size_t> downloaded{ 0 };
+	std::atomic<size_t> updated{ 0 };
+	std::atomic<size_t> unchanged{ 0 };
+	std::atomic<size_t> failed{ 0 };
+	std::atomic<size_t> skippedExcluded{ 0 };
+	std::atomic<size_t> hashIndexHits{ 0 };   // unchanged files trusted from the hash index (no re-hash)
+	std::atomic<size_t> sizeMismatches{ 0 };  // stale files detected by manifest size alone (no hash)
+	std::atomic<size_t> localCopies{ 0 };     // missing/changed files filled from identical content on disk
+	std::atomic<size_t> packedFiles{ 0 };     // files split out of pack bundles fetched with range requests
+	std::atomic<size_t> manifestDiffSkips{ 0 };  // unchanged since the last applied manifest (not opened)
 };
+// workList views point into manifestText and arena, so this is move-only and manifestText must
+// not change once it has been parsed.
 struct ManifestData
 {
-	std::vector<ManifestEntry> workList;
-	std::unordered_set<std::string> manifestRelSet;
+	std::vector<ManifestEntry> workList;   // sorted by relPath; ManifestHasRel binary-searches it
 	std::string manifestSha256Lower;
+	std::string manifestText;   // exact bytes hashed above; cached locally as the next delta base
+	StringArena arena;          // entry strings that are not verbatim in manifestText
+	std::string sourceNote;     // how the manifest was obtained, when a delta base existed
+
+	ManifestData() = default;
+	ManifestData(ManifestData&&) = default;
+	ManifestData& operator=(ManifestData&&) = default;
+	ManifestData(const ManifestData&) = delete;
+	ManifestData& operator=(const ManifestData&) = delete;
 };
-static std::string MakeFileUrlFromRemoteHost(const std::string& remotePath)
+static bool ManifestHasRel(const ManifestData& md, std::string_view rel)
 {
-	// kRemoteHost has no trailing slash. remotePath in the manifest is expected to be relative,
-	// but we defensively handle a leading '/' as well.
-	std::string url = kRemoteHost;
-	if (!url.empty() && url.back() != '/') url.push_back('/');
-	if (!remotePath.empty() && remotePath.front() == '/')
-		return url + remotePath.substr(1);
-	return url + remotePath;
+	auto it = std::lower_bound(md.workList.begin(), md.workList.end(), rel,
+		[](const ManifestEntry& e, std::string_view r) { return e.relPath < r; });
+	return it != md.workList.end() && it->relPath == rel;
 }
 // --------------------------------------------------
-// Manifest download + parsing
+// Manifest delta chain
+// - ManifestSha256 --delta publishes mappack_manifest_deltas/<fromSha>.json for each new
+//   manifest (added / changed / removed entries against the previous one), plus the tiny
+//   mappack_manifest.sha256 head file naming the current manifest.
+// - The client keeps the manifest it last applied (MapPackSyncTool.manifest.json, next to the
+//   INI, matching [Manifest] LastSyncedManifestSha256) and walks deltas from it to the head.
+// - The rebuilt manifest is re-serialized exactly as ManifestSha256 writes it, so its SHA-256
+//   must equal the head. Any gap, parse error or mismatch falls back to the full download.
 // --------------------------------------------------
-static bool DownloadAndParseManifest(const SyncConfig& cfg, ManifestData& out, std::string& outErr, const CancelToken& cancel)
+struct ManifestDelta
 {
-	if (cancel.IsCanceled()) { outErr = "canceled"; return false; }
-	out = ManifestData{};
-	outErr.clear();
-	Log("Downloading MapPack 5.0 manifest ... ");
+	std::string from;   // sha256 of the manifest this delta applies to
+	std::string to;     // sha256 of the manifest it produces
+	std::vector<ManifestRawEntry> added;
+	std::vector<ManifestRawEntry> changed;
+	std::vector<ManifestRawEntry> removed;   // sha256 is the old value being removed
+};
+struct ManifestFileInfo
+{
+	std::string sha256;
+	long long size = -1;
+};
+static fs::path GetManifestCachePath()
+{
+	return fs::path(GetSettingsIniPath()).parent_path() / kManifestCacheFileName;
+}
+static bool LoadCachedManifest(const std::string& expectedSha256Lower, std::string& outText)
+{
+	outText.clear();
+	std::ifstream f(GetManifestCachePath(), std::ios::binary);
+	if (!f) return false;
+	std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	std::string sha;
+	if (!Sha256StringHexLower(data, sha) || sha != expectedSha256Lower)
+		return false;
+	outText.swap(data);
+	return true;
+}
+static bool WriteCachedManifest(const std::string& manifestText)
+{
+	// Folders of a headless /sync batch finish concurrently with the same manifest.
+	static std::mutex lock;
+	std::lock_guard<std::mutex> guard(lock);
+	return HttpCacheWriteFileAtomic(GetManifestCachePath(), manifestText);
+}
+static bool ParseManifestDelta(const std::string& s, ManifestDelta& out, std::string* outErr)
+{
+	out = ManifestDelta{};
+	if (outErr) outErr->clear();
+	size_t i = 0;
+	SkipWs(s, i);
+	if (i >= s.size() || s[i] != '{') { if (outErr) *outErr = "expected top-level object"; return false; }
+	++i;
+	for (;;)
+	{
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated top-level object"; return false; }
+		if (s[i] == '}') { ++i; break; }
 
-	PostProgressMarqueeOn();
-	PostProgressTextW(L"Downloading manifest ...");
-	std::string manifestText;
-	std::string dlErr; long http = 0;
-	if (!DownloadUrl(cfg.manifestUrl, manifestText, cancel, &dlErr, &http))
+		std::string key;
+		if (!ReadJsonString(s, i, key, outErr)) return false;
+		SkipWs(s, i);
+		if (i >= s.size() || s[i] != ':') { if (outErr) *outErr = "expected ':' after key"; return false; }
+		++i;
+		SkipWs(s, i);
+
+		bool ok = true;
+		if (key == "from") ok = ReadJsonString(s, i, out.from, outErr);
+		else if (key == "to") ok = ReadJsonString(s, i, out.to, outErr);
+		else if (key == "added") ok = ParseManifestFileArray(s, i, out.added, "added", outErr);
+		else if (key == "changed") ok = ParseManifestFileArray(s, i, out.changed, "changed", outErr);
+		else if (key == "removed") ok = ParseManifestFileArray(s, i, out.removed, "removed", outErr);
+		else ok = SkipJsonValue(s, i, 0, outErr);
+		if (!ok) return false;
+
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated top-level object"; return false; }
+		if (s[i] == ',') { ++i; continue; }
+		if (s[i] == '}') { ++i; break; }
+		if (outErr) *outErr = "expected ',' or '}' in top-level object";
+		return false;
+	}
+	out.from = ToLowerAsciiCopy(out.from);
+	out.to = ToLowerAsciiCopy(out.to);
+	if (!IsHex64(out.from) || !IsHex64(out.to))
+	{
+		if (outErr) *outErr = "missing or invalid from/to sha256";
+		return false;
+	}
+	return true;
+}
+// Applies in place; path -> sha256, ordered the same way ManifestSha256 sorts its entries.
+static bool ApplyManifestDelta(const ManifestDelta& d, std::map<std::string, ManifestFileInfo>& files, std::string* outErr)
+{
+	for (const auto& e : d.removed)
+	{
+		auto it = files.find(e.path);
+		if (it == files.end() || !EqualIcaseAscii(it->second.sha256, e.sha256))
+		{
+			if (outErr) *outErr = "removed entry does not match base: " + e.path;
+			return false;
+		}
+		files.erase(it);
+	}
+	for (const auto& e : d.changed)
+	{
+		auto it = files.find(e.path);
+		if (it == files.end())
+		{
+			if (outErr) *outErr = "changed entry missing from base: " + e.path;
+			return false;
+		}
+		it->second.sha256 = e.sha256;
+		it->second.size = e.size;
+	}
+	for (const auto& e : d.added)
+	{
+		if (!files.emplace(e.path, ManifestFileInfo{ e.sha256, e.size }).second)
+		{
+			if (outErr) *outErr = "added entry already in base: " + e.path;
+			return false;
+		}
+	}
+	return true;
+}
+static void AppendManifestJsonEscaped(std::string& out, const std::string& s)
+{
+	// Same (minimal) escaping as ManifestSha256's json_escape().
+	for (char c : s)
+	{
+		switch (c)
+		{
+		case '\\': out += "\\\\"; break;
+		case '"':  out += "\\\""; break;
+		case '\r': out += "\\r"; break;
+		case '\n': out += "\\n"; break;
+		case '\t': out += "\\t"; break;
+		default:   out += c; break;
+		}
+	}
+}
+static std::string SerializeManifestCanonical(const std::map<std::string, ManifestFileInfo>& files)
+{
+	std::string json;
+	json.reserve(files.size() * 160 + 32);
+	json += "{\n  \"files\": [\n";
+	size_t n = 0;
+	for (const auto& kv : files)
+	{
+		json += "    {\n      \"path\": \"";
+		AppendManifestJsonEscaped(json, kv.first);
+		json += "\",\n      \"sha256\": \"";
+		json += kv.second.sha256;
+		if (kv.second.size >= 0)
+		{
+			json += "\",\n      \"size\": ";
+			json += std::to_string(kv.second.size);
+			json += "\n    }";
+		}
+		else
+			json += "\"\n    }";
+		if (++n < files.size()) json += ",";
+		json += "\n";
+	}
+	json += "  ]\n}\n";
+	return json;
+}
+// Returns true with the current manifest text when it could be produced without downloading the
+// full manifest. outNote explains what happened (empty when no delta base exists yet).
+// The head file is only a shortcut: one left over from an upload that skipped it would pin Sync
+// to the manifest it names (or one rebuilt to it) for good. So the candidate is checked against
+// the manifest itself, a 304 against the HTTP cache in the usual case (the startup check fetched
+// it), and replaced by whatever the manifest is now when they differ.
+static bool RevalidateManifestCandidate(const SyncConfig& cfg, const CancelToken& cancel,
+	std::string& ioText, std::string& ioSha256Lower, std::string& ioNote)
+{
+	std::string current, err, sha;
+	long http = 0;
+	if (!DownloadUrl(cfg.manifestUrl, current, cancel, &err, &http) || !Sha256StringHexLower(current, sha))
+	{
+		ioText.clear();
+		ioSha256Lower.clear();
+		ioNote = "manifest revalidation failed (HTTP " + std::to_string(http) + ")";
+		return false;
+	}
+	if (sha != ioSha256Lower)
+	{
+		ioText.swap(current);
+		ioSha256Lower = sha;
+		ioNote = "full download (manifest head is stale)";
+	}
+	return true;
+}
+static bool TryBuildManifestFromDeltas(const SyncConfig& cfg, const CancelToken& cancel,
+	std::string& outText, std::string& outSha256Lower, std::string& outNote, std::string& outHeadSha256Lower)
+{
+	outText.clear();
+	outSha256Lower.clear();
+	outNote.clear();
+	outHeadSha256Lower.clear();
+
+	const std::string base = ToLowerAsciiCopy(WideToUtf8(IniReadLastSyncedManifestSha256()));
+	if (!IsHex64(base)) return false;
+	std::string baseText;
+	if (!LoadCachedManifest(base, baseText)) return false;
+
+	std::string headText, err;
+	long http = 0;
+	if (!DownloadUrl(JoinUrl(cfg.remoteHost, kManifestHeadPath), headText, cancel, &err, &http))
 	{
-		PostProgressMarqueeOff();
-		outErr = "Manifest download failed (HTTP " + std::to_string(http) + "): " + dlErr;
+		outNote = "no manifest head published (HTTP " + std::to_string(http) + ")";
 		return false;
 	}
-	if (!Sha256StringHexLower(manifestText, out.manifestSha256Lower))
+	std::string head = ToLowerAsciiCopy(headText.substr(0, std::min<size_t>(headText.size(), 64)));
+	if (!IsHex64(head))
 	{
-		PostProgressMarqueeOff();
-		outErr = "Manifest SHA-256 calculation failed.";
+		outNote = "invalid manifest head";
 		return false;
 	}
+	outHeadSha256Lower = head;
+	if (head == base)
+	{
+		outText.swap(baseText);
+		outSha256Lower = base;
+		outNote = "unchanged since last sync (cached copy)";
+		return RevalidateManifestCandidate(cfg, cancel, outText, outSha256Lower, outNote);
+	}
 
 	std::vector<ManifestRawEntry> rawFiles;
-	std::string parseErr;
-	if (!ParseManifestRaw(manifestText, rawFiles, &parseErr))
+	if (!ParseManifestRaw(baseText, rawFiles, &err))
 	{
-		PostProgressMarqueeOff();
-		outErr = "Manifest parse failed: " + (parseErr.empty() ? std::string("unknown error") : parseErr);
+		outNote = "cached manifest unreadable: " + err;
 		return false;
 	}
-	PostProgressMarqueeOff();
+	std::map<std::string, ManifestFileInfo> files;
+	for (auto& e : rawFiles)
+	{
+		if (!files.emplace(std::move(e.path), ManifestFileInfo{ std::move(e.sha256), e.size }).second)
+		{
+			outNote = "cached manifest has duplicate paths";
+			return false;
+		}
+	}
+
+	std::string cur = base;
+	size_t deltaBytes = 0;
+	int steps = 0;
+	while (cur != head)
+	{
+		if (steps >= AppConstants::kMaxManifestDeltaChain)
+		{
+			outNote = "delta chain longer than " + std::to_string(AppConstants::kMaxManifestDeltaChain);
+			return false;
+		}
+		// Deltas are never re-published, so skip the *.json.gz probe and go straight to the object.
+		std::string deltaText;
+		const std::string url = JoinUrl(cfg.remoteHost, std::string(kManifestDeltaDirPath) + cur + ".json");
+		if (!DownloadUrlCached(url, deltaText, cancel, &err, &http))
+		{
+			outNote = "delta " + cur.substr(0, 12) + " unavailable (HTTP " + std::to_string(http) + ")";
+			return false;
+		}
+		ManifestDelta d;
+		if (!ParseManifestDelta(deltaText, d, &err) || d.from != cur || !ApplyManifestDelta(d, files, &err))
+		{
+			outNote = "delta " + cur.substr(0, 12) + " rejected: " + (err.empty() ? std::string("base mismatch") : err);
+			return false;
+		}
+		deltaBytes += deltaText.size();
+		cur = d.to;
+		++steps;
+	}
 
-	std::string valErr;
-	if (!ValidateAndNormalizeManifest(rawFiles, out.workList, out.manifestRelSet, &valErr))
+	std::string text = SerializeManifestCanonical(files);
+	std::string sha;
+	if (!Sha256StringHexLower(text, sha) || sha != head)
 	{
-		outErr = "Manifest validation failed: " + (valErr.empty() ? std::string("unknown error") : valErr);
+		outNote = "rebuilt manifest does not match head";
 		return false;
 	}
-	return true;
+	outText.swap(text);
+	outSha256Lower = head;
+	outNote = "rebuilt from " + std::to_string(steps) + " delta(s), " + std::to_string(deltaBytes) + " bytes";
+	return RevalidateManifestCandidate(cfg, cancel, outText, outSha256Lower, outNote);
+}
+// --------------------------------------------------
+// Manifest download + parsing
+// --------------------------------------------------
+static bool DownloadAndParseManifest(const SyncConfig& cfg, ManifestData& out, std::string& outErr, const CancelToken& cancel)
+{
+	if (cancel.IsCanceled()) { outErr = "canceled"; return false; }
+	out = ManifestData{};
+	outErr.clear();
+	Log("Downloading MapPack 5.0 manifest ... ");
+
+	PostProgressMarqueeOn();
+	PostProgressTextW(L"Downloading manifest ...");
+	PerfPhase downloadPhase("Manifest download + verify");
+	std::string& manifestText = out.manifestText;
+	std::string deltaNote, head;
+	if (TryBuildManifestFromDeltas(cfg, cancel, manifestText, out.manifestSha256Lower, deltaNote, head))
+	{
+		out.sourceNote = deltaNote;
+	}
+	else
+	{
+		if (!deltaNote.empty())
+			out.sourceNote = "full download (" + deltaNote + ")";
+		std::string dlErr; long http = 0;
+		if (!DownloadUrl(cfg.manifestUrl, manifestText, cancel, &dlErr, &http, head))
+		{
+			PostProgressMarqueeOff();
+			outErr = "Manifest download failed (HTTP " + std::to_string(http) + "): " + dlErr;
+			return false;
+		}
+		if (!Sha256StringHexLower(manifestText, out.manifestSha256Lower))
+		{
+			PostProgressMarqueeOff();
+			outErr = "Manifest SHA-256 calculation failed.";
+			return false;
+		}
+	}
+
+	downloadPhase.End();
+
+	PerfPhase parsePhase("Manifest parse + validate");
+	const bool parsed = ParseAndValidateManifest(manifestText, out.workList, out.arena, outErr);
+	PostProgressMarqueeOff();
+	return parsed;
 }
 static void DeleteLocalFilesNotInManifest(const SyncConfig& cfg,
-	const std::unordered_set<std::string>& manifestRelSet,
+	const ManifestData& md,
+	LocalTreeSnapshot& tree,
+	SyncCounters& ioCounts,
 	const CancelToken& cancel)
 {
 	if (cancel.IsCanceled()) return;
@@ -4510,32 +7928,26 @@ static void DeleteLocalFilesNotInManifest(const SyncConfig& cfg,
 
 	LogSeparator();
 	Log("MapPack 5.0 Clean-up: Searching files that exist but are NOT in the manifest (Needs deleted) ...\r\n");
-	std::vector<fs::path> localFiles;
-	// Scan entire sync root (resources_override/mappack/)
-	if (fs::exists(cfg.localSyncRoot))
-	{
-		for (auto& entry : fs::recursive_directory_iterator(cfg.localSyncRoot))
-		{
-			if (cancel.IsCanceled()) return;
-			if (!entry.is_regular_file()) continue;
-			localFiles.push_back(entry.path());
-		}
-	}
-	else
+	// Every file under the sync root (resources_override/mappack/) in the snapshot is a candidate.
+	const size_t syncRootIndex = LocalTreeFind(tree, cfg.localSyncRoot);
+	if (syncRootIndex == kLocalTreeNone || !tree.entries[syncRootIndex].isDir)
 	{
 		Log("NOTE: Sync Root folder not found; nothing to delete.\r\n");
 		Log("Expected: " + PathToUtf8(cfg.localSyncRoot) + "\r\n");
 		return;
 	}
-	for (const auto& fullPath : localFiles)
+	const size_t syncRootRelLen = tree.entries[syncRootIndex].rel.size() + 1;
+	for (size_t fileIndex : LocalTreeListUnder(tree, cfg.localSyncRoot, false))
 	{
 		if (CheckAndHandleCancel(cancel, "INFO: Canceling ... stopping deletions.\r\n"))
 			return;
-		fs::path relPathFs = fs::relative(fullPath, cfg.localSyncRoot);
-		std::string rel = NormalizeManifestRel(relPathFs.generic_string());
-		if (manifestRelSet.find(rel) == manifestRelSet.end())
+		std::wstring relW = tree.entries[fileIndex].rel.substr(syncRootRelLen);
+		std::replace(relW.begin(), relW.end(), L'\\', L'/');
+		std::string rel = NormalizeManifestRel(WideToUtf8(relW));
+		if (!ManifestHasRel(md, rel))
 		{
-			if (IsPathExcluded(fullPath))
+			const fs::path fullPath = LocalTreeFullPath(tree, fileIndex);
+			if (IsPathExcluded(cfg.exclusions, fullPath))
 			{
 				++skippedExcluded;
 				Log("  EXCLUSION SKIPPED: " + PathToUtf8(fullPath) + "\r\n");
@@ -4547,6 +7959,8 @@ static void DeleteLocalFilesNotInManifest(const SyncConfig& cfg,
 			{
 				Log("  DELETED: " + rel + "\r\n");
 				++filesDeleted;
+				++ioCounts.deleted;
+				LocalTreeNoteRemoved(tree, fileIndex);
 			}
 			else
 			{
@@ -4566,70 +7980,1368 @@ static void DeleteLocalFilesNotInManifest(const SyncConfig& cfg,
 			Log("  Exclusions Skipped:  " + std::to_string(skippedExcluded) + "\r\n");
 	}
 }
-static void DownloadAndUpdateFiles(const SyncConfig& cfg, const ManifestData& md, SyncCounters& ioCounts, const CancelToken& cancel)
+// --------------------------------------------------
+// Local hash index (MapPackSyncTool.<root>.hashindex, next to the INI)
+// - Remembers, per manifest rel path, the file's size, last-write time, file ID and the
+//   SHA-256 we verified for it. If all metadata still matches, the cached hash is trusted
+//   and the file is not re-read. Any mismatch (or a missing entry) falls back to hashing.
+// - One file per sync root (<root> = first 16 hex of the SHA-256 of the normalized root), so
+//   switching install folders or a headless /sync batch keeps every install's index warm. The
+//   older single MapPackSyncTool.hashindex is still read once, then removed.
+// - Rewritten atomically (temp file + MoveReplace) only after a sync with no failures.
+// - [Preferences] ForceFullVerify=1 ignores the index and re-hashes everything.
+// - Also records the manifest last applied in full and when every entry was last checked; see
+//   the Incremental sync section. Older builds skip those two lines as malformed entries.
+// File format (UTF-8, one record per line, tab separated):
+//   MapPackSyncToolHashIndex 1
+//   root<TAB><normalized sync root>
+//   manifest<TAB><sha256 of the applied manifest>      (optional)
+//   verified<TAB><FILETIME of the last full pass>       (optional)
+//   <sha256><TAB><size><TAB><lastWriteFileTime><TAB><volumeSerial><TAB><fileId><TAB><rel>
+// --------------------------------------------------
+static constexpr const char* kHashIndexHeader = "MapPackSyncToolHashIndex 1";
+struct LocalFileStamp
 {
-	if (cancel.IsCanceled()) return;
-	Log("Parsing MapPack 5.0 manifest: Searching files that are missing or has changed (Needs updated) ...\r\n");
-	bool anyChanged = false;
-	PostProgressInit(md.workList.size());
-	for (size_t i = 0; i < md.workList.size(); ++i)
+	unsigned long long size = 0;
+	unsigned long long lastWrite = 0;   // FILETIME as 100ns ticks
+	unsigned long long fileId = 0;      // nFileIndexHigh:nFileIndexLow
+	DWORD volumeSerial = 0;
+
+	bool operator==(const LocalFileStamp& o) const
 	{
-		if (CheckAndHandleCancel(cancel, "INFO: Canceled during parsing.\r\n"))
-			break;
-		std::string rel = md.workList[i].relPath;
-		if (StartsWith(rel, "mappack/"))
-			rel = rel.substr(strlen("mappack/"));
-		const std::string& remotePath = md.workList[i].remotePath;
-		const std::string& expectedHash = md.workList[i].sha256;
-		ScopeExit progressGuard{ [i]() {
-			PostProgressSet(i + 1);
-		} };
-		PostProgressTextW(MakeProgressFileLabel(L"File", i + 1, md.workList.size(), rel, &remotePath));
-		fs::path localFile = MakeDestPath(cfg.localBase, rel);
-		if (IsPathExcluded(localFile))
-		{
-			++ioCounts.skippedExcluded;
-			Log("  EXCLUSION SKIPPED: resources_override/mappack/" + rel + "\r\n");
-			continue;
-		}
-		if (fs::exists(localFile))
-		{
-			std::string localHash;
-			if (!Sha256FileHexLower(localFile, localHash))
-			{
-				Log("  FAILED HASH (local): " + rel + "\r\n");
-				++ioCounts.failed;
-				continue;
-			}
-			if (EqualIcaseAscii(localHash, expectedHash))
-			{
-				++ioCounts.unchanged;
-				continue;
-			}
-		}
-		std::string fileUrl = MakeFileUrlFromRemoteHost(remotePath);
-		std::string dlErr2; long http2 = 0;
-		bool existed = fs::exists(localFile);
-		if (!DownloadUrlToFileVerifySha256(fileUrl, localFile, expectedHash, cancel, &dlErr2, &http2))
+		return size == o.size && lastWrite == o.lastWrite && fileId == o.fileId && volumeSerial == o.volumeSerial;
+	}
+};
+struct HashIndexEntry
+{
+	LocalFileStamp stamp;
+	std::string sha256;   // lowercase hex
+};
+struct HashIndex
+{
+	std::wstring rootKey;   // NormalizeExclusionPathForCompare(localSyncRoot)
+	std::unordered_map<std::string, HashIndexEntry> entries;   // key: ManifestEntry::relPath
+	std::string manifestSha256;             // manifest these entries were written for ("" = unknown)
+	unsigned long long fullPassTime = 0;    // FILETIME ticks of the last sync that checked every entry
+};
+static fs::path GetLegacyHashIndexPath()
+{
+	return fs::path(GetSettingsIniPath()).parent_path() / kHashIndexFileName;
+}
+static fs::path GetHashIndexPath(const std::wstring& rootKey)
+{
+	std::string sha;
+	if (!Sha256StringHexLower(WideToUtf8(rootKey), sha))
+		return GetLegacyHashIndexPath();
+	return fs::path(GetSettingsIniPath()).parent_path() / (L"MapPackSyncTool." + Utf8ToWide(sha.substr(0, 16)) + L".hashindex");
+}
+static bool QueryLocalFileStamp(const fs::path& file, LocalFileStamp& out)
+{
+	out = LocalFileStamp{};
+	unique_handle h(CreateFileW(file.c_str(), FILE_READ_ATTRIBUTES,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, 0, nullptr));
+	if (!h) return false;
+	BY_HANDLE_FILE_INFORMATION bhfi{};
+	if (!GetFileInformationByHandle(h.get(), &bhfi)) return false;
+	if (bhfi.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) return false;
+	out.size = ((unsigned long long)bhfi.nFileSizeHigh << 32) | bhfi.nFileSizeLow;
+	out.lastWrite = ((unsigned long long)bhfi.ftLastWriteTime.dwHighDateTime << 32) | bhfi.ftLastWriteTime.dwLowDateTime;
+	out.fileId = ((unsigned long long)bhfi.nFileIndexHigh << 32) | bhfi.nFileIndexLow;
+	out.volumeSerial = bhfi.dwVolumeSerialNumber;
+	return true;
+}
+static bool LoadHashIndex(const fs::path& indexPath, const std::wstring& expectedRootKey, HashIndex& out)
+{
+	out = HashIndex{};
+	out.rootKey = expectedRootKey;
+
+	std::ifstream f(indexPath, std::ios::binary);
+	if (!f) return false;
+
+	std::string line;
+	if (!std::getline(f, line)) return false;
+	if (!line.empty() && line.back() == '\r') line.pop_back();
+	if (line != kHashIndexHeader) return false;
+
+	if (!std::getline(f, line)) return false;
+	if (!line.empty() && line.back() == '\r') line.pop_back();
+	if (!StartsWith(line, "root\t") || Utf8ToWide(line.substr(5)) != expectedRootKey) return false;
+
+	while (std::getline(f, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty()) continue;
+		if (StartsWith(line, "manifest\t"))
 		{
-			Log("  FAILED DOWNLOAD: " + rel + " (HTTP " + std::to_string(http2) + ") " + dlErr2 + "\r\n");
-			++ioCounts.failed;
+			if (IsHex64(line.substr(9))) out.manifestSha256 = line.substr(9);
 			continue;
 		}
-		if (!existed)
-		{
-			Log("  DOWNLOADED: resources_override/mappack/" + rel + "\r\n");
-			++ioCounts.downloaded; anyChanged = true;
-		}
-		else
+		if (StartsWith(line, "verified\t"))
 		{
-			Log("  UPDATED: resources_override/mappack/" + rel + "\r\n");
-			++ioCounts.updated; anyChanged = true;
+			char* endp = nullptr;
+			const unsigned long long t = _strtoui64(line.c_str() + 9, &endp, 10);
+			if (endp && !*endp) out.fullPassTime = t;
+			continue;
 		}
-	}
 
+		// 5 numeric/hex fields, then the rel path (which takes the rest of the line).
+		size_t fieldStart[6]{};
+		size_t pos = 0;
+		bool okLine = true;
+		for (int k = 0; k < 5; ++k)
+		{
+			const size_t tab = line.find('\t', pos);
+			if (tab == std::string::npos) { okLine = false; break; }
+			fieldStart[k] = pos;
+			pos = tab + 1;
+		}
+		fieldStart[5] = pos;
+		if (!okLine || pos >= line.size()) continue;
+
+		auto field = [&](int k) { return line.substr(fieldStart[k], fieldStart[k + 1] - fieldStart[k] - 1); };
+		HashIndexEntry e;
+		e.sha256 = field(0);
+		if (!IsHex64(e.sha256)) continue;
+		char* endp = nullptr;
+		const std::string sSize = field(1), sWrite = field(2), sVol = field(3), sId = field(4);
+		e.stamp.size = _strtoui64(sSize.c_str(), &endp, 10); if (!endp || *endp) continue;
+		e.stamp.lastWrite = _strtoui64(sWrite.c_str(), &endp, 10); if (!endp || *endp) continue;
+		e.stamp.volumeSerial = (DWORD)_strtoui64(sVol.c_str(), &endp, 10); if (!endp || *endp) continue;
+		e.stamp.fileId = _strtoui64(sId.c_str(), &endp, 10); if (!endp || *endp) continue;
+		out.entries[line.substr(fieldStart[5])] = std::move(e);
+	}
+	return true;
+}
+static bool WriteHashIndexAtomic(const fs::path& indexPath, const HashIndex& index, std::wstring* outErr)
+{
+	if (outErr) outErr->clear();
+
+	// Sorted output keeps the file stable between runs (easier to diff when troubleshooting).
+	std::vector<const std::pair<const std::string, HashIndexEntry>*> sorted;
+	sorted.reserve(index.entries.size());
+	for (const auto& kv : index.entries)
+		sorted.push_back(&kv);
+	std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+	std::string text;
+	text.reserve(64 + sorted.size() * 160);
+	text += kHashIndexHeader;
+	text += "\r\nroot\t" + WideToUtf8(index.rootKey) + "\r\n";
+	if (!index.manifestSha256.empty())
+		text += "manifest\t" + index.manifestSha256 + "\r\n";
+	if (index.fullPassTime != 0)
+		text += "verified\t" + std::to_string(index.fullPassTime) + "\r\n";
+	for (const auto* kv : sorted)
+	{
+		const HashIndexEntry& e = kv->second;
+		text += e.sha256;
+		text += '\t'; text += std::to_string(e.stamp.size);
+		text += '\t'; text += std::to_string(e.stamp.lastWrite);
+		text += '\t'; text += std::to_string(e.stamp.volumeSerial);
+		text += '\t'; text += std::to_string(e.stamp.fileId);
+		text += '\t'; text += kv->first;
+		text += "\r\n";
+	}
+
+	fs::path tmp = indexPath;
+	tmp += L".tmp";
+	{
+		unique_handle h(CreateFileW(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		if (!h)
+		{
+			if (outErr) *outErr = L"Failed to create '" + tmp.wstring() + L"': " + Win32ErrorMessage(GetLastError());
+			return false;
+		}
+		DWORD wrote = 0;
+		if (!WriteFile(h.get(), text.data(), (DWORD)text.size(), &wrote, nullptr) || wrote != (DWORD)text.size()
+			|| !FlushFileBuffers(h.get()))
+		{
+			const DWORD err = GetLastError();
+			h.reset();
+			std::error_code ec;
+			fs::remove(tmp, ec);
+			if (outErr) *outErr = L"Failed to write '" + tmp.wstring() + L"': " + Win32ErrorMessage(err);
+			return false;
+		}
+	}
+	if (!MoveReplace(tmp, indexPath))
+	{
+		const DWORD err = GetLastError();
+		std::error_code ec;
+		fs::remove(tmp, ec);
+		if (outErr) *outErr = L"Failed to replace '" + indexPath.wstring() + L"': " + Win32ErrorMessage(err);
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------
+// Content-addressed dedup (DownloadAndUpdateFiles)
+// - Work-list entries that share a sha256 fetch that blob once; the other paths are filled from
+//   the first good copy on disk (CopyFileW, or a hard link with [Preferences] DedupHardLinks=1).
+// - Files already under the sync root are sources too: paths verified unchanged during this run,
+//   and paths the hash index still vouches for (stamp unchanged), including orphans about to be
+//   deleted, e.g. a texture that was renamed in the map pack.
+// - A filled path is re-hashed before it replaces the destination, exactly like a download.
+// --------------------------------------------------
+enum class BlobState
+{
+	Pending,   // one worker is fetching it; others wait
+	Ready,     // `file` holds verified content
+	Failed,    // the fetch failed; the next claimant retries
+	Deferred,  // left for the pack fetch after the pool (see Pack bundles)
+};
+struct BlobSlot
+{
+	BlobState state = BlobState::Pending;
+	fs::path file;
+};
+struct BlobRegistry
+{
+	std::mutex lock;
+	std::condition_variable changed;
+	std::unordered_map<std::string, BlobSlot> bySha;   // key: lowercase sha256; guarded by lock
+	std::unordered_map<std::string, std::vector<fs::path>> indexSources;   // read-only while workers run
+};
+enum class BlobClaim
+{
+	Fetch,      // caller owns the blob and must publish the outcome
+	Copy,       // outSource holds verified content
+	Deferred,   // the blob comes from a pack after the pool; defer this path too
+	Canceled,
+};
+// Local files the hash index vouches for, grouped by content. Paths the sync is about to overwrite
+// with different content are left out, so a source never changes while another path copies it.
+static void BlobRegistryAddIndexSources(BlobRegistry& reg, const SyncConfig& cfg, const ManifestData& md,
+	const HashIndex& cachedIndex, const LocalTreeSnapshot& tree)
+{
+	std::unordered_map<std::string, std::string> wantedByRel;
+	std::unordered_set<std::string> wantedShas;
+	for (const auto& e : md.workList)
+	{
+		std::string sha = e.Sha256Hex();
+		wantedShas.insert(sha);
+		wantedByRel.emplace(std::string(e.relPath), std::move(sha));
+	}
+	for (const auto& kv : cachedIndex.entries)
+	{
+		const HashIndexEntry& ie = kv.second;
+		if (wantedShas.find(ie.sha256) == wantedShas.end())
+			continue;
+		auto w = wantedByRel.find(kv.first);
+		if (w != wantedByRel.end() && w->second != ie.sha256)
+			continue;
+		std::string rel = kv.first;
+		if (StartsWith(rel, "mappack/"))
+			rel = rel.substr(strlen("mappack/"));
+		const fs::path file = MakeDestPath(cfg.localBase, rel);
+		if (IsPathExcluded(cfg.exclusions, file))
+			continue;
+		const size_t found = LocalTreeFind(tree, file);
+		if (found == kLocalTreeNone || !LocalTreeIsFile(tree.entries[found]))
+			continue;
+		const LocalTreeEntry& scanned = tree.entries[found];
+		if (scanned.size != ie.stamp.size || scanned.lastWrite != ie.stamp.lastWrite)
+			continue;
+		reg.indexSources[ie.sha256].push_back(file);
+	}
+}
+// Waits while another worker fetches the same blob, polling the cancel token.
+static BlobClaim BlobRegistryClaim(BlobRegistry& reg, const std::string& shaLower, const CancelToken& cancel, fs::path& outSource)
+{
+	std::unique_lock<std::mutex> guard(reg.lock);
+	for (;;)
+	{
+		auto it = reg.bySha.find(shaLower);
+		if (it == reg.bySha.end() || it->second.state == BlobState::Failed)
+		{
+			reg.bySha[shaLower].state = BlobState::Pending;
+			return BlobClaim::Fetch;
+		}
+		if (it->second.state == BlobState::Ready)
+		{
+			outSource = it->second.file;
+			return BlobClaim::Copy;
+		}
+		if (it->second.state == BlobState::Deferred)
+			return BlobClaim::Deferred;
+		if (cancel.IsCanceled())
+			return BlobClaim::Canceled;
+		reg.changed.wait_for(guard, std::chrono::milliseconds(100));
+	}
+}
+static void BlobRegistryPublish(BlobRegistry& reg, const std::string& shaLower, bool ok, const fs::path& file)
+{
+	{
+		std::lock_guard<std::mutex> guard(reg.lock);
+		BlobSlot& slot = reg.bySha[shaLower];
+		if (ok)
+		{
+			slot.state = BlobState::Ready;
+			slot.file = file;
+		}
+		else if (slot.state != BlobState::Ready)   // an unchanged path may have offered it meanwhile
+			slot.state = BlobState::Failed;
+	}
+	reg.changed.notify_all();
+}
+// The owner hands the blob to the pack fetch; nobody waits on a deferred slot.
+static void BlobRegistryDefer(BlobRegistry& reg, const std::string& shaLower)
+{
+	{
+		std::lock_guard<std::mutex> guard(reg.lock);
+		BlobSlot& slot = reg.bySha[shaLower];
+		if (slot.state == BlobState::Pending)
+			slot.state = BlobState::Deferred;
+	}
+	reg.changed.notify_all();
+}
+// Ready source for a deferred blob, if an unchanged path offered one after it was deferred.
+static bool BlobRegistryReadySource(BlobRegistry& reg, const std::string& shaLower, fs::path& outSource)
+{
+	std::lock_guard<std::mutex> guard(reg.lock);
+	auto it = reg.bySha.find(shaLower);
+	if (it == reg.bySha.end() || it->second.state != BlobState::Ready)
+		return false;
+	outSource = it->second.file;
+	return true;
+}
+// A path verified unchanged is a source for every other path with the same content.
+static void BlobRegistryOffer(BlobRegistry& reg, const std::string& shaLower, const fs::path& file)
+{
+	{
+		std::lock_guard<std::mutex> guard(reg.lock);
+		BlobSlot& slot = reg.bySha[shaLower];
+		if (slot.state == BlobState::Ready)
+			return;
+		slot.state = BlobState::Ready;
+		slot.file = file;
+	}
+	reg.changed.notify_all();
+}
+// Fills dest from a local file with the same content. The result is re-hashed before it replaces
+// dest, so a source that changed since it was vouched for is never propagated.
+static bool FillFromLocalBlob(const fs::path& source, const fs::path& dest, const std::string& expectedSha256,
+	bool hardLink, bool& outLinked, std::string* outErr)
+{
+	outLinked = false;
+	std::error_code ec;
+	fs::create_directories(dest.parent_path(), ec);
+	fs::path tmp = dest;
+	tmp += L".dedup";
+	fs::remove(tmp, ec);
+
+	// Hard links need the same volume (always true under one root) and NTFS; FAT32 falls back to a copy.
+	if (hardLink && CreateHardLinkW(tmp.c_str(), source.c_str(), nullptr))
+		outLinked = true;
+	else if (!CopyFileW(source.c_str(), tmp.c_str(), FALSE))
+	{
+		if (outErr) *outErr = "Local copy failed (" + std::to_string(GetLastError()) + ")";
+		return false;
+	}
+	std::string got;
+	if (!Sha256FileHexLower(tmp, got) || !EqualIcaseAscii(got, expectedSha256))
+	{
+		fs::remove(tmp, ec);
+		if (outErr) *outErr = "Local copy failed SHA-256 verification";
+		return false;
+	}
+	if (!MoveReplace(tmp, dest))
+	{
+		if (outErr) *outErr = "Replace failed (" + std::to_string(GetLastError()) + ")";
+		fs::remove(tmp, ec);
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------
+// Pack bundles (ManifestSha256 --pack)
+// - mappack_packs/index.json lists pack files (<sha256>.pack) and, per blob sha256, its offset and
+//   size inside one of them. The manifest is unchanged; the index is an optional extra, fetched
+//   (plain .json, no gzip twin is published) only once a sync actually has to download something.
+// - Work-list blobs found in the index are not fetched by the pool. They are collected and
+//   fetched afterwards with multi-range requests, a few MB of neighbouring blobs per request.
+// - Each blob split out of a pack passes SHA-256 verification before it replaces a file, exactly
+//   like a download. Servers that ignore multi-range requests (S3 answers 200 with the whole
+//   object) get one single-range request per span instead; anything a range request could not
+//   deliver falls back to the per-file GET.
+// --------------------------------------------------
+struct PackBlobLoc
+{
+	size_t pack = 0;                 // index into PackIndex::packNames
+	unsigned long long offset = 0;
+	unsigned long long size = 0;
+};
+struct PackIndex
+{
+	std::vector<std::string> packNames;                  // "<sha256>.pack"
+	std::unordered_map<std::string, PackBlobLoc> bySha;  // key: lowercase sha256
+};
+static bool ParsePackFileArray(const std::string& s, size_t& i, size_t pack, long long packSize, PackIndex& out, std::string* outErr)
+{
+	if (i >= s.size() || s[i] != '[') { if (outErr) *outErr = "expected '[' for files"; return false; }
+	++i;
+	SkipWs(s, i);
+	if (i < s.size() && s[i] == ']') { ++i; return true; }
+	for (;;)
+	{
+		SkipWs(s, i);
+		if (i >= s.size() || s[i] != '{') { if (outErr) *outErr = "expected object in files array"; return false; }
+		++i;
+		std::string sha;
+		long long offset = -1, size = -1;
+		for (;;)
+		{
+			SkipWs(s, i);
+			if (i < s.size() && s[i] == '}') { ++i; break; }
+			std::string key;
+			if (!ReadJsonString(s, i, key, outErr)) return false;
+			SkipWs(s, i);
+			if (i >= s.size() || s[i] != ':') { if (outErr) *outErr = "expected ':' in file object"; return false; }
+			++i;
+			SkipWs(s, i);
+
+			bool ok = true;
+			if (key == "sha256") ok = ReadJsonString(s, i, sha, outErr);
+			else if (key == "offset") ok = ReadJsonUInt64(s, i, offset, outErr);
+			else if (key == "size") ok = ReadJsonUInt64(s, i, size, outErr);
+			else ok = SkipJsonValue(s, i, 0, outErr);
+			if (!ok) return false;
+
+			SkipWs(s, i);
+			if (i >= s.size()) { if (outErr) *outErr = "unterminated file object"; return false; }
+			if (s[i] == ',') { ++i; continue; }
+			if (s[i] == '}') { ++i; break; }
+			if (outErr) *outErr = "expected ',' or '}' in file object";
+			return false;
+		}
+		if (!IsHex64(sha) || offset < 0 || size < 0 || (packSize >= 0 && offset + size > packSize))
+		{
+			if (outErr) *outErr = "invalid pack file entry";
+			return false;
+		}
+		out.bySha.emplace(ToLowerAsciiCopy(sha), PackBlobLoc{ pack, (unsigned long long)offset, (unsigned long long)size });
+
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated files array"; return false; }
+		if (s[i] == ',') { ++i; continue; }
+		if (s[i] == ']') { ++i; return true; }
+		if (outErr) *outErr = "expected ',' or ']' in files array";
+		return false;
+	}
+}
+// A pack name ends up in a URL; only "<64 hex>.pack" is accepted.
+static bool IsValidPackName(const std::string& name)
+{
+	return name.size() == 69 && IsHex64(name.substr(0, 64)) && name.compare(64, 5, ".pack") == 0;
+}
+static bool ParsePackArray(const std::string& s, size_t& i, PackIndex& out, std::string* outErr)
+{
+	if (i >= s.size() || s[i] != '[') { if (outErr) *outErr = "expected '[' for packs"; return false; }
+	++i;
+	SkipWs(s, i);
+	if (i < s.size() && s[i] == ']') { ++i; return true; }
+	for (;;)
+	{
+		SkipWs(s, i);
+		if (i >= s.size() || s[i] != '{') { if (outErr) *outErr = "expected object in packs array"; return false; }
+		++i;
+		// "files" is parsed in place, so "name" and "size" must come first (ManifestSha256 order).
+		std::string name;
+		long long packSize = -1;
+		const size_t pack = out.packNames.size();
+		out.packNames.emplace_back();
+		for (;;)
+		{
+			SkipWs(s, i);
+			if (i < s.size() && s[i] == '}') { ++i; break; }
+			std::string pkey;
+			if (!ReadJsonString(s, i, pkey, outErr)) return false;
+			SkipWs(s, i);
+			if (i >= s.size() || s[i] != ':') { if (outErr) *outErr = "expected ':' in pack object"; return false; }
+			++i;
+			SkipWs(s, i);
+
+			if (pkey == "files" && !IsValidPackName(name)) { if (outErr) *outErr = "invalid pack name"; return false; }
+			bool ok = true;
+			if (pkey == "name") ok = ReadJsonString(s, i, name, outErr);
+			else if (pkey == "size") ok = ReadJsonUInt64(s, i, packSize, outErr);
+			else if (pkey == "files") ok = ParsePackFileArray(s, i, pack, packSize, out, outErr);
+			else ok = SkipJsonValue(s, i, 0, outErr);
+			if (!ok) return false;
+
+			SkipWs(s, i);
+			if (i >= s.size()) { if (outErr) *outErr = "unterminated pack object"; return false; }
+			if (s[i] == ',') { ++i; continue; }
+			if (s[i] == '}') { ++i; break; }
+			if (outErr) *outErr = "expected ',' or '}' in pack object";
+			return false;
+		}
+		out.packNames[pack] = name;
+
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated packs array"; return false; }
+		if (s[i] == ',') { ++i; continue; }
+		if (s[i] == ']') { ++i; return true; }
+		if (outErr) *outErr = "expected ',' or ']' in packs array";
+		return false;
+	}
+}
+static bool ParsePackIndex(const std::string& s, PackIndex& out, std::string* outErr)
+{
+	out = PackIndex{};
+	if (outErr) outErr->clear();
+	size_t i = 0;
+	SkipWs(s, i);
+	if (i >= s.size() || s[i] != '{') { if (outErr) *outErr = "expected top-level object"; return false; }
+	++i;
+	for (;;)
+	{
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated top-level object"; return false; }
+		if (s[i] == '}') { ++i; break; }
+		std::string key;
+		if (!ReadJsonString(s, i, key, outErr)) return false;
+		SkipWs(s, i);
+		if (i >= s.size() || s[i] != ':') { if (outErr) *outErr = "expected ':' after key"; return false; }
+		++i;
+		SkipWs(s, i);
+
+		const bool ok = (key == "packs") ? ParsePackArray(s, i, out, outErr) : SkipJsonValue(s, i, 0, outErr);
+		if (!ok) return false;
+
+		SkipWs(s, i);
+		if (i >= s.size()) { if (outErr) *outErr = "unterminated top-level object"; return false; }
+		if (s[i] == ',') { ++i; continue; }
+		if (s[i] == '}') { ++i; break; }
+		if (outErr) *outErr = "expected ',' or '}' in top-level object";
+		return false;
+	}
+	return true;
+}
+// Best effort: a missing or broken index only means every file is fetched with its own GET.
+static bool LoadPackIndex(const SyncConfig& cfg, PackIndex& out, const CancelToken& cancel)
+{
+	out = PackIndex{};
+	std::string text, err;
+	long http = 0;
+	if (!DownloadUrl(JoinUrl(cfg.remoteHost, kPackIndexPath), text, cancel, &err, &http))
+	{
+		// S3 answers 403 (not 404) for missing keys; no index published is the common case.
+		if (http != 403 && http != 404 && !cancel.IsCanceled())
+			Log("  (pack index unavailable, using per-file downloads: " + err + ")\r\n");
+		return false;
+	}
+	if (!ParsePackIndex(text, out, &err))
+	{
+		Log("  (pack index ignored, using per-file downloads: " + err + ")\r\n");
+		out = PackIndex{};
+		return false;
+	}
+	return !out.bySha.empty();
+}
+// The blob is worth deferring only when the index agrees with the manifest about its size.
+static const PackBlobLoc* PackIndexFind(const PackIndex* packs, const std::string& shaLower, long long expectedSize)
+{
+	if (!packs) return nullptr;
+	auto it = packs->bySha.find(shaLower);
+	if (it == packs->bySha.end()) return nullptr;
+	if (expectedSize >= 0 && it->second.size != (unsigned long long)expectedSize) return nullptr;
+	return &it->second;
+}
+// Loaded by the first worker that has to go to the network, so a sync with nothing to download
+// (and every sync against a host without packs) pays no request for it.
+struct LazyPackIndex
+{
+	const SyncConfig* cfg = nullptr;
+	CancelToken cancel;
+	std::once_flag once;
+	PackIndex index;
+	bool loaded = false;     // valid after `once`; false = no usable index
+};
+static const PackIndex* LazyPackIndexGet(LazyPackIndex& lazy)
+{
+	std::call_once(lazy.once, [&lazy]() { lazy.loaded = LoadPackIndex(*lazy.cfg, lazy.index, lazy.cancel); });
+	return lazy.loaded ? &lazy.index : nullptr;
+}
+
+// --------------------------------------------------
+// Parallel download pool (DownloadAndUpdateFiles)
+// - Workers claim entries in schedule order (BuildSyncSchedule: largest first) and run
+//   hash-check, download (or local dedup fill), verify and replace.
+// - Result lines are logged in schedule order, so the output reads the same as a sequential
+//   run no matter how many workers are active or which one finishes first.
+// - Cancel stops workers from claiming new entries; in-flight downloads bail out on their
+//   next read (WinHttpDownloadToFileAndHash_NoRedirects checks the token every chunk).
+// --------------------------------------------------
+struct DownloadPoolState
+{
+	const SyncConfig* cfg = nullptr;
+	const std::vector<ManifestEntry>* workList = nullptr;   // entries to check (all, or the incremental subset)
+	SyncCounters* counts = nullptr;
+	const HashIndex* cachedIndex = nullptr;  // read-only while workers run
+	const LocalTreeSnapshot* tree = nullptr; // read-only while workers run
+	CancelToken cancel;
+	HANDLE downloadSlots = nullptr;          // semaphore: at most cfg->downloadWorkers concurrent downloads
+	std::vector<size_t> order;               // schedule: position -> workList index
+	std::atomic<size_t> nextIndex{ 0 };      // next schedule position to claim
+	BlobRegistry blobs;                      // one fetch per unique sha256 (own lock)
+	LazyPackIndex packs;                     // read-only once loaded; deferred entries imply it loaded
+
+	std::mutex lock;                         // guards everything below
+	HashIndex* freshIndex = nullptr;         // stamps + hashes verified during this run
+	std::vector<std::string> resultLines;    // per schedule position log text (empty = nothing to log)
+	std::vector<unsigned char> resultDone;
+	size_t emitCursor = 0;                   // first entry whose result has not been logged yet
+	std::vector<std::pair<fs::path, unsigned long long>> createdFiles;   // applied to the snapshot after the pool
+	std::vector<size_t> deferred;            // schedule positions left for the pack fetch
+	LogCapture* logCapture = nullptr;        // creator's t_logCapture, taken over by every pool thread
+	ProgressReporter* progress = nullptr;    // creator's t_progress, likewise
+	PerfStats* perf = nullptr;               // creator's t_perf, likewise
+};
+struct EntrySyncResult
+{
+	std::string logLine;        // empty = nothing to log
+	bool haveIndexEntry = false;
+	HashIndexEntry indexEntry;  // valid when haveIndexEntry
+	fs::path createdFile;       // set when the download created a file the snapshot did not have
+	bool deferred = false;      // fetched from a pack after the pool; nothing else is set
+};
+// Waits for a download slot, polling the cancel token. A broken semaphore never blocks the sync.
+static bool AcquireDownloadSlot(HANDLE slots, const CancelToken& cancel)
+{
+	if (!slots) return true;
+	for (;;)
+	{
+		const DWORD w = WaitForSingleObject(slots, 100);
+		if (w != WAIT_TIMEOUT) return true;
+		if (cancel.IsCanceled()) return false;
+	}
+}
+// Counts a path whose new content just passed SHA-256 verification and builds its log line.
+static void NoteFetchedEntry(EntrySyncResult& res, const ManifestEntry& entry, const fs::path& localFile, const std::string& rel,
+	bool existed, const std::string& how, SyncCounters& ioCounts)
+{
+	// Remember the verified bytes so the next sync can skip the re-hash.
+	if (QueryLocalFileStamp(localFile, res.indexEntry.stamp))
+	{
+		res.haveIndexEntry = true;
+		res.indexEntry.sha256 = entry.Sha256Hex();
+	}
+	if (!existed)
+	{
+		res.createdFile = localFile;
+		++ioCounts.downloaded;
+		res.logLine = "  DOWNLOADED" + how + ": resources_override/mappack/" + rel + "\r\n";
+		return;
+	}
+	++ioCounts.updated;
+	res.logLine = "  UPDATED" + how + ": resources_override/mappack/" + rel + "\r\n";
+}
+static EntrySyncResult SyncOneManifestEntry(const SyncConfig& cfg, const ManifestEntry& entry, const std::string& rel,
+	const HashIndex* cachedIndex, const LocalTreeSnapshot& tree, BlobRegistry& blobs, LazyPackIndex& packs, HANDLE downloadSlots,
+	SyncCounters& ioCounts, const CancelToken& cancel)
+{
+	EntrySyncResult res;
+	fs::path localFile = MakeDestPath(cfg.localBase, rel);
+	if (IsPathExcluded(cfg.exclusions, localFile))
+	{
+		++ioCounts.skippedExcluded;
+		res.logLine = "  EXCLUSION SKIPPED: resources_override/mappack/" + rel + "\r\n";
+		return res;
+	}
+	const std::string shaLower = entry.Sha256Hex();
+	const size_t found = LocalTreeFind(tree, localFile);
+	const bool existed = (found != kLocalTreeNone);
+	if (existed)
+	{
+		// Different size can never hash equal; skip straight to the download. The snapshot
+		// already has the size, so a file that is stale by size is never even opened.
+		const LocalTreeEntry& scanned = tree.entries[found];
+		bool staleBySize = entry.size >= 0 && LocalTreeIsFile(scanned) && scanned.size != (unsigned long long)entry.size;
+		LocalFileStamp stamp;
+		const bool haveStamp = !staleBySize && QueryLocalFileStamp(localFile, stamp);
+		if (haveStamp && entry.size >= 0 && stamp.size != (unsigned long long)entry.size)
+			staleBySize = true;
+
+		std::string localHash;
+		bool fromIndex = false;
+		if (staleBySize)
+		{
+			++ioCounts.sizeMismatches;
+		}
+		else if (haveStamp && cachedIndex)
+		{
+			auto it = cachedIndex->entries.find(std::string(entry.relPath));
+			if (it != cachedIndex->entries.end() && it->second.stamp == stamp)
+			{
+				localHash = it->second.sha256;
+				fromIndex = true;
+			}
+		}
+		if (!staleBySize && !fromIndex && !Sha256FileHexLower(localFile, localHash))
+		{
+			++ioCounts.failed;
+			res.logLine = "  FAILED HASH (local): " + rel + "\r\n";
+			return res;
+		}
+		if (!staleBySize && !fromIndex)
+			PerfNoteHashedBytes(haveStamp ? stamp.size : scanned.size);
+		if (!staleBySize && localHash == shaLower)
+		{
+			++ioCounts.unchanged;
+			if (fromIndex) ++ioCounts.hashIndexHits;
+			BlobRegistryOffer(blobs, shaLower, localFile);
+			if (haveStamp)
+			{
+				res.haveIndexEntry = true;
+				res.indexEntry.stamp = stamp;
+				res.indexEntry.sha256 = localHash;
+			}
+			return res;
+		}
+	}
+	// Canceled while hashing (or waiting for a slot/another worker): leave the entry uncounted,
+	// like the sequential loop did.
+	if (cancel.IsCanceled())
+		return res;
+	fs::path source;
+	const BlobClaim claim = BlobRegistryClaim(blobs, shaLower, cancel, source);
+	if (claim == BlobClaim::Canceled)
+		return res;
+	if (claim == BlobClaim::Deferred)
+	{
+		res.deferred = true;
+		return res;
+	}
+	const bool owner = (claim == BlobClaim::Fetch);
+
+	// Identical content already on disk beats any download.
+	bool filled = false, linked = false;
+	if (!owner)
+		filled = FillFromLocalBlob(source, localFile, shaLower, cfg.dedupHardLinks, linked, nullptr);
+	else
+	{
+		auto it = blobs.indexSources.find(shaLower);
+		if (it != blobs.indexSources.end())
+		{
+			for (const fs::path& candidate : it->second)
+			{
+				if (candidate == localFile) continue;
+				if (FillFromLocalBlob(candidate, localFile, shaLower, cfg.dedupHardLinks, linked, nullptr))
+				{
+					filled = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// So does a background prefetch of it (verified again before it is moved into place).
+	const bool staged = !filled && owner
+		&& TakeStagedDownload(cfg.localBase / kPartialDownloadDirName, shaLower, entry.size, localFile);
+
+	// Small blobs wait for the batched range requests after the pool.
+	if (!filled && !staged && owner && PackIndexFind(LazyPackIndexGet(packs), shaLower, entry.size))
+	{
+		BlobRegistryDefer(blobs, shaLower);
+		res.deferred = true;
+		return res;
+	}
+
+	if (staged)
+	{
+		BlobRegistryPublish(blobs, shaLower, true, localFile);
+	}
+	else if (!filled)
+	{
+		if (!AcquireDownloadSlot(downloadSlots, cancel))
+		{
+			if (owner) BlobRegistryPublish(blobs, shaLower, false, fs::path());
+			return res;
+		}
+		std::string dlErr; long http = 0;
+		const bool downloaded = DownloadFileFromMirrors(std::string(entry.remotePath), localFile, shaLower,
+			cfg.localBase / kPartialDownloadDirName, entry.size, cancel, &dlErr, &http);
+		if (downloadSlots) ReleaseSemaphore(downloadSlots, 1, nullptr);
+		if (owner) BlobRegistryPublish(blobs, shaLower, downloaded, localFile);
+		if (!downloaded)
+		{
+			++ioCounts.failed;
+			res.logLine = "  FAILED DOWNLOAD: " + rel + " (HTTP " + std::to_string(http) + ") " + dlErr + "\r\n";
+			return res;
+		}
+	}
+	else
+	{
+		if (owner) BlobRegistryPublish(blobs, shaLower, true, localFile);
+		++ioCounts.localCopies;
+	}
+	const std::string how = staged ? std::string(" (prefetched in the background)")
+		: !filled ? std::string() : (linked ? " (hard-linked identical local file)" : " (copied identical local file)");
+	NoteFetchedEntry(res, entry, localFile, rel, existed, how, ioCounts);
+	return res;
+}
+static void DownloadPoolCompleteEntry(DownloadPoolState& pool, size_t position, const ManifestEntry& entry, EntrySyncResult&& result)
+{
+	std::lock_guard<std::mutex> guard(pool.lock);
+	if (result.haveIndexEntry && pool.freshIndex)
+		pool.freshIndex->entries[std::string(entry.relPath)] = std::move(result.indexEntry);
+	pool.resultLines[position] = std::move(result.logLine);
+	pool.resultDone[position] = 1;
+	if (!result.createdFile.empty())
+		pool.createdFiles.emplace_back(std::move(result.createdFile), (unsigned long long)(std::max)(entry.size, 0LL));
+
+	// Byte-weighted when the manifest has sizes: one large texture moves the bar as much as the
+	// many small .def files it outweighs. The UI samples this; nothing is posted per entry.
+	ProgressReporterEntryDone(&entry.relPath, (unsigned long long)(std::max)(entry.size, 0LL));
+
+	const size_t total = pool.workList->size();
+
+	while (pool.emitCursor < total && pool.resultDone[pool.emitCursor])
+	{
+		std::string& pending = pool.resultLines[pool.emitCursor];
+		if (!pending.empty())
+		{
+			Log(pending);
+			std::string().swap(pending);
+		}
+		++pool.emitCursor;
+	}
+}
+static void DownloadPoolRun(DownloadPoolState& pool)
+{
+	const size_t total = pool.workList->size();
+	for (;;)
+	{
+		if (pool.cancel.IsCanceled())
+			break;
+		const size_t position = pool.nextIndex.fetch_add(1);
+		if (position >= total)
+			break;
+		const ManifestEntry& entry = (*pool.workList)[pool.order[position]];
+		std::string rel(entry.relPath);
+		if (StartsWith(rel, "mappack/"))
+			rel = rel.substr(strlen("mappack/"));
+		EntrySyncResult result = SyncOneManifestEntry(*pool.cfg, entry, rel, pool.cachedIndex, *pool.tree, pool.blobs,
+			pool.packs, pool.downloadSlots, *pool.counts, pool.cancel);
+		if (result.deferred)
+		{
+			// Its log line (and every later one) waits until the pack fetch completes it.
+			std::lock_guard<std::mutex> guard(pool.lock);
+			pool.deferred.push_back(position);
+			continue;
+		}
+		DownloadPoolCompleteEntry(pool, position, entry, std::move(result));
+	}
+}
+// Longest-processing-time-first: big files start while every worker is still busy and the
+// many small ones fill in behind them, so no worker is left finishing one huge file alone.
+// Entries without a size keep their manifest order after the sized ones.
+static std::vector<size_t> BuildSyncSchedule(const std::vector<ManifestEntry>& workList)
+{
+	std::vector<size_t> order(workList.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&workList](size_t a, size_t b)
+		{
+			return workList[a].size > workList[b].size;
+		});
+	return order;
+}
+static unsigned __stdcall DownloadPoolThreadProc(void* param)
+{
+	DownloadPoolState& pool = *static_cast<DownloadPoolState*>(param);
+	t_logCapture = pool.logCapture;
+	t_progress = pool.progress;
+	t_perf = pool.perf;
+	DownloadPoolRun(pool);
+	return 0;
+}
+// --------------------------------------------------
+// Pack fetch (after the pool; see Pack bundles)
+// - Deferred blobs are sorted by pack and offset and coalesced into spans. One job is one request
+//   of at most kPackMaxRangesPerRequest spans and kPackMaxRequestBytes, run DownloadWorkers wide.
+// - Every deferred position is completed exactly once, through DownloadPoolCompleteEntry.
+// --------------------------------------------------
+struct PackSpan
+{
+	unsigned long long first = 0;
+	unsigned long long last = 0;     // inclusive, as in the Range header
+};
+struct PackPart
+{
+	unsigned long long first = 0;    // pack offset of bytes[0]
+	std::string bytes;
+};
+struct PackFetchBlob
+{
+	std::string shaLower;
+	PackBlobLoc loc;
+	std::vector<size_t> positions;   // schedule positions with this content
+};
+struct PackFetchJob
+{
+	size_t pack = 0;
+	std::vector<PackSpan> spans;
+	std::vector<size_t> blobs;       // indexes into PackFetchState::blobs
+};
+struct PackFetchState
+{
+	DownloadPoolState* pool = nullptr;
+	std::vector<PackFetchBlob> blobs;
+	std::vector<PackFetchJob> jobs;
+	std::atomic<size_t> nextJob{ 0 };
+	std::atomic<bool> noMultiRange{ false };   // a multi-range request was answered with the whole pack
+	std::atomic<bool> noRanges{ false };       // so was a single-range one: per-file GETs only
+};
+// "bytes <first>-<last>/<total or *>"
+static bool ParseContentRangeBytes(const std::string& v, unsigned long long& first, unsigned long long& last)
+{
+	if (v.size() <= 6 || !EqualIcaseAscii(v.substr(0, 6), "bytes ")) return false;
+	const char* p = v.c_str() + 6;
+	while (*p == ' ') ++p;
+	char* end = nullptr;
+	first = strtoull(p, &end, 10);
+	if (end == p || *end != '-') return false;
+	p = end + 1;
+	last = strtoull(p, &end, 10);
+	return end != p && last >= first && (*end == '/' || *end == '\0');
+}
+// multipart/byteranges (RFC 7233 appendix A); every part carries its own Content-Range. Parts
+// before a truncation are kept, so the caller only re-requests what is actually missing.
+static bool SplitMultipartByteRanges(const std::string& contentType, const std::string& body, std::vector<PackPart>& outParts)
+{
+	const size_t at = ToLowerAsciiCopy(contentType).find("boundary=");
+	if (at == std::string::npos) return false;
+	std::string boundary = contentType.substr(at + 9);
+	const size_t semi = boundary.find(';');
+	if (semi != std::string::npos) boundary.resize(semi);
+	while (!boundary.empty() && boundary.back() == ' ') boundary.pop_back();
+	if (boundary.size() >= 2 && boundary.front() == '"' && boundary.back() == '"')
+		boundary = boundary.substr(1, boundary.size() - 2);
+	if (boundary.empty()) return false;
+
+	const std::string delim = "--" + boundary;
+	size_t pos = 0;
+	for (;;)
+	{
+		pos = body.find(delim, pos);
+		if (pos == std::string::npos) return false;   // no closing delimiter: truncated
+		pos += delim.size();
+		if (body.compare(pos, 2, "--") == 0) return true;
+		const size_t headersEnd = body.find("\r\n\r\n", pos);
+		if (headersEnd == std::string::npos) return false;
+
+		unsigned long long first = 0, last = 0;
+		bool haveRange = false;
+		for (size_t line = pos; line < headersEnd;)
+		{
+			size_t eol = body.find("\r\n", line);
+			if (eol == std::string::npos || eol > headersEnd) eol = headersEnd;
+			const std::string header = body.substr(line, eol - line);
+			const size_t colon = header.find(':');
+			if (colon != std::string::npos && EqualIcaseAscii(header.substr(0, colon), "Content-Range"))
+			{
+				size_t v = colon + 1;
+				while (v < header.size() && header[v] == ' ') ++v;
+				haveRange = ParseContentRangeBytes(header.substr(v), first, last);
+			}
+			line = eol + 2;
+		}
+		const size_t data = headersEnd + 4;
+		const unsigned long long len = last - first + 1;
+		if (!haveRange || len > body.size() - data) return false;
+		outParts.push_back(PackPart{ first, body.substr(data, (size_t)len) });
+		pos = data + (size_t)len;
+	}
+}
+// Like WinHttpReadAllToString, but this is sync traffic: progress and the bandwidth cap apply.
+static bool PackReadBody(HINTERNET hRequest, std::string& outBody, size_t maxBytes, const CancelToken& cancel, std::string* outErr)
+{
+	outBody.clear();
+	for (;;)
+	{
+		if (cancel.IsCanceled()) { if (outErr) *outErr = "Canceled"; return false; }
+		DWORD avail = 0;
+		if (!WinHttpQueryDataAvailable(hRequest, &avail))
+		{
+			if (outErr) *outErr = "WinHttpQueryDataAvailable failed (" + std::to_string(GetLastError()) + ")";
+			return false;
+		}
+		if (avail == 0) return true;
+		const DWORD want = (std::min)(avail, AppConstants::kDownloadChunkBytes);
+		if (outBody.size() + (size_t)want > maxBytes)
+		{
+			if (outErr) *outErr = "Range reply larger than requested";
+			return false;
+		}
+		const size_t at = outBody.size();
+		outBody.resize(at + (size_t)want);
+		DWORD read = 0;
+		if (!WinHttpReadData(hRequest, &outBody[at], want, &read))
+		{
+			if (outErr) *outErr = "WinHttpReadData failed (" + std::to_string(GetLastError()) + ")";
+			return false;
+		}
+		outBody.resize(at + (size_t)read);
+		if (read == 0) return true;
+		ProgressReporterAddNetBytes(read);
+		PerfNoteReceivedBytes(read);
+		BandwidthLimiterConsume(read, cancel);
+	}
+}
+// One range request against a pack; parts received are appended to outParts even on failure.
+// outIgnored = the server sent the whole pack (200) instead, which is not read.
+static bool PackFetchRanges(const std::string& url, const std::vector<PackSpan>& spans, std::vector<PackPart>& outParts,
+	const CancelToken& cancel, bool& outIgnored)
+{
+	outIgnored = false;
+	HttpRangeRequest range;
+	unsigned long long want = 0;
+	for (const PackSpan& sp : spans)
+	{
+		if (!range.spans.empty()) range.spans += ",";
+		range.spans += std::to_string(sp.first) + "-" + std::to_string(sp.last);
+		want += sp.last - sp.first + 1;
+	}
+	WinHttpGetCtx ctx;
+	if (!WinHttpOpenGet_NoRedirects(url, ctx, cancel, AppConstants::kFileConnectTimeoutMs, AppConstants::kFileTimeoutMs,
+		nullptr, nullptr, nullptr, false, &range))
+		return false;
+	if (!range.partial)
+	{
+		outIgnored = true;
+		return false;
+	}
+	// Multipart framing adds well under 512 bytes per part.
+	std::string body;
+	if (!PackReadBody((HINTERNET)ctx.request.get(), body, (size_t)want + spans.size() * 512 + 4096, cancel, nullptr))
+		return false;
+	if (StartsWith(ToLowerAsciiCopy(range.contentType), "multipart/byteranges"))
+		return SplitMultipartByteRanges(range.contentType, body, outParts);
+	unsigned long long first = 0, last = 0;
+	if (!ParseContentRangeBytes(range.contentRange, first, last) || last - first + 1 != body.size())
+		return false;
+	outParts.push_back(PackPart{ first, std::move(body) });
+	return true;
+}
+static const PackPart* PackPartsFind(const std::vector<PackPart>& parts, unsigned long long offset, unsigned long long size)
+{
+	for (const PackPart& p : parts)
+	{
+		if (offset >= p.first && offset - p.first <= p.bytes.size() && size <= p.bytes.size() - (offset - p.first))
+			return &p;
+	}
+	return nullptr;
+}
+// Writes one blob to every path that wants it: split out of the pack when it verifies, else
+// copied from a path already filled, else the ordinary per-file GET.
+static void PackFetchCompleteBlob(PackFetchState& st, const PackFetchBlob& blob, const std::vector<PackPart>& parts)
+{
+	DownloadPoolState& pool = *st.pool;
+	const SyncConfig& cfg = *pool.cfg;
+
+	std::string bytes;
+	bool fromPack = false;
+	if (blob.loc.size == 0)
+	{
+		// Nothing to fetch: the content is known once the sha256 is that of no bytes.
+		std::string sha;
+		fromPack = Sha256BytesHexLower(bytes.data(), 0, sha) && sha == blob.shaLower;
+	}
+	else if (const PackPart* part = PackPartsFind(parts, blob.loc.offset, blob.loc.size))
+	{
+		bytes.assign(part->bytes, (size_t)(blob.loc.offset - part->first), (size_t)blob.loc.size);
+		std::string sha;
+		fromPack = Sha256BytesHexLower(bytes.data(), bytes.size(), sha) && sha == blob.shaLower;
+	}
+	// An unchanged path may have offered the content after the owner deferred it.
+	fs::path source;
+	if (!fromPack)
+		(void)BlobRegistryReadySource(pool.blobs, blob.shaLower, source);
+
+	for (size_t position : blob.positions)
+	{
+		if (pool.cancel.IsCanceled())
+			return;
+		const ManifestEntry& entry = (*pool.workList)[pool.order[position]];
+		std::string rel(entry.relPath);
+		if (StartsWith(rel, "mappack/"))
+			rel = rel.substr(strlen("mappack/"));
+		const fs::path localFile = MakeDestPath(cfg.localBase, rel);
+		const bool existed = (LocalTreeFind(*pool.tree, localFile) != kLocalTreeNone);
+
+		EntrySyncResult res;
+		std::string err, how;
+		long http = 0;
+		bool ok = false, linked = false;
+		if (fromPack)
+		{
+			std::error_code ec;
+			fs::create_directories(localFile.parent_path(), ec);
+			ok = HttpCacheWriteFileAtomic(localFile, bytes);
+			if (ok)
+			{
+				how = " (from pack)";
+				++pool.counts->packedFiles;
+			}
+			else
+				err = "Write failed (" + std::to_string(GetLastError()) + ")";
+		}
+		else if (!source.empty() && FillFromLocalBlob(source, localFile, blob.shaLower, cfg.dedupHardLinks, linked, nullptr))
+		{
+			ok = true;
+			how = linked ? " (hard-linked identical local file)" : " (copied identical local file)";
+			++pool.counts->localCopies;
+		}
+		else
+		{
+			ok = DownloadFileFromMirrors(std::string(entry.remotePath), localFile, blob.shaLower,
+				cfg.localBase / kPartialDownloadDirName, entry.size, pool.cancel, &err, &http);
+			if (!ok && pool.cancel.IsCanceled())
+				return;
+		}
+
+		if (ok)
+		{
+			if (source.empty()) source = localFile;
+			NoteFetchedEntry(res, entry, localFile, rel, existed, how, *pool.counts);
+		}
+		else
+		{
+			++pool.counts->failed;
+			res.logLine = "  FAILED DOWNLOAD: " + rel + " (HTTP " + std::to_string(http) + ") " + err + "\r\n";
+		}
+		DownloadPoolCompleteEntry(pool, position, entry, std::move(res));
+	}
+}
+static void PackFetchRunJob(PackFetchState& st, const PackFetchJob& job)
+{
+	DownloadPoolState& pool = *st.pool;
+	// Packs are verified blob by blob, so the fastest mirror serves them too.
+	const std::string url = JoinUrl(MirrorHostsInOrder().front(), std::string(kPackDirPath) + pool.packs.index.packNames[job.pack]);
+	std::vector<PackPart> parts;
+	bool ignored = false;
+	if (job.spans.size() > 1 && !st.noMultiRange.load() && !st.noRanges.load())
+	{
+		if (!PackFetchRanges(url, job.spans, parts, pool.cancel, ignored) && ignored)
+			st.noMultiRange = true;
+	}
+	// One span per request for whatever the multi-range reply did not deliver.
+	for (const PackSpan& sp : job.spans)
+	{
+		if (st.noRanges.load() || pool.cancel.IsCanceled())
+			break;
+		if (PackPartsFind(parts, sp.first, sp.last - sp.first + 1))
+			continue;
+		if (!PackFetchRanges(url, { sp }, parts, pool.cancel, ignored) && ignored)
+			st.noRanges = true;
+	}
+	for (size_t b : job.blobs)
+		PackFetchCompleteBlob(st, st.blobs[b], parts);
+}
+static void PackFetchRun(PackFetchState& st)
+{
+	for (;;)
+	{
+		if (st.pool->cancel.IsCanceled())
+			break;
+		const size_t j = st.nextJob.fetch_add(1);
+		if (j >= st.jobs.size())
+			break;
+		PackFetchRunJob(st, st.jobs[j]);
+	}
+}
+static unsigned __stdcall PackFetchThreadProc(void* param)
+{
+	PackFetchState& st = *static_cast<PackFetchState*>(param);
+	t_logCapture = st.pool->logCapture;
+	t_progress = st.pool->progress;
+	t_perf = st.pool->perf;
+	PackFetchRun(st);
+	return 0;
+}
+static void FetchDeferredFromPacks(DownloadPoolState& pool, int downloadWidth)
+{
+	PackFetchState st;
+	st.pool = &pool;
+
+	// Every deferred sha256 is in the index: its owner checked before deferring.
+	std::sort(pool.deferred.begin(), pool.deferred.end());
+	std::unordered_map<std::string, size_t> blobBySha;
+	for (size_t position : pool.deferred)
+	{
+		const std::string sha = (*pool.workList)[pool.order[position]].Sha256Hex();
+		auto it = blobBySha.find(sha);
+		if (it == blobBySha.end())
+		{
+			it = blobBySha.emplace(sha, st.blobs.size()).first;
+			st.blobs.push_back(PackFetchBlob{ sha, *PackIndexFind(&pool.packs.index, sha, -1), {} });
+		}
+		st.blobs[it->second].positions.push_back(position);
+	}
+
+	std::vector<size_t> byLoc(st.blobs.size());
+	for (size_t b = 0; b < byLoc.size(); ++b)
+		byLoc[b] = b;
+	std::sort(byLoc.begin(), byLoc.end(), [&st](size_t a, size_t b)
+		{
+			const PackBlobLoc& x = st.blobs[a].loc;
+			const PackBlobLoc& y = st.blobs[b].loc;
+			return x.pack != y.pack ? x.pack < y.pack : x.offset < y.offset;
+		});
+	std::vector<size_t> empties;   // zero-length blobs need no bytes at all (written without a request)
+	unsigned long long jobBytes = 0;
+	for (size_t b : byLoc)
+	{
+		const PackBlobLoc& loc = st.blobs[b].loc;
+		if (loc.size == 0) { empties.push_back(b); continue; }
+		const PackSpan want{ loc.offset, loc.offset + loc.size - 1 };
+		PackFetchJob* job = (!st.jobs.empty() && st.jobs.back().pack == loc.pack) ? &st.jobs.back() : nullptr;
+		PackSpan* tail = job ? &job->spans.back() : nullptr;
+		const unsigned long long grow = (tail && want.last > tail->last) ? want.last - tail->last : 0;
+		if (tail && want.first <= tail->last + 1 + AppConstants::kPackRangeGapBytes && jobBytes + grow <= AppConstants::kPackMaxRequestBytes)
+		{
+			tail->last += grow;
+			jobBytes += grow;
+		}
+		else if (job && job->spans.size() < AppConstants::kPackMaxRangesPerRequest && jobBytes + loc.size <= AppConstants::kPackMaxRequestBytes)
+		{
+			job->spans.push_back(want);
+			jobBytes += loc.size;
+		}
+		else
+		{
+			st.jobs.push_back(PackFetchJob{ loc.pack, { want }, {} });
+			jobBytes = loc.size;
+		}
+		st.jobs.back().blobs.push_back(b);
+	}
+
+	std::unordered_set<size_t> packsUsed;
+	for (const auto& job : st.jobs)
+		packsUsed.insert(job.pack);
+	Log("  Fetching " + std::to_string(pool.deferred.size()) + " small files from " + std::to_string(packsUsed.size())
+		+ " pack(s) in " + std::to_string(st.jobs.size()) + " range request(s) ...\r\n");
+
+	const std::vector<PackPart> noParts;
+	for (size_t b : empties)
+		PackFetchCompleteBlob(st, st.blobs[b], noParts);
+
+	const size_t workerCount = (std::min)((size_t)(std::max)(downloadWidth, 1), st.jobs.size());
+	std::vector<unique_handle> workers;
+	std::vector<HANDLE> waitHandles;
+	for (size_t w = 0; w < workerCount; ++w)
+	{
+		unique_handle th(reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, &PackFetchThreadProc, &st, 0, nullptr)));
+		if (!th)
+			break;
+		waitHandles.push_back(th.get());
+		workers.push_back(std::move(th));
+	}
+	if (workers.empty())
+		PackFetchRun(st);
+	else
+		WaitForMultipleObjects((DWORD)waitHandles.size(), waitHandles.data(), TRUE, INFINITE);
+}
+// `workList` is md.workList or the incremental subset of it (SelectIncrementalWorkList); md itself
+// still scopes the dedup sources and the partial-download prune to the whole manifest.
+static void DownloadAndUpdateFiles(const SyncConfig& cfg, const ManifestData& md, const std::vector<ManifestEntry>& workList,
+	const HashIndex& cachedIndex, HashIndex& ioFreshIndex, LocalTreeSnapshot& tree, SyncCounters& ioCounts, const CancelToken& cancel)
+{
 	if (cancel.IsCanceled()) return;
-	if (!anyChanged)
+	Log("Parsing MapPack 5.0 manifest: Searching files that are missing or has changed (Needs updated) ...\r\n");
+	const size_t total = workList.size();
+
+	// Weight progress by size only when every entry carries one (older manifests fall back to counts).
+	unsigned long long totalBytes = 0;
+	for (const auto& e : workList)
+	{
+		if (e.size < 0) { totalBytes = 0; break; }
+		totalBytes += (unsigned long long)e.size;
+	}
+	ProgressReporterBegin(L"File", total, totalBytes);
+
+	DownloadPoolState pool;
+	pool.cfg = &cfg;
+	pool.workList = &workList;
+	pool.counts = &ioCounts;
+	pool.cachedIndex = &cachedIndex;
+	pool.tree = &tree;
+	pool.freshIndex = &ioFreshIndex;
+	pool.cancel = cancel;
+	pool.logCapture = t_logCapture;
+	pool.progress = t_progress;
+	pool.perf = t_perf;
+	pool.order = BuildSyncSchedule(workList);
+	BlobRegistryAddIndexSources(pool.blobs, cfg, md, cachedIndex, tree);
+	pool.packs.cfg = &cfg;
+	pool.packs.cancel = cancel;
+	EnsureMirrorHostsConfigured();
+	const std::vector<std::string> hosts = MirrorHostsInOrder();
+	if (hosts.size() > 1)
+	{
+		std::string list;
+		for (const auto& h : hosts)
+			list += (list.empty() ? "" : ", ") + h;
+		Log("  Download hosts (preferred first): " + list + "\r\n");
+	}
+	pool.resultLines.resize(total);
+	pool.resultDone.assign(total, 0);
+
+	// The cap only applies while this sync runs; support-file downloads stay unthrottled.
+	BandwidthLimiterBegin((unsigned long long)(std::max)(cfg.maxDownloadKBps, 0) * 1024ull);
+	ScopeExit bandwidthReset{ []() { BandwidthLimiterEnd(); } };
+
+	// Pool width covers both jobs: local hashing scales with cores, while downloads are capped
+	// separately by the semaphore so the configured DownloadWorkers width still holds.
+	const int downloadWidth = std::clamp(cfg.downloadWorkers, 1, AppConstants::kMaxDownloadWorkers);
+	SYSTEM_INFO si{};
+	GetSystemInfo(&si);
+	size_t workerCount = (size_t)std::clamp((std::max)(downloadWidth, (int)si.dwNumberOfProcessors), 1, AppConstants::kMaxSyncPoolWorkers);
+	if (workerCount > total) workerCount = total;
+	unique_handle downloadSlots(CreateSemaphoreW(nullptr, downloadWidth, downloadWidth, nullptr));
+	pool.downloadSlots = downloadSlots.get();
+	PerfPhase poolPhase("Check + download files (hash, transfer, verify)");
+
+	std::vector<unique_handle> workers;
+	std::vector<HANDLE> waitHandles;
+	for (size_t w = 0; w < workerCount; ++w)
+	{
+		unique_handle th(reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, &DownloadPoolThreadProc, &pool, 0, nullptr)));
+		if (!th)
+			break;
+		waitHandles.push_back(th.get());
+		workers.push_back(std::move(th));
+	}
+	// If no worker could be started (or the manifest is empty), run the loop on this thread.
+	if (workers.empty())
+		DownloadPoolRun(pool);
+	else
+		WaitForMultipleObjects((DWORD)waitHandles.size(), waitHandles.data(), TRUE, INFINITE);
+	poolPhase.End();
+	if (!pool.deferred.empty() && !cancel.IsCanceled())
+	{
+		PerfPhase packPhase("Pack bundle fetch");
+		FetchDeferredFromPacks(pool, downloadWidth);
+	}
+	ProgressReporterEnd(!cancel.IsCanceled());
+	// Workers are done, so the snapshot can take the new files (and their folders) for cleanup.
+	for (const auto& created : pool.createdFiles)
+		LocalTreeNoteFileAdded(tree, created.first, created.second);
+	if (!cancel.IsCanceled())
+	{
+		std::unordered_set<std::string> wanted;
+		for (const auto& e : md.workList)
+			wanted.insert(e.Sha256Hex());
+		PrunePartialDownloads(cfg.localBase / kPartialDownloadDirName, wanted);
+	}
+
+	if (CheckAndHandleCancel(cancel, "INFO: Canceled during parsing.\r\n"))
+		return;
+	if (ioCounts.downloaded.load() == 0 && ioCounts.updated.load() == 0)
 		Log("  No missing or changed files found. Your files are in sync with the manifest!\r\n");
 	PostProgressTextW(L"Sync complete");
 }
@@ -4638,49 +9350,195 @@ static void LogSummaryAndCleanup(const SyncConfig& cfg, const SyncCounters& c, c
 	if (cancel.IsCanceled()) return;
 
 	Log("\r\n  Sync Summary:\r\n");
-	Log("    Downloaded (missing):  " + std::to_string(c.downloaded) + "\r\n");
-	Log("    Updated (different):  " + std::to_string(c.updated) + "\r\n");
-	Log("    Unchanged (same):  " + std::to_string(c.unchanged) + "\r\n");
-	if (c.skippedExcluded > 0)
-		Log("    Exclusions Skipped:  " + std::to_string(c.skippedExcluded) + "\r\n");
-	Log("    Failed Downloads/Updates:  " + std::to_string(c.failed) + "\r\n");
-}
-static void RunSync(const SyncConfig& cfg, const CancelToken& cancel)
+	Log("    Downloaded (missing):  " + std::to_string(c.downloaded.load()) + "\r\n");
+	Log("    Updated (different):  " + std::to_string(c.updated.load()) + "\r\n");
+	Log("    Unchanged (same):  " + std::to_string(c.unchanged.load()) + "\r\n");
+	if (c.manifestDiffSkips.load() > 0)
+		Log("      (unchanged since the last applied manifest, not checked:  " + std::to_string(c.manifestDiffSkips.load()) + ")\r\n");
+	if (c.hashIndexHits.load() > 0)
+		Log("      (verified from hash index without re-reading:  " + std::to_string(c.hashIndexHits.load()) + ")\r\n");
+	if (c.sizeMismatches.load() > 0)
+		Log("    (stale by size, re-downloaded without hashing:  " + std::to_string(c.sizeMismatches.load()) + ")\r\n");
+	if (c.localCopies.load() > 0)
+		Log("    (filled from identical local files, not downloaded:  " + std::to_string(c.localCopies.load()) + ")\r\n");
+	if (c.packedFiles.load() > 0)
+		Log("    (fetched from pack bundles with range requests:  " + std::to_string(c.packedFiles.load()) + ")\r\n");
+	if (c.skippedExcluded.load() > 0)
+		Log("    Exclusions Skipped:  " + std::to_string(c.skippedExcluded.load()) + "\r\n");
+	Log("    Failed Downloads/Updates:  " + std::to_string(c.failed.load()) + "\r\n");
+}
+// Downloads the manifest and logs its summary. False (already logged) = nothing may be synced.
+static bool DownloadManifestForSync(const SyncConfig& cfg, ManifestData& md, const CancelToken& cancel)
 {
-	ManifestData md;
 	std::string err;
 	if (!DownloadAndParseManifest(cfg, md, err, cancel))
 	{
 		Log("ERROR: " + err + "\r\n");
 		Log("Aborting sync. No local deletes/cleanup will be performed.\r\n");
 		PostProgressTextW(L"Aborted (manifest error).");
-		return;
+		return false;
 	}
 	// Completes the earlier "Downloading manifest..." log line.
 	Log("Success!\r\n");
 	Log("  Manifest file count: " + std::to_string(md.workList.size()) + "\r\n");
+	if (!md.sourceNote.empty())
+		Log("  Manifest source: " + md.sourceNote + "\r\n");
+	return true;
+}
+// --------------------------------------------------
+// Incremental sync (manifest diff against the per-root hash index)
+// - The hash index written after a clean sync holds the sha256 of every entry it applied, so it
+//   doubles as this install's copy of the last applied manifest (the global manifest cache is
+//   shared by every /sync folder and cannot).
+// - Entries whose manifest sha256 still equals the index's, and whose file the tree scan shows
+//   with the indexed size and last-write time, are carried over without being opened. Every
+//   other entry (changed, added, excluded, touched on disk) goes through the normal pool.
+// - Removed entries need nothing extra: the orphan sweep already works off the tree snapshot.
+// - A full pass runs when the index predates this feature, [Preferences] ForceFullVerify=1, or
+//   the last full pass is older than [Preferences] FullVerifyDays (0 = every sync), so local
+//   tampering that kept size and time is still caught.
+// --------------------------------------------------
+static unsigned long long FileTimeNowTicks()
+{
+	FILETIME ft{};
+	GetSystemTimeAsFileTime(&ft);
+	return ((unsigned long long)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+}
+// False = run a full pass; outWhy says why (for the log).
+static bool IncrementalSyncAllowed(const SyncConfig& cfg, const HashIndex& cachedIndex, std::string& outWhy)
+{
+	outWhy.clear();
+	if (cfg.forceFullVerify)
+	{
+		outWhy = "ForceFullVerify is enabled";
+		return false;
+	}
+	if (cachedIndex.manifestSha256.empty() || cachedIndex.fullPassTime == 0)
+	{
+		outWhy = "no record of the last applied manifest for this folder";
+		return false;
+	}
+	if (cfg.fullVerifyDays <= 0)
+	{
+		outWhy = "FullVerifyDays=0";
+		return false;
+	}
+	static constexpr unsigned long long kTicksPerDay = 864000000000ull;
+	const unsigned long long now = FileTimeNowTicks();
+	if (cachedIndex.fullPassTime > now || now - cachedIndex.fullPassTime >= (unsigned long long)cfg.fullVerifyDays * kTicksPerDay)
+	{
+		outWhy = "periodic full verify (FullVerifyDays=" + std::to_string(cfg.fullVerifyDays) + ")";
+		return false;
+	}
+	return true;
+}
+// Entries of md.workList that must be checked this run, still sorted by relPath. Unchanged
+// entries are counted and their index records copied into ioFreshIndex.
+static std::vector<ManifestEntry> SelectIncrementalWorkList(const SyncConfig& cfg, const ManifestData& md,
+	const HashIndex& cachedIndex, const LocalTreeSnapshot& tree, HashIndex& ioFreshIndex, SyncCounters& ioCounts)
+{
+	std::vector<ManifestEntry> changed;
+	size_t skipped = 0;
+	std::string relKey;
+	for (const auto& entry : md.workList)
+	{
+		relKey.assign(entry.relPath.data(), entry.relPath.size());
+		auto it = cachedIndex.entries.find(relKey);
+		bool same = it != cachedIndex.entries.end() && it->second.sha256 == entry.Sha256Hex()
+			&& (entry.size < 0 || it->second.stamp.size == (unsigned long long)entry.size);
+		if (same)
+		{
+			std::string rel = relKey;
+			if (StartsWith(rel, "mappack/"))
+				rel = rel.substr(strlen("mappack/"));
+			const fs::path file = MakeDestPath(cfg.localBase, rel);
+			const size_t found = IsPathExcluded(cfg.exclusions, file) ? kLocalTreeNone : LocalTreeFind(tree, file);
+			same = found != kLocalTreeNone && LocalTreeIsFile(tree.entries[found])
+				&& tree.entries[found].size == it->second.stamp.size && tree.entries[found].lastWrite == it->second.stamp.lastWrite;
+		}
+		if (!same)
+		{
+			changed.push_back(entry);
+			continue;
+		}
+		ioFreshIndex.entries.emplace(relKey, it->second);
+		++skipped;
+	}
+	ioCounts.unchanged += skipped;
+	ioCounts.manifestDiffSkips += skipped;
+	return changed;
+}
+// Syncs one install against an already verified manifest. `md` is only read, so the headless
+// batch runs one of these per folder concurrently on the same ManifestData.
+static void SyncInstallWithManifest(const SyncConfig& cfg, const ManifestData& md, SyncCounters& counts, const CancelToken& cancel)
+{
 	if (CheckAndHandleCancel(cancel, "INFO: Canceled after manifest.\r\n"))
 		return;
 	Log("\r\nSyncing MapPack 5.0 Root folder:  " + PathToUtf8(cfg.localSyncRoot) + "\r\n");
-	SyncCounters counts;
 	LogSeparator();
 
 	if (CheckAndHandleCancel(cancel, "INFO: Canceled before downloads.\r\n"))
 		return;
 
-	DownloadAndUpdateFiles(cfg, md, counts, cancel);
+	// Hash index: trusted metadata->sha256 cache from the last clean sync of this root.
+	const std::wstring rootKey = NormalizeExclusionPathForCompare(cfg.localSyncRoot);
+	HashIndex cachedIndex;
+	cachedIndex.rootKey = rootKey;
+	if (cfg.forceFullVerify)
+		Log("INFO: Full verify enabled (Preferences); every local file will be re-hashed.\r\n");
+	else
+	{
+		PerfPhase phase("Hash index load");
+		if (!LoadHashIndex(GetHashIndexPath(rootKey), rootKey, cachedIndex))
+			(void)LoadHashIndex(GetLegacyHashIndexPath(), rootKey, cachedIndex);
+	}
+	if (cfg.maxDownloadKBps > 0)
+		Log("INFO: Download bandwidth limited to " + std::to_string(cfg.maxDownloadKBps) + " KB/s (Preferences).\r\n");
+	HashIndex freshIndex;
+	freshIndex.rootKey = rootKey;
+
+	// One walk of resources_override (or the saved snapshot plus the change journal) serves every phase below.
+	LocalTreeSnapshot tree;
+	UsnJournalMark journalMark;
+	const fs::path treeCachePath = GetTreeCachePath(rootKey);
+	PerfPhase scanPhase("Local tree scan");
+	if (!LoadOrScanLocalTree(cfg.localBase / "resources_override", treeCachePath, tree, journalMark, cancel))
+	{
+		CheckAndHandleCancel(cancel, "INFO: Canceled while scanning local files.\r\n");
+		return;
+	}
+	scanPhase.End();
+
+	std::string fullWhy;
+	const bool incremental = IncrementalSyncAllowed(cfg, cachedIndex, fullWhy);
+	std::vector<ManifestEntry> changedEntries;
+	if (incremental)
+	{
+		PerfPhase phase("Manifest diff");
+		changedEntries = SelectIncrementalWorkList(cfg, md, cachedIndex, tree, freshIndex, counts);
+		Log("INFO: Incremental sync: " + std::to_string(changedEntries.size()) + " of " + std::to_string(md.workList.size())
+			+ " manifest entries changed since the last applied manifest or on disk.\r\n");
+	}
+	else if (!cfg.forceFullVerify)
+		Log("INFO: Checking every manifest entry (" + fullWhy + ").\r\n");
+	DownloadAndUpdateFiles(cfg, md, incremental ? changedEntries : md.workList, cachedIndex, freshIndex, tree, counts, cancel);
 	if (CheckAndHandleCancel(cancel, "INFO: Canceled before deletions.\r\n"))
 		return;
 
 	LogSummaryAndCleanup(cfg, counts, cancel);
 
-	DeleteLocalFilesNotInManifest(cfg, md.manifestRelSet, cancel);
+	{
+		PerfPhase phase("Delete files not in manifest");
+		DeleteLocalFilesNotInManifest(cfg, md, tree, counts, cancel);
+	}
 	if (CheckAndHandleCancel(cancel, "INFO: Canceled before Log Summary & Cleanup.\r\n"))
 		return;
 
 	LogSeparator();
 	Log("MapPack 5.0 Clean-up: Searching empty sub-directories that exists (Needs deleted) ...\r\n");
-	const EmptyDirRemovalStats dirStats = RemoveEmptyDirsBottomUp(cfg.localSyncRoot, true);
+	PerfPhase dirsPhase("Remove empty folders");
+	const EmptyDirRemovalStats dirStats = RemoveEmptyDirsBottomUp(cfg.exclusions, tree, cfg.localSyncRoot, true);
+	dirsPhase.End();
 
 	if (dirStats.removed == 0 && dirStats.failed == 0)
 		Log("  No empty sub-directories found that needs deleted.\r\n");
@@ -4692,25 +9550,233 @@ static void RunSync(const SyncConfig& cfg, const CancelToken& cancel)
 	}
 
 	if (IsCanceledNoNotify(cancel)) return;
-	RemoveOldManifestListedFiles(cfg, cancel);
-	if (IsCanceledNoNotify(cancel)) return;
-	EnsureClientPrefsMapPath(cfg, cancel);
+	{
+		PerfPhase phase("Remove old manifest files + client prefs");
+		RemoveOldManifestListedFiles(cfg, tree, cancel);
+		if (IsCanceledNoNotify(cancel)) return;
+		EnsureClientPrefsMapPath(cfg, cancel);
+	}
 	if (IsCanceledNoNotify(cancel)) return;
 
-	if (counts.failed == 0 && !md.manifestSha256Lower.empty())
-	{
-		std::wstring iniErr;
-		if (!IniWriteLastSyncedManifestInfo(md.manifestSha256Lower, &iniErr))
+	if (counts.failed == 0 && !md.manifestSha256Lower.empty())
+	{
+		PerfPhase phase("Save sync state (INI, manifest copy, hash index, tree cache)");
+		std::wstring iniErr;
+		if (!IniWriteLastSyncedManifestInfo(md.manifestSha256Lower, &iniErr))
+		{
+			Log("WARNING: Sync completed, but failed to save manifest update marker to MapPackSyncTool.ini. You may be notified about this same manifest again next launch.\r\n");
+		}
+		else if (!WriteCachedManifest(md.manifestText))
+		{
+			// Only costs the delta shortcut next time; the full manifest is always a valid fallback.
+			Log("WARNING: Failed to save a local copy of the manifest; the next sync will download it in full.\r\n");
+		}
+		freshIndex.manifestSha256 = md.manifestSha256Lower;
+		freshIndex.fullPassTime = incremental ? cachedIndex.fullPassTime : FileTimeNowTicks();
+		std::wstring indexErr;
+		if (!WriteHashIndexAtomic(GetHashIndexPath(rootKey), freshIndex, &indexErr))
+			Log("WARNING: Failed to save hash index; the next sync will re-hash all files. " + WideToUtf8(indexErr) + "\r\n");
+		else
+		{
+			std::error_code ec;
+			fs::remove(GetLegacyHashIndexPath(), ec);
+		}
+		// Best effort: an older cache stays valid (its own journal mark), and without one the next sync just scans.
+		(void)WriteTreeCache(treeCachePath, tree, journalMark);
+	}
+
+	LogSeparator();
+	Log("Sync complete");
+}
+// The startup check's parsed manifest while it is recent and still the published one (one small
+// mappack_manifest.sha256 request instead of the full download). Null = download as usual.
+static std::shared_ptr<const ManifestData> TakeStartupManifest(const SyncConfig& cfg, const CancelToken& cancel)
+{
+	AppState* st = g_state;
+	if (!st) return nullptr;
+	std::shared_ptr<const ManifestData> md;
+	ULONGLONG tick = 0;
+	{
+		std::lock_guard<std::mutex> guard(st->startupManifestLock);
+		md = st->startupManifest;
+		tick = st->startupManifestTick;
+	}
+	if (!md || GetTickCount64() - tick > AppConstants::kStartupManifestMaxAgeMs)
+		return nullptr;
+	std::string headText, err;
+	long http = 0;
+	if (DownloadUrl(JoinUrl(cfg.remoteHost, kManifestHeadPath), headText, cancel, &err, &http))
+	{
+		const std::string head = ToLowerAsciiCopy(headText.substr(0, std::min<size_t>(headText.size(), 64)));
+		if (IsHex64(head) && head != md->manifestSha256Lower)
+		{
+			std::lock_guard<std::mutex> guard(st->startupManifestLock);
+			if (st->startupManifest == md)
+				st->startupManifest.reset();
+			return nullptr;
+		}
+	}
+	// No head published: the age limit alone decides, as it did for the startup notice.
+	return md;
+}
+static void RunSync(const SyncConfig& cfg, const CancelToken& cancel)
+{
+	PerfRunBegin();
+	std::shared_ptr<const ManifestData> md = TakeStartupManifest(cfg, cancel);
+	if (md)
+	{
+		Log("Using the MapPack 5.0 manifest downloaded by the startup check.\r\n");
+		Log("  Manifest file count: " + std::to_string(md->workList.size()) + "\r\n");
+	}
+	else
+	{
+		auto downloaded = std::make_shared<ManifestData>();
+		if (!DownloadManifestForSync(cfg, *downloaded, cancel))
+			return;
+		md = std::move(downloaded);
+	}
+	SyncCounters counts;
+	SyncInstallWithManifest(cfg, *md, counts, cancel);
+	if (IniReadPerfSummary() && !cancel.IsCanceled())
+	{
+		Log("\r\n");
+		PerfLogSummary();
+	}
+}
+
+
+// --------------------------------------------------
+// Parallel removal (RemoveMapPackFiles)
+// - Manifest files are deleted by a small pool (kRemoveWorkers); a delete is one open with
+//   DELETE access and a disposition set on that handle (DeleteFileByHandle), instead of the
+//   exists/remove round trips per file.
+// - POSIX semantics (Windows 10 1607+ on NTFS) unlink the name at once, even while a virus
+//   scanner or indexer still holds the file open, so the parent folder is empty right away.
+//   Older systems and other filesystems take the classic delete-on-close disposition.
+// - Workers only read the snapshot; results are logged in manifest order (as the download pool
+//   does) and applied to the snapshot after the pool, whose child counts then drive
+//   RemoveEmptyDirsBottomUp.
+// --------------------------------------------------
+#ifndef FILE_DISPOSITION_FLAG_POSIX_SEMANTICS
+#define FILE_DISPOSITION_FLAG_DELETE 0x00000001
+#define FILE_DISPOSITION_FLAG_POSIX_SEMANTICS 0x00000002
+#define FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE 0x00000010
+typedef struct _FILE_DISPOSITION_INFO_EX
+{
+	DWORD Flags;
+} FILE_DISPOSITION_INFO_EX;
+#endif
+static constexpr FILE_INFO_BY_HANDLE_CLASS kFileDispositionInfoEx = (FILE_INFO_BY_HANDLE_CLASS)21;   // FileDispositionInfoEx
+// False with outErr = the Win32 error (ERROR_FILE_NOT_FOUND / ERROR_PATH_NOT_FOUND = already gone).
+static bool DeleteFileByHandle(const fs::path& file, DWORD& outErr)
+{
+	outErr = 0;
+	unique_handle h(CreateFileW(file.c_str(), DELETE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_OPEN_REPARSE_POINT, nullptr));
+	if (!h)
+	{
+		outErr = GetLastError();
+		return false;
+	}
+	FILE_DISPOSITION_INFO_EX posix{};
+	posix.Flags = FILE_DISPOSITION_FLAG_DELETE | FILE_DISPOSITION_FLAG_POSIX_SEMANTICS | FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE;
+	if (SetFileInformationByHandle(h.get(), kFileDispositionInfoEx, &posix, sizeof(posix)))
+		return true;
+	FILE_DISPOSITION_INFO classic{};
+	classic.DeleteFile = TRUE;
+	if (SetFileInformationByHandle(h.get(), FileDispositionInfo, &classic, sizeof(classic)))
+		return true;
+	outErr = GetLastError();
+	return false;
+}
+enum class RemoveOutcome : unsigned char
+{
+	Missing,
+	Deleted,
+	Failed,
+	Excluded,
+};
+struct RemovePoolState
+{
+	const SyncConfig* cfg = nullptr;
+	const ManifestData* md = nullptr;
+	const LocalTreeSnapshot* tree = nullptr;   // read-only while workers run
+	CancelToken cancel;
+	std::atomic<size_t> nextIndex{ 0 };
+	std::vector<RemoveOutcome> outcome;        // per workList index; each slot written by one worker
+	std::vector<size_t> treeIndex;             // snapshot entry of each deleted file
+	LogCapture* logCapture = nullptr;
+	ProgressReporter* progress = nullptr;
+	PerfStats* perf = nullptr;
+
+	std::mutex lock;                           // guards everything below
+	std::vector<std::string> resultLines;
+	std::vector<unsigned char> resultDone;
+	size_t emitCursor = 0;
+};
+static void RemovePoolRun(RemovePoolState& pool)
+{
+	const size_t total = pool.md->workList.size();
+	for (;;)
+	{
+		if (pool.cancel.IsCanceled())
+			break;
+		const size_t i = pool.nextIndex.fetch_add(1);
+		if (i >= total)
+			break;
+		const std::string_view& relView = pool.md->workList[i].relPath;
+		const std::string rel(relView);
+		const fs::path localFile = MakeDestPath(pool.cfg->localBase, rel);
+		std::string line;
+		RemoveOutcome outcome = RemoveOutcome::Missing;
+		const size_t found = LocalTreeFind(*pool.tree, localFile);
+		if (IsPathExcluded(pool.cfg->exclusions, localFile))
+		{
+			outcome = RemoveOutcome::Excluded;
+			line = "  EXCLUSION SKIPPED: resources_override/mappack/" + rel + "\r\n";
+		}
+		else if (found != kLocalTreeNone)
+		{
+			DWORD err = 0;
+			if (DeleteFileByHandle(localFile, err))
+			{
+				outcome = RemoveOutcome::Deleted;
+				line = "  DELETED: resources_override/mappack/" + rel + "\r\n";
+			}
+			else if (err != ERROR_FILE_NOT_FOUND && err != ERROR_PATH_NOT_FOUND)
+			{
+				outcome = RemoveOutcome::Failed;
+				line = "  FAILED DELETE: resources_override/mappack/" + rel + " (" + WideToUtf8(Win32ErrorMessage(err)) + ")\r\n";
+			}
+		}
+		pool.outcome[i] = outcome;
+		pool.treeIndex[i] = found;
+		ProgressReporterEntryDone(&relView, 0);
+
+		std::lock_guard<std::mutex> guard(pool.lock);
+		pool.resultLines[i] = std::move(line);
+		pool.resultDone[i] = 1;
+		while (pool.emitCursor < total && pool.resultDone[pool.emitCursor])
 		{
-			Log("WARNING: Sync completed, but failed to save manifest update marker to MapPackSyncTool.ini. You may be notified about this same manifest again next launch.\r\n");
+			std::string& pending = pool.resultLines[pool.emitCursor];
+			if (!pending.empty())
+			{
+				Log(pending);
+				std::string().swap(pending);
+			}
+			++pool.emitCursor;
 		}
 	}
-
-	LogSeparator();
-	Log("Sync complete");
 }
-
-
+static unsigned __stdcall RemovePoolThreadProc(void* param)
+{
+	RemovePoolState& pool = *static_cast<RemovePoolState*>(param);
+	t_logCapture = pool.logCapture;
+	t_progress = pool.progress;
+	t_perf = pool.perf;
+	RemovePoolRun(pool);
+	return 0;
+}
 // --------------------------------------------------
 // Remove (uninstall) MapPack files
 // - Deletes files listed in mappack_manifest.json (under resources_override\mappack\...)
@@ -4719,6 +9785,7 @@ static void RunSync(const SyncConfig& cfg, const CancelToken& cancel)
 // --------------------------------------------------
 static void RemoveMapPackFiles(const SyncConfig& cfg, const CancelToken& cancel)
 {
+	PerfRunBegin();
 	ManifestData md;
 	std::string err;
 	if (!DownloadAndParseManifest(cfg, md, err, cancel))
@@ -4735,49 +9802,72 @@ static void RemoveMapPackFiles(const SyncConfig& cfg, const CancelToken& cancel)
 	if (CheckAndHandleCancel(cancel, "INFO: Canceled after manifest.\r\n"))
 		return;
 
+	LocalTreeSnapshot tree;
+	PerfPhase scanPhase("Local tree scan");
+	if (!ScanLocalTree(cfg.localBase / "resources_override", tree, cancel))
+	{
+		CheckAndHandleCancel(cancel, "INFO: Canceled while scanning local files.\r\n");
+		return;
+	}
+	scanPhase.End();
+
 	LogSeparator();
 	Log("Parsing and removing files from MapPack 5.0 manifest ...\r\n");
-	PostProgressInit(md.workList.size());
+	ProgressReporterBegin(L"Removing", md.workList.size(), 0);
+	PerfPhase deletePhase("Delete manifest files");
+
+	const size_t total = md.workList.size();
+	RemovePoolState pool;
+	pool.cfg = &cfg;
+	pool.md = &md;
+	pool.tree = &tree;
+	pool.cancel = cancel;
+	pool.logCapture = t_logCapture;
+	pool.progress = t_progress;
+	pool.perf = t_perf;
+	pool.outcome.assign(total, RemoveOutcome::Missing);
+	pool.treeIndex.assign(total, kLocalTreeNone);
+	pool.resultLines.resize(total);
+	pool.resultDone.assign(total, 0);
+
+	std::vector<unique_handle> workers;
+	std::vector<HANDLE> waitHandles;
+	const size_t workerCount = (std::min)((size_t)AppConstants::kRemoveWorkers, total);
+	for (size_t w = 0; w < workerCount; ++w)
+	{
+		unique_handle th(reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, &RemovePoolThreadProc, &pool, 0, nullptr)));
+		if (!th)
+			break;
+		waitHandles.push_back(th.get());
+		workers.push_back(std::move(th));
+	}
+	if (workers.empty())
+		RemovePoolRun(pool);
+	else
+		WaitForMultipleObjects((DWORD)waitHandles.size(), waitHandles.data(), TRUE, INFINITE);
+	CheckAndHandleCancel(cancel, "INFO: Canceled during remove.\r\n");
 
 	size_t deleted = 0;
 	size_t missing = 0;
 	size_t failed = 0;
 	size_t skippedExcluded = 0;
-
-	for (size_t i = 0; i < md.workList.size(); ++i)
+	for (size_t i = 0; i < total; ++i)
 	{
-		if (CheckAndHandleCancel(cancel, "INFO: Canceled during remove.\r\n"))
-			break;
-
-		const std::string& rel = md.workList[i].relPath;
-		ScopeExit progressGuard{ [i]() { PostProgressSet(i + 1); } };
-		PostProgressTextW(MakeProgressFileLabel(L"Removing", i + 1, md.workList.size(), rel, nullptr));
-		fs::path localFile = MakeDestPath(cfg.localBase, rel);
-		if (IsPathExcluded(localFile))
-		{
-			++skippedExcluded;
-			Log("  EXCLUSION SKIPPED: resources_override/mappack/" + rel + "\r\n");
-			continue;
-		}
-
-		std::error_code ec;
-		if (!fs::exists(localFile, ec) || ec)
-		{
-			++missing;
-			continue;
-		}
-		ec.clear();
-		if (fs::remove(localFile, ec) && !ec)
+		if (!pool.resultDone[i])
+			continue;   // not reached before cancel
+		switch (pool.outcome[i])
 		{
+		case RemoveOutcome::Deleted:
 			++deleted;
-			Log("  DELETED: resources_override/mappack/" + rel + "\r\n");
-		}
-		else
-		{
-			++failed;
-			Log("  FAILED DELETE: resources_override/mappack/" + rel + " (" + (ec ? ec.message() : std::string("unknown")) + ")\r\n");
+			LocalTreeNoteRemoved(tree, pool.treeIndex[i]);
+			break;
+		case RemoveOutcome::Missing: ++missing; break;
+		case RemoveOutcome::Failed: ++failed; break;
+		case RemoveOutcome::Excluded: ++skippedExcluded; break;
 		}
 	}
+	ProgressReporterEnd(!cancel.IsCanceled());
+	deletePhase.End();
 
 	if (deleted > 0 || failed > 0 || skippedExcluded > 0)
 		Log("\r\n"); //Add blank line
@@ -4790,10 +9880,17 @@ static void RemoveMapPackFiles(const SyncConfig& cfg, const CancelToken& cancel)
 		Log("  Exclusions Skipped:  " + std::to_string(skippedExcluded) + "\r\n");
 
 	if (IsCanceledNoNotify(cancel)) return;
+	{
+		// Interrupted downloads kept for resuming are of no use once the pack is gone.
+		std::error_code ec;
+		fs::remove_all(cfg.localBase / kPartialDownloadDirName, ec);
+	}
 	LogSeparator();
 	Log("Removing empty sub-directories from MapPack 5.0 (sync root) ...\r\n");
 
-	const EmptyDirRemovalStats dirStats = RemoveEmptyDirsBottomUp(cfg.localSyncRoot, true);
+	PerfPhase dirsPhase("Remove empty folders");
+	const EmptyDirRemovalStats dirStats = RemoveEmptyDirsBottomUp(cfg.exclusions, tree, cfg.localSyncRoot, true);
+	dirsPhase.End();
 	if (dirStats.removed == 0 && dirStats.failed == 0)
 		Log("  No empty sub-directories found; Nothing to delete.\r\n");
 	else
@@ -4803,19 +9900,52 @@ static void RemoveMapPackFiles(const SyncConfig& cfg, const CancelToken& cancel)
 		Log("  Failed deletions: " + std::to_string(dirStats.failed) + "\r\n");
 	}
 	if (IsCanceledNoNotify(cancel)) return;
-	RemoveOldManifestListedFiles(cfg, cancel);
+	{
+		PerfPhase phase("Remove old manifest files + client prefs");
+		RemoveOldManifestListedFiles(cfg, tree, cancel);
 
-	if (IsCanceledNoNotify(cancel)) return;
-	EnsureClientPrefsMapPath_Remove(cfg, cancel);
+		if (IsCanceledNoNotify(cancel)) return;
+		EnsureClientPrefsMapPath_Remove(cfg, cancel);
+	}
 
 	if (IsCanceledNoNotify(cancel)) return;
 	LogSeparator();
 	Log("All known versions of MapPack has been Removed/Uninstalled.\r\n");
 	PostProgressTextW(L"Remove/Uninstall complete.");
+	if (IniReadPerfSummary())
+		PerfLogSummary();
+}
+// Sync settings for a validated install folder, read from the INI ([Preferences], exclusions).
+static SyncConfig MakeSyncConfig(const PreflightResult& pf)
+{
+	SyncConfig cfg;
+	cfg.remoteHost = kRemoteHost;
+	cfg.remoteRootPath = kRemoteRootPath;
+	cfg.manifestUrl = JoinUrl(kRemoteHost, kManifestPath);
+	cfg.localBase = pf.localBase;
+	cfg.localSyncRoot = pf.localSyncRoot;
+	cfg.downloadWorkers = IniReadDownloadWorkers();
+	cfg.forceFullVerify = IniReadForceFullVerify();
+	cfg.fullVerifyDays = IniReadFullVerifyDays();
+	cfg.maxDownloadKBps = IniReadMaxDownloadKBps();
+	cfg.dedupHardLinks = IniReadDedupHardLinks();
+	cfg.exclusions = LoadExclusionMatcher();
+	return cfg;
+}
+// The prefetch stages into the last used install (IniReadLastFolder). A Sync or Remove of another
+// folder never consumes those files, so they are dropped here instead of sitting there (up to
+// kMaxPrefetchBytes) until that install is synced again. Call before the last folder is updated.
+static void DiscardPrefetchForOtherFolder(const PreflightResult& target)
+{
+	const PreflightResult last = ValidateFolderSelection(IniReadLastFolder());
+	if (!last.ok || NormalizeExclusionPathForCompare(last.localBase) == NormalizeExclusionPathForCompare(target.localBase))
+		return;
+	PruneStagedDownloads(last.localBase / kPartialDownloadDirName);
 }
 static unsigned __stdcall WorkerThreadProc(void*)
 {
 	if (!g_state) return 0;
+	StopBackgroundPrefetch(g_state);   // the sync owns the network (and may use what it staged)
 	std::wstring folderWs;
 	int len = GetWindowTextLengthW(g_state->hFolderEdit);
 	if (len > 0)
@@ -4835,6 +9965,7 @@ static unsigned __stdcall WorkerThreadProc(void*)
 		{ UiEvent* ev = new UiEvent(); ev->kind = UiEventKind::WorkerDone; PostUiEvent(ev); }
 		return 0;
 	}
+	DiscardPrefetchForOtherFolder(pf);
 
 	// Persist last used folder even when user manually types it (INI created on first write).
 	if (!folderWs.empty())
@@ -4844,12 +9975,7 @@ static unsigned __stdcall WorkerThreadProc(void*)
 			Log("WARNING: Failed to save last folder to MapPackSyncTool.ini: " + WideToUtf8(iniErr) + "\r\n");
 	}
 
-	SyncConfig cfg;
-	cfg.remoteHost = kRemoteHost;
-	cfg.remoteRootPath = kRemoteRootPath;
-	cfg.manifestUrl = JoinUrl(kRemoteHost, kManifestPath);
-	cfg.localBase = pf.localBase;
-	cfg.localSyncRoot = pf.localSyncRoot;
+	const SyncConfig cfg = MakeSyncConfig(pf);
 	CancelToken cancel{ &g_state->cancelRequested };
 	RunSync(cfg, cancel);
 	g_state->isRunning.store(false);
@@ -4884,6 +10010,7 @@ static void StartSyncIfNotRunning()
 static unsigned __stdcall WorkerThreadProcRemove(void*)
 {
 	if (!g_state) return 0;
+	StopBackgroundPrefetch(g_state);
 	std::wstring folderWs;
 	int len = GetWindowTextLengthW(g_state->hFolderEdit);
 	if (len > 0)
@@ -4904,6 +10031,7 @@ static unsigned __stdcall WorkerThreadProcRemove(void*)
 		{ UiEvent* ev = new UiEvent(); ev->kind = UiEventKind::WorkerDone; PostUiEvent(ev); }
 		return 0;
 	}
+	DiscardPrefetchForOtherFolder(pf);
 
 	SyncConfig cfg;
 	cfg.remoteHost = kRemoteHost;
@@ -4911,6 +10039,7 @@ static unsigned __stdcall WorkerThreadProcRemove(void*)
 	cfg.manifestUrl = JoinUrl(kRemoteHost, kManifestPath);
 	cfg.localBase = pf.localBase;
 	cfg.localSyncRoot = pf.localSyncRoot;
+	cfg.exclusions = LoadExclusionMatcher();
 
 	CancelToken cancel{ &g_state->cancelRequested };
 	RemoveMapPackFiles(cfg, cancel);
@@ -5152,19 +10281,10 @@ static bool WinHttpDownloadUrlToFile(const wchar_t* url, const fs::path& outFile
 	if (uc.lpszExtraInfo && uc.dwExtraInfoLength)
 		path.append(uc.lpszExtraInfo, uc.dwExtraInfoLength);
 
-	HINTERNET hSession = WinHttpOpen(AppConstants::kUserAgentW, WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-	if (!hSession) { outErr = L"WinHttpOpen failed"; return false; }
-	ScopeExit closeSession{ [&]() { WinHttpCloseHandle(hSession); } };
-
-	HINTERNET hConnect = WinHttpConnect(hSession, host.c_str(), uc.nPort, 0);
-	if (!hConnect) { outErr = L"WinHttpConnect failed"; return false; }
-	ScopeExit closeConnect{ [&]() { WinHttpCloseHandle(hConnect); } };
-
-	DWORD flags = 0;
-	if (uc.nScheme == INTERNET_SCHEME_HTTPS) flags |= WINHTTP_FLAG_SECURE;
-	HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"GET", path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-	if (!hRequest) { outErr = L"WinHttpOpenRequest failed"; return false; }
-	ScopeExit closeRequest{ [&]() { WinHttpCloseHandle(hRequest); } };
+	std::string openErr;
+	WinHttpHandle request = SharedHttpClient().OpenRequest(host, uc.nPort, path, uc.nScheme == INTERNET_SCHEME_HTTPS, &openErr);
+	if (!request) { outErr = Utf8ToWide(openErr); return false; }
+	HINTERNET hRequest = (HINTERNET)request.get();
 
 	if (!WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0))
 	{
@@ -5255,19 +10375,10 @@ static bool WinHttpDownloadUrlToUtf8String(const wchar_t* url, std::string& out,
 	path.assign(uc.lpszUrlPath, uc.dwUrlPathLength);
 	if (uc.lpszExtraInfo && uc.dwExtraInfoLength) path.append(uc.lpszExtraInfo, uc.dwExtraInfoLength);
 
-	HINTERNET hSession = WinHttpOpen(AppConstants::kUserAgentW, WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-	if (!hSession) { outErr = L"WinHttpOpen failed"; return false; }
-	ScopeExit closeSession{ [&]() { WinHttpCloseHandle(hSession); } };
-
-	HINTERNET hConnect = WinHttpConnect(hSession, host.c_str(), uc.nPort, 0);
-	if (!hConnect) { outErr = L"WinHttpConnect failed"; return false; }
-	ScopeExit closeConnect{ [&]() { WinHttpCloseHandle(hConnect); } };
-
-	DWORD flags = 0;
-	if (uc.nScheme == INTERNET_SCHEME_HTTPS) flags |= WINHTTP_FLAG_SECURE;
-	HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"GET", path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-	if (!hRequest) { outErr = L"WinHttpOpenRequest failed"; return false; }
-	ScopeExit closeRequest{ [&]() { WinHttpCloseHandle(hRequest); } };
+	std::string openErr;
+	WinHttpHandle request = SharedHttpClient().OpenRequest(host, uc.nPort, path, uc.nScheme == INTERNET_SCHEME_HTTPS, &openErr);
+	if (!request) { outErr = Utf8ToWide(openErr); return false; }
+	HINTERNET hRequest = (HINTERNET)request.get();
 
 	if (!WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0)) { outErr = L"WinHttpSendRequest failed"; return false; }
 	if (!WinHttpReceiveResponse(hRequest, nullptr)) { outErr = L"WinHttpReceiveResponse failed"; return false; }
@@ -5318,18 +10429,17 @@ struct ManifestCheckResult
 	bool hasStoredBaseline = false;
 	bool manifestChanged = false;
 	std::string remoteSha256Lower;
+	std::shared_ptr<const ManifestData> manifest;   // parsed body; null if it did not validate
 	std::wstring err;
 };
 
-static unsigned __stdcall ManifestCheckThreadProc(void* p)
+static void CheckManifestForUpdates(ManifestCheckResult* res, const CancelToken& cancel)
 {
-	ManifestCheckResult* res = static_cast<ManifestCheckResult*>(p);
 	res->ok = false;
 	res->hasStoredBaseline = false;
 	res->manifestChanged = false;
 	res->err.clear();
 
-	CancelToken cancel{};
 	const std::string url = JoinUrl(kRemoteHost, kManifestPath);
 	std::string manifestText;
 	std::string dlErr;
@@ -5337,18 +10447,28 @@ static unsigned __stdcall ManifestCheckThreadProc(void* p)
 	if (!DownloadUrl(url, manifestText, cancel, &dlErr, &http))
 	{
 		res->err = L"Failed to download mappack_manifest.json: " + Utf8ToWide(dlErr);
-		return 0;
+		return;
 	}
 
 	std::string sha;
 	if (!Sha256StringHexLower(manifestText, sha))
 	{
 		res->err = L"Failed to calculate SHA-256 for mappack_manifest.json.";
-		return 0;
+		return;
 	}
 
 	res->remoteSha256Lower = sha;
 
+	// Kept for the next Sync (TakeStartupManifest); a manifest that does not validate is left to
+	// Sync to download again and report.
+	auto md = std::make_shared<ManifestData>();
+	md->manifestText = std::move(manifestText);
+	md->manifestSha256Lower = sha;
+	md->sourceNote = "startup check";
+	std::string parseErr;
+	if (ParseAndValidateManifest(md->manifestText, md->workList, md->arena, parseErr))
+		res->manifest = std::move(md);
+
 	std::wstring storedW = IniReadLastSyncedManifestSha256();
 	res->hasStoredBaseline = !storedW.empty();
 	if (!res->hasStoredBaseline)
@@ -5357,14 +10477,135 @@ static unsigned __stdcall ManifestCheckThreadProc(void* p)
 		std::wstring iniErr;
 		(void)IniWriteLastSyncedManifestInfo(res->remoteSha256Lower, &iniErr);
 		res->ok = true;
-		return 0;
+		return;
 	}
 
 	std::string stored = WideToUtf8(storedW);
 	res->manifestChanged = !EqualIcaseAscii(stored, res->remoteSha256Lower);
 	res->ok = true;
+}
+
+static unsigned __stdcall ManifestCheckThreadProc(void* p)
+{
+	CancelToken cancel{};
+	CheckManifestForUpdates(static_cast<ManifestCheckResult*>(p), cancel);
+	return 0;
+}
+// Runs beside the manifest check, so slow or dead mirrors never hold back its result.
+static unsigned __stdcall MirrorProbeThreadProc(void* p)
+{
+	AppState* st = static_cast<AppState*>(p);
+	RefreshMirrorHosts(CancelToken{ &st->mirrorProbeCancel });
+	return 0;
+}
+// WM_DESTROY: the probe stops within one WinHTTP wait and is joined, so it is never still inside
+// WinHTTP (or writing g_mirrors) while static destructors run.
+static void StopMirrorProbe(AppState* st)
+{
+	HANDLE h = st->hMirrorProbeThread;
+	st->hMirrorProbeThread = nullptr;
+	if (!h)
+		return;
+	st->mirrorProbeCancel.store(true);
+	WaitForSingleObject(h, INFINITE);
+	CloseHandle(h);
+}
+
+// --------------------------------------------------
+// Background prefetch (after the startup manifest check found a new manifest)
+// - Entries whose sha256 differs from what the last clean sync applied to the last used install
+//   (its hash index) are downloaded ahead of the Sync, one at a time, into
+//   <install>\MapPackSyncTool_partial\<sha256>.staged; see TakeStagedDownload.
+// - The thread runs in THREAD_MODE_BACKGROUND_BEGIN (idle I/O and memory priority). WinHTTP has
+//   no idle network priority, so it keeps to one connection and yields instead: Sync/Remove stop
+//   it (StopBackgroundPrefetch) before they start, and a partial file resumes in the Sync.
+// - Content the install already has at another path, unknown sizes, excluded paths and anything
+//   past kMaxPrefetchBytes are left to the Sync. Without a hash index nothing is prefetched.
+// - [Preferences] BackgroundPrefetch=0 turns it off.
+// --------------------------------------------------
+static void PrefetchChangedFiles(const SyncConfig& cfg, const ManifestData& md, const CancelToken& cancel)
+{
+	const std::wstring rootKey = NormalizeExclusionPathForCompare(cfg.localSyncRoot);
+	HashIndex index;
+	if (!LoadHashIndex(GetHashIndexPath(rootKey), rootKey, index) || index.manifestSha256 == md.manifestSha256Lower)
+		return;
+	std::unordered_set<std::string> haveShas;
+	for (const auto& kv : index.entries)
+		haveShas.insert(kv.second.sha256);
+
+	const fs::path partialDir = cfg.localBase / kPartialDownloadDirName;
+	EnsureMirrorHostsConfigured();
+	unsigned long long budget = AppConstants::kMaxPrefetchBytes;
+	for (const auto& entry : md.workList)
+	{
+		if (cancel.IsCanceled())
+			return;
+		const std::string sha = entry.Sha256Hex();
+		if (entry.size < 0 || (unsigned long long)entry.size > budget || haveShas.count(sha))
+			continue;
+		std::string rel(entry.relPath);
+		if (StartsWith(rel, "mappack/"))
+			rel = rel.substr(strlen("mappack/"));
+		if (IsPathExcluded(cfg.exclusions, MakeDestPath(cfg.localBase, rel)))
+			continue;
+		haveShas.insert(sha);   // once per content
+		budget -= (unsigned long long)entry.size;
+		std::error_code ec;
+		if (fs::exists(StagedDownloadPath(partialDir, sha), ec))
+			continue;
+		(void)DownloadFileFromMirrors(std::string(entry.remotePath), StagedDownloadPath(partialDir, sha), sha,
+			partialDir, entry.size, cancel, nullptr, nullptr);
+	}
+}
+struct PrefetchJob
+{
+	AppState* st = nullptr;
+	std::shared_ptr<const ManifestData> md;
+};
+static unsigned __stdcall PrefetchThreadProc(void* p)
+{
+	std::unique_ptr<PrefetchJob> job(static_cast<PrefetchJob*>(p));
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+	const PreflightResult pf = ValidateFolderSelection(IniReadLastFolder());
+	if (pf.ok)
+	{
+		CancelToken cancel{ &job->st->prefetchCancel };
+		PrefetchChangedFiles(MakeSyncConfig(pf), *job->md, cancel);
+	}
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
 	return 0;
 }
+// UI thread only; Sync/Remove cannot be running (they stop the prefetch first).
+static void StartBackgroundPrefetch(AppState* st, std::shared_ptr<const ManifestData> md)
+{
+	std::lock_guard<std::mutex> guard(st->startupManifestLock);
+	if (st->hPrefetchThread)
+		return;
+	st->prefetchCancel.store(false);
+	PrefetchJob* job = new PrefetchJob{ st, std::move(md) };
+	uintptr_t th = _beginthreadex(nullptr, 0, PrefetchThreadProc, job, 0, nullptr);
+	if (!th)
+	{
+		delete job;
+		return;
+	}
+	st->hPrefetchThread = reinterpret_cast<HANDLE>(th);
+}
+// Worker threads before a Sync/Remove, and WM_DESTROY: the prefetch stops within one download chunk.
+static void StopBackgroundPrefetch(AppState* st)
+{
+	HANDLE h = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(st->startupManifestLock);
+		h = st->hPrefetchThread;
+		st->hPrefetchThread = nullptr;
+	}
+	if (!h)
+		return;
+	st->prefetchCancel.store(true);
+	WaitForSingleObject(h, INFINITE);
+	CloseHandle(h);
+}
 
 static void StartManifestUpdateCheckOnStartup()
 {
@@ -5382,6 +10623,9 @@ static void StartManifestUpdateCheckOnStartup()
 	}
 	st->hManifestCheckThread = reinterpret_cast<HANDLE>(th);
 
+	st->mirrorProbeCancel.store(false);
+	st->hMirrorProbeThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, MirrorProbeThreadProc, st, 0, nullptr));
+
 	uintptr_t waiter = _beginthreadex(nullptr, 0, [](void* param)->unsigned {
 		auto* pair = static_cast<std::pair<AppState*, ManifestCheckResult*>*>(param);
 		WaitForSingleObject(pair->first->hManifestCheckThread, INFINITE);
@@ -5408,10 +10652,20 @@ static LRESULT HandleWmAppManifestCheckResult(AppState* st, HWND hwnd, LPARAM lP
 		}
 	}
 
+	if (st && res && res->ok && res->manifest)
+	{
+		std::lock_guard<std::mutex> guard(st->startupManifestLock);
+		st->startupManifest = res->manifest;
+		st->startupManifestTick = GetTickCount64();
+	}
+
 	// Startup manifest check is intentionally quiet on failure.
 	if (!res || !res->ok || !res->manifestChanged)
 		return 0;
 
+	if (st && res->manifest && !st->isRunning.load() && IniReadBackgroundPrefetch())
+		StartBackgroundPrefetch(st, res->manifest);
+
 	MessageBoxW(
 		hwnd,
 		L"A MapPack manifest update is available.\r\n\r\nClick Add / Sync button to check and apply MapPack updates.",
@@ -6504,8 +11758,8 @@ static LRESULT CALLBACK PreferencesWndProc(HWND hwnd, UINT msg, WPARAM wParam, L
 		ps->hWnd = hwnd;
 		HFONT uiFont = g_state ? g_state->hFontUI : nullptr;
 
-		HWND hLabel = CreateWindowW(L"STATIC", L"Excluded files and folders:", WS_CHILD | WS_VISIBLE,
-			10, 10, 560, 20, hwnd, nullptr, nullptr, nullptr);
+		HWND hLabel = CreateWindowW(L"STATIC", L"Excluded files and folders (a folder also excludes everything inside it, down to every subfolder):",
+			WS_CHILD | WS_VISIBLE, 10, 10, 910, 20, hwnd, nullptr, nullptr, nullptr);
 
 		ps->hList = CreateWindowExW(WS_EX_CLIENTEDGE, L"LISTBOX", nullptr,
 			WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL | LBS_NOTIFY,
@@ -6563,6 +11817,10 @@ struct PreferencesHubDialogState
 {
 	HWND hWnd = nullptr;
 	HWND hExclusions = nullptr;
+	HWND hFullVerify = nullptr;
+	HWND hHardLinks = nullptr;
+	HWND hPerfSummary = nullptr;
+	HWND hPrefetch = nullptr;
 	HWND hClose = nullptr;
 	HWND hTooltip = nullptr;
 	PreferencesHubAction requestedAction = PreferencesHubAction::None;
@@ -6588,6 +11846,34 @@ static LRESULT CALLBACK PreferencesHubWndProc(HWND hwnd, UINT msg, WPARAM wParam
 			20, 18, 130, 26,
 			hwnd, (HMENU)2001, ((LPCREATESTRUCTW)lParam)->hInstance, nullptr);
 
+		ps->hFullVerify = CreateWindowW(
+			L"BUTTON", L"Always fully verify files (ignore hash index)",
+			WS_CHILD | WS_VISIBLE | WS_TABSTOP | BS_AUTOCHECKBOX,
+			20, 60, 290, 22,
+			hwnd, (HMENU)2002, ((LPCREATESTRUCTW)lParam)->hInstance, nullptr);
+		SendMessageW(ps->hFullVerify, BM_SETCHECK, IniReadForceFullVerify() ? BST_CHECKED : BST_UNCHECKED, 0);
+
+		ps->hHardLinks = CreateWindowW(
+			L"BUTTON", L"Hard-link identical files instead of copying",
+			WS_CHILD | WS_VISIBLE | WS_TABSTOP | BS_AUTOCHECKBOX,
+			20, 88, 290, 22,
+			hwnd, (HMENU)2003, ((LPCREATESTRUCTW)lParam)->hInstance, nullptr);
+		SendMessageW(ps->hHardLinks, BM_SETCHECK, IniReadDedupHardLinks() ? BST_CHECKED : BST_UNCHECKED, 0);
+
+		ps->hPerfSummary = CreateWindowW(
+			L"BUTTON", L"Log a performance summary after Sync/Remove",
+			WS_CHILD | WS_VISIBLE | WS_TABSTOP | BS_AUTOCHECKBOX,
+			20, 116, 290, 22,
+			hwnd, (HMENU)2004, ((LPCREATESTRUCTW)lParam)->hInstance, nullptr);
+		SendMessageW(ps->hPerfSummary, BM_SETCHECK, IniReadPerfSummary() ? BST_CHECKED : BST_UNCHECKED, 0);
+
+		ps->hPrefetch = CreateWindowW(
+			L"BUTTON", L"Prefetch MapPack updates in the background",
+			WS_CHILD | WS_VISIBLE | WS_TABSTOP | BS_AUTOCHECKBOX,
+			20, 144, 290, 22,
+			hwnd, (HMENU)2005, ((LPCREATESTRUCTW)lParam)->hInstance, nullptr);
+		SendMessageW(ps->hPrefetch, BM_SETCHECK, IniReadBackgroundPrefetch() ? BST_CHECKED : BST_UNCHECKED, 0);
+
 		ps->hTooltip = CreateWindowExW(
 			WS_EX_TOPMOST, TOOLTIPS_CLASSW, nullptr,
 			WS_POPUP | TTS_NOPREFIX | TTS_ALWAYSTIP,
@@ -6598,17 +11884,25 @@ static LRESULT CALLBACK PreferencesHubWndProc(HWND hwnd, UINT msg, WPARAM wParam
 			SetWindowPos(ps->hTooltip, HWND_TOPMOST, 0, 0, 0, 0,
 				SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
 			AddTooltip(ps->hTooltip, ps->hExclusions, L"View or modify the list of files/folders excluded from syncing.");
+			AddTooltip(ps->hTooltip, ps->hFullVerify, L"Re-hash every local file on Add/Sync instead of trusting unchanged files from the last sync.");
+			AddTooltip(ps->hTooltip, ps->hHardLinks, L"Map pack paths with identical content share one file on disk (NTFS). Editing one such file changes them all.");
+			AddTooltip(ps->hTooltip, ps->hPerfSummary, L"Time per phase, bytes hashed/downloaded, HTTP request latency and connection reuse. Useful when reporting a slow sync.");
+			AddTooltip(ps->hTooltip, ps->hPrefetch, L"When a new manifest is found at startup, download the changed files for the last used folder at low priority, so Add/Sync mostly moves local files.");
 		}
 
 		ps->hClose = CreateWindowW(
 			L"BUTTON", L"Close",
 			WS_CHILD | WS_VISIBLE | BS_DEFPUSHBUTTON,
-			210, 112, 90, 26,
+			210, 188, 90, 26,
 			hwnd, (HMENU)IDCANCEL, ((LPCREATESTRUCTW)lParam)->hInstance, nullptr);
 
 		if (uiFont)
 		{
 			SendMessageW(ps->hExclusions, WM_SETFONT, (WPARAM)uiFont, TRUE);
+			SendMessageW(ps->hFullVerify, WM_SETFONT, (WPARAM)uiFont, TRUE);
+			SendMessageW(ps->hHardLinks, WM_SETFONT, (WPARAM)uiFont, TRUE);
+			SendMessageW(ps->hPerfSummary, WM_SETFONT, (WPARAM)uiFont, TRUE);
+			SendMessageW(ps->hPrefetch, WM_SETFONT, (WPARAM)uiFont, TRUE);
 			SendMessageW(ps->hClose, WM_SETFONT, (WPARAM)uiFont, TRUE);
 		}
 		return 0;
@@ -6620,6 +11914,54 @@ static LRESULT CALLBACK PreferencesHubWndProc(HWND hwnd, UINT msg, WPARAM wParam
 			if (ps) ps->requestedAction = PreferencesHubAction::OpenExclusions;
 			DestroyWindow(hwnd);
 			return 0;
+		case 2002:
+			if (HIWORD(wParam) == BN_CLICKED && ps && ps->hFullVerify)
+			{
+				const bool enabled = SendMessageW(ps->hFullVerify, BM_GETCHECK, 0, 0) == BST_CHECKED;
+				std::wstring err;
+				if (!IniWriteForceFullVerify(enabled, &err))
+				{
+					MessageBoxW(hwnd, err.c_str(), L"MapPack Sync Tool", MB_OK | MB_ICONERROR);
+					SendMessageW(ps->hFullVerify, BM_SETCHECK, enabled ? BST_UNCHECKED : BST_CHECKED, 0);
+				}
+			}
+			return 0;
+		case 2003:
+			if (HIWORD(wParam) == BN_CLICKED && ps && ps->hHardLinks)
+			{
+				const bool enabled = SendMessageW(ps->hHardLinks, BM_GETCHECK, 0, 0) == BST_CHECKED;
+				std::wstring err;
+				if (!IniWriteDedupHardLinks(enabled, &err))
+				{
+					MessageBoxW(hwnd, err.c_str(), L"MapPack Sync Tool", MB_OK | MB_ICONERROR);
+					SendMessageW(ps->hHardLinks, BM_SETCHECK, enabled ? BST_UNCHECKED : BST_CHECKED, 0);
+				}
+			}
+			return 0;
+		case 2004:
+			if (HIWORD(wParam) == BN_CLICKED && ps && ps->hPerfSummary)
+			{
+				const bool enabled = SendMessageW(ps->hPerfSummary, BM_GETCHECK, 0, 0) == BST_CHECKED;
+				std::wstring err;
+				if (!IniWritePerfSummary(enabled, &err))
+				{
+					MessageBoxW(hwnd, err.c_str(), L"MapPack Sync Tool", MB_OK | MB_ICONERROR);
+					SendMessageW(ps->hPerfSummary, BM_SETCHECK, enabled ? BST_UNCHECKED : BST_CHECKED, 0);
+				}
+			}
+			return 0;
+		case 2005:
+			if (HIWORD(wParam) == BN_CLICKED && ps && ps->hPrefetch)
+			{
+				const bool enabled = SendMessageW(ps->hPrefetch, BM_GETCHECK, 0, 0) == BST_CHECKED;
+				std::wstring err;
+				if (!IniWriteBackgroundPrefetch(enabled, &err))
+				{
+					MessageBoxW(hwnd, err.c_str(), L"MapPack Sync Tool", MB_OK | MB_ICONERROR);
+					SendMessageW(ps->hPrefetch, BM_SETCHECK, enabled ? BST_UNCHECKED : BST_CHECKED, 0);
+				}
+			}
+			return 0;
 		case IDCANCEL:
 			DestroyWindow(hwnd);
 			return 0;
@@ -6654,7 +11996,7 @@ static void ShowPreferencesDialog(HWND owner)
 		L"MapPackSyncToolPreferencesHubWindow",
 		L"Preferences",
 		WS_CAPTION | WS_SYSMENU | WS_VISIBLE,
-		CW_USEDEFAULT, CW_USEDEFAULT, 340, 190,
+		CW_USEDEFAULT, CW_USEDEFAULT, 340, 266,
 		owner, nullptr, hInst, &ps);
 	if (!hwnd) return;
 
@@ -6951,6 +12293,9 @@ static LRESULT HandleWmDestroy(AppState* st, HWND hwnd)
 
 	if (st)
 	{
+		StopBackgroundPrefetch(st);   // joined, so it cannot touch the install (or st) during exit
+		StopMirrorProbe(st);
+		FlushPendingLog(st);          // a wake-up lost near shutdown; the output box still exists here
 		if (st->hTooltip) { DestroyWindow(st->hTooltip); st->hTooltip = nullptr; }
 		if (st->hFontUI) { DeleteObject(st->hFontUI); st->hFontUI = nullptr; }
 		if (st->hFontMono) { DeleteObject(st->hFontMono); st->hFontMono = nullptr; }
@@ -6969,10 +12314,14 @@ static LRESULT HandleWmAppUiEvent(HWND hwnd, LPARAM lParam)
 	AppState* st2 = (AppState*)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
 	if (!st2) st2 = g_state;
 
+	// Queued log lines were logged before this event was posted; render them first.
+	if (ev->kind != UiEventKind::LogAppendW)
+		FlushPendingLog(st2);
+
 	switch (ev->kind)
 	{
 	case UiEventKind::LogAppendW:
-		AppendToOutputW(st2, ev->text);
+		ScheduleLogFlush(st2, hwnd);
 		break;
 	case UiEventKind::ProgressMarqueeOn:
 		if (GateProgressUpdate(st2))
@@ -7034,6 +12383,9 @@ static LRESULT HandleWmAppUiEvent(HWND hwnd, LPARAM lParam)
 		ApplyProgressUpdate(st2, u);
 	}
 	break;
+	case UiEventKind::ProgressPollStart:
+		SetTimer(hwnd, kProgressPollTimerId, kProgressPollIntervalMs, nullptr);
+		break;
 	case UiEventKind::WorkerDone:
 		if (st2)
 		{
@@ -7063,6 +12415,18 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	{
 	case WM_APP_UI_EVENT:
 		return HandleWmAppUiEvent(hwnd, lParam);
+	case WM_TIMER:
+		if (wParam == kLogFlushTimerId)
+		{
+			FlushPendingLog(st);
+			return 0;
+		}
+		if (wParam == kProgressPollTimerId)
+		{
+			ProgressReporterPoll(st, hwnd);
+			return 0;
+		}
+		break;
 	case WM_SIZE:
 		return HandleWmSize(hwnd, wParam, lParam);
 	case WM_GETMINMAXINFO:
@@ -7077,13 +12441,397 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 // --------------------------------------------------
+// Headless batch sync: MapPackSyncTool.exe /sync <folder>... [/quiet] [/json-report <file>]
+// - No window, terms dialog, startup support-file refresh or single-instance mutex; meant for
+//   deploying many installs from a script. The terms must already be accepted (same INI as
+//   the GUI). Do not point the GUI and a batch at the same folder at the same time.
+// - The manifest is downloaded and verified once (delta chain as usual) while the mirror hosts
+//   are probed, so batch startup costs about one round-trip. Then up to
+//   kMaxHeadlessSyncFolders installs sync concurrently against that same ManifestData.
+// - Each folder logs into its own LogCapture; the blocks are printed in argument order as the
+//   folders finish (stdout when redirected, otherwise the parent console), unless /quiet.
+// - Each folder also has its own ProgressReporter and PerfStats (t_progress / t_perf), so the
+//   concurrent runs never reset or mix each other's counters; with PerfSummary=1 every block
+//   ends with that folder's summary. Progress text has no window to go to and is dropped.
+// - /json-report writes every folder's SyncCounters and status, plus the batch exit code.
+// - This is a GUI-subsystem exe: from cmd.exe use "start /wait" to see %ERRORLEVEL%.
+// --------------------------------------------------
+namespace HeadlessExit
+{
+	static constexpr int kOk = 0;
+	static constexpr int kFilesFailed = 1;        // some files could not be synced
+	static constexpr int kUsage = 2;
+	static constexpr int kManifestFailed = 3;     // nothing was synced
+	static constexpr int kFolderInvalid = 4;      // a folder failed validation; the others synced
+	static constexpr int kCanceled = 5;           // Ctrl+C / Ctrl+Break / console closed
+	static constexpr int kTermsNotAccepted = 6;
+	static constexpr int kReportFailed = 7;       // synced fine, but the JSON report was not written
+}
+static constexpr size_t kMaxHeadlessSyncFolders = 4;   // each folder already runs its own download pool
+struct HeadlessOutput
+{
+	std::mutex lock;
+	HANDLE handle = nullptr;
+	bool console = false;   // WriteConsoleW; otherwise UTF-8 bytes to a pipe or file
+	bool quiet = false;
+};
+static HeadlessOutput g_headlessOut;
+static std::atomic_bool g_headlessCancel{ false };
+static void HeadlessOutputInit(bool quiet)
+{
+	g_headlessOut.quiet = quiet;
+	if (quiet) return;
+	HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (!h || h == INVALID_HANDLE_VALUE)
+	{
+		// GUI subsystem: there is no stdout unless it was redirected, so borrow the caller's console.
+		h = nullptr;
+		if (AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			h = CreateFileW(L"CONOUT$", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+			if (h == INVALID_HANDLE_VALUE) h = nullptr;
+		}
+	}
+	DWORD mode = 0;
+	g_headlessOut.handle = h;
+	g_headlessOut.console = h && GetConsoleMode(h, &mode);
+}
+static void HeadlessWrite(const std::string& textUtf8)
+{
+	if (g_headlessOut.quiet || !g_headlessOut.handle || textUtf8.empty()) return;
+	std::lock_guard<std::mutex> guard(g_headlessOut.lock);
+	DWORD wrote = 0;
+	if (g_headlessOut.console)
+	{
+		// Older consoles reject very large single writes.
+		const std::wstring w = Utf8ToWide(textUtf8);
+		for (size_t off = 0; off < w.size(); off += 16384)
+			WriteConsoleW(g_headlessOut.handle, w.data() + off, (DWORD)(std::min)(w.size() - off, (size_t)16384), &wrote, nullptr);
+	}
+	else
+		WriteFile(g_headlessOut.handle, textUtf8.data(), (DWORD)textUtf8.size(), &wrote, nullptr);
+}
+static BOOL WINAPI HeadlessConsoleCtrlHandler(DWORD)
+{
+	g_headlessCancel.store(true);
+	return TRUE;   // workers notice the cancel token and wind down; wWinMain returns kCanceled
+}
+static bool IsHeadlessSwitch(const wchar_t* arg, const wchar_t* name)
+{
+	if (arg[0] == L'/') return _wcsicmp(arg + 1, name) == 0;
+	if (arg[0] == L'-' && arg[1] == L'-') return _wcsicmp(arg + 2, name) == 0;
+	return false;
+}
+static bool IsHeadlessSyncCommandLine(int argc, wchar_t** argv)
+{
+	return argv && argc >= 2 && IsHeadlessSwitch(argv[1], L"sync");
+}
+struct HeadlessFolder
+{
+	std::wstring input;          // as given on the command line
+	SyncConfig cfg;              // valid when runnable
+	bool runnable = false;
+	const char* status = "pending";   // ok | failed | canceled | invalid | skipped
+	std::string error;
+	SyncCounters counts;
+	LogCapture log;
+	ProgressReporter progress;   // this folder's run only; nothing polls it
+	PerfStats perf;
+	ULONGLONG elapsedMs = 0;
+	std::atomic<bool> done{ false };
+};
+struct HeadlessBatch
+{
+	std::vector<std::unique_ptr<HeadlessFolder>> folders;
+	std::vector<size_t> runnable;   // indexes into folders
+	std::atomic<size_t> nextRunnable{ 0 };
+	const ManifestData* md = nullptr;
+	CancelToken cancel;
+	std::mutex emitLock;
+	size_t emitCursor = 0;          // first folder whose log block has not been printed
+};
+// Prints every finished folder block that is next in argument order.
+static void HeadlessEmitFinished(HeadlessBatch& batch)
+{
+	std::lock_guard<std::mutex> guard(batch.emitLock);
+	while (batch.emitCursor < batch.folders.size() && batch.folders[batch.emitCursor]->done.load())
+	{
+		const size_t i = batch.emitCursor++;
+		HeadlessFolder& f = *batch.folders[i];
+		std::string block = "\r\n==== [" + std::to_string(i + 1) + "/" + std::to_string(batch.folders.size()) + "] "
+			+ WideToUtf8(f.input) + " ====\r\n";
+		{
+			std::lock_guard<std::mutex> logGuard(f.log.lock);
+			block += f.log.text;
+		}
+		if (block.size() < 2 || block.compare(block.size() - 2, 2, "\r\n") != 0)
+			block += "\r\n";
+		HeadlessWrite(block);
+	}
+}
+static void HeadlessRunFolder(HeadlessBatch& batch, HeadlessFolder& f)
+{
+	const ULONGLONG start = GetTickCount64();
+	t_logCapture = &f.log;
+	t_progress = &f.progress;
+	t_perf = &f.perf;
+	PerfRunBegin();
+	SyncInstallWithManifest(f.cfg, *batch.md, f.counts, batch.cancel);
+	if (IniReadPerfSummary())
+		PerfLogSummary();
+	t_perf = &g_perf;
+	t_progress = &g_progress;
+	t_logCapture = nullptr;
+	f.elapsedMs = GetTickCount64() - start;
+	if (batch.cancel.IsCanceled())
+		f.status = "canceled";
+	else if (f.counts.failed.load() > 0)
+		f.status = "failed";
+	else
+		f.status = "ok";
+	f.done.store(true);
+	HeadlessEmitFinished(batch);
+}
+static unsigned __stdcall HeadlessFolderThreadProc(void* param)
+{
+	HeadlessBatch& batch = *static_cast<HeadlessBatch*>(param);
+	for (;;)
+	{
+		const size_t k = batch.nextRunnable.fetch_add(1);
+		if (k >= batch.runnable.size()) return 0;
+		HeadlessRunFolder(batch, *batch.folders[batch.runnable[k]]);
+	}
+}
+// Validates one command-line folder the way the GUI does, minus the elevation prompt.
+static void HeadlessPrepareFolder(HeadlessFolder& f, std::unordered_set<std::wstring>& seenRoots)
+{
+	auto reject = [&f](const std::string& err) {
+		f.status = "invalid";
+		f.error = err;
+		f.log.text += err;
+		f.done.store(true);
+	};
+	std::wstring folderWs = f.input;
+	TrimInPlace(folderWs);
+	StripSurroundingQuotes(folderWs);
+	const PreflightResult pf = ValidateFolderSelection(folderWs);
+	if (!pf.ok)
+	{
+		std::string err;
+		for (const auto& line : pf.errors)
+			err += line;
+		reject(err);
+		return;
+	}
+	if (!seenRoots.insert(NormalizeExclusionPathForCompare(pf.localSyncRoot)).second)
+	{
+		reject("ERROR: Folder is listed more than once in this batch.\r\n");
+		return;
+	}
+	std::wstring writeErr;
+	if (!CanWriteToSelectedMappackFolderTree(pf.localBase, &writeErr) || !CanWriteToSelectedClientPrefsFolder(pf.localBase, &writeErr))
+	{
+		reject("ERROR: Folder is not writable (run the batch elevated?): " + WideToUtf8(writeErr) + "\r\n");
+		return;
+	}
+	f.cfg = MakeSyncConfig(pf);
+	f.runnable = true;
+}
+static std::string HeadlessJsonString(const std::string& s)
+{
+	std::string out = "\"";
+	AppendManifestJsonEscaped(out, s);
+	out += '"';
+	return out;
+}
+static bool WriteHeadlessJsonReport(const fs::path& path, const HeadlessBatch& batch, int exitCode, ULONGLONG elapsedMs)
+{
+	std::string json;
+	json += "{\n";
+	json += "  \"exitCode\": " + std::to_string(exitCode) + ",\n";
+	json += "  \"elapsedMs\": " + std::to_string(elapsedMs) + ",\n";
+	json += "  \"manifestSha256\": " + HeadlessJsonString(batch.md ? batch.md->manifestSha256Lower : std::string()) + ",\n";
+	json += "  \"manifestFiles\": " + std::to_string(batch.md ? batch.md->workList.size() : 0) + ",\n";
+	json += "  \"folders\": [";
+	for (size_t i = 0; i < batch.folders.size(); ++i)
+	{
+		const HeadlessFolder& f = *batch.folders[i];
+		const SyncCounters& c = f.counts;
+		std::string err = f.error;
+		while (!err.empty() && (err.back() == '\n' || err.back() == '\r'))
+			err.pop_back();
+		json += i ? ",\n" : "\n";
+		json += "    {\n";
+		json += "      \"folder\": " + HeadlessJsonString(WideToUtf8(f.input)) + ",\n";
+		json += "      \"status\": " + HeadlessJsonString(f.status) + ",\n";
+		json += "      \"error\": " + HeadlessJsonString(err) + ",\n";
+		json += "      \"elapsedMs\": " + std::to_string(f.elapsedMs) + ",\n";
+		json += "      \"downloaded\": " + std::to_string(c.downloaded.load()) + ",\n";
+		json += "      \"updated\": " + std::to_string(c.updated.load()) + ",\n";
+		json += "      \"unchanged\": " + std::to_string(c.unchanged.load()) + ",\n";
+		json += "      \"failed\": " + std::to_string(c.failed.load()) + ",\n";
+		json += "      \"deleted\": " + std::to_string(c.deleted.load()) + ",\n";
+		json += "      \"skippedExcluded\": " + std::to_string(c.skippedExcluded.load()) + ",\n";
+		json += "      \"hashIndexHits\": " + std::to_string(c.hashIndexHits.load()) + ",\n";
+		json += "      \"sizeMismatches\": " + std::to_string(c.sizeMismatches.load()) + ",\n";
+		json += "      \"localCopies\": " + std::to_string(c.localCopies.load()) + ",\n";
+		json += "      \"packedFiles\": " + std::to_string(c.packedFiles.load()) + ",\n";
+		json += "      \"manifestDiffSkips\": " + std::to_string(c.manifestDiffSkips.load()) + "\n";
+		json += "    }";
+	}
+	json += batch.folders.empty() ? "]\n" : "\n  ]\n";
+	json += "}\n";
+	return HttpCacheWriteFileAtomic(path, json);
+}
+static int RunHeadlessSync(int argc, wchar_t** argv)
+{
+	const ULONGLONG batchStart = GetTickCount64();
+	bool quiet = false;
+	bool usageError = false;
+	std::wstring reportPath;
+	std::vector<std::wstring> folderArgs;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (IsHeadlessSwitch(argv[i], L"quiet"))
+			quiet = true;
+		else if (IsHeadlessSwitch(argv[i], L"json-report"))
+		{
+			if (i + 1 >= argc) { usageError = true; break; }
+			reportPath = argv[++i];
+		}
+		else if (argv[i][0] == L'/' || (argv[i][0] == L'-' && argv[i][1] == L'-'))
+			usageError = true;
+		else
+			folderArgs.push_back(argv[i]);
+	}
+	HeadlessOutputInit(quiet);
+	if (usageError || folderArgs.empty())
+	{
+		HeadlessWrite("Usage: MapPackSyncTool.exe /sync <Istaria folder> [<Istaria folder>...] [/quiet] [/json-report <file>]\r\n"
+			"Exit codes: 0 ok, 1 some files failed, 2 usage, 3 manifest failed, 4 invalid folder, 5 canceled,\r\n"
+			"            6 terms not accepted, 7 report not written.\r\n");
+		return HeadlessExit::kUsage;
+	}
+	if (!HasAcceptedCurrentTerms())
+	{
+		HeadlessWrite("ERROR: The MapPackSyncTool Terms of Use have not been accepted. Run MapPackSyncTool once without /sync and accept them.\r\n");
+		return HeadlessExit::kTermsNotAccepted;
+	}
+	SetConsoleCtrlHandler(&HeadlessConsoleCtrlHandler, TRUE);
+
+	PerfRunBegin();
+	HeadlessBatch batch;
+	batch.cancel = CancelToken{ &g_headlessCancel };
+	std::unordered_set<std::wstring> seenRoots;
+	for (const auto& arg : folderArgs)
+	{
+		batch.folders.push_back(std::make_unique<HeadlessFolder>());
+		HeadlessFolder& f = *batch.folders.back();
+		f.input = arg;
+		HeadlessPrepareFolder(f, seenRoots);
+		if (f.runnable)
+			batch.runnable.push_back(batch.folders.size() - 1);
+	}
+
+	ManifestData md;
+	bool manifestOk = false;
+	if (!batch.runnable.empty())
+	{
+		// The mirror probe overlaps the manifest download instead of adding round-trips after it.
+		unique_handle probe(reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, [](void* param)->unsigned {
+			RefreshMirrorHosts(*static_cast<const CancelToken*>(param));
+			return 0;
+			}, &batch.cancel, 0, nullptr)));
+		LogCapture batchLog;
+		t_logCapture = &batchLog;
+		manifestOk = DownloadManifestForSync(batch.folders[batch.runnable.front()]->cfg, md, batch.cancel);
+		t_logCapture = nullptr;
+		HeadlessWrite(batchLog.text + (batchLog.text.empty() || batchLog.text.back() == '\n' ? "" : "\r\n"));
+		if (probe)
+			WaitForSingleObject(probe.get(), INFINITE);
+		else
+			RefreshMirrorHosts(batch.cancel);
+	}
+	if (manifestOk)
+	{
+		batch.md = &md;
+		const size_t width = (std::min)(batch.runnable.size(), kMaxHeadlessSyncFolders);
+		std::vector<unique_handle> workers;
+		std::vector<HANDLE> waitHandles;
+		for (size_t w = 0; w < width; ++w)
+		{
+			unique_handle th(reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, &HeadlessFolderThreadProc, &batch, 0, nullptr)));
+			if (!th)
+				break;
+			waitHandles.push_back(th.get());
+			workers.push_back(std::move(th));
+		}
+		if (workers.empty())
+			HeadlessFolderThreadProc(&batch);
+		else
+			WaitForMultipleObjects((DWORD)waitHandles.size(), waitHandles.data(), TRUE, INFINITE);
+	}
+	else
+	{
+		for (size_t k : batch.runnable)
+		{
+			HeadlessFolder& f = *batch.folders[k];
+			f.status = batch.cancel.IsCanceled() ? "canceled" : "skipped";
+			f.error = "Manifest download failed; nothing was synced.";
+			f.done.store(true);
+		}
+	}
+	HeadlessEmitFinished(batch);
+
+	bool anyInvalid = false, anyFailed = false;
+	std::string summary = "\r\nBatch summary:\r\n";
+	for (const auto& fp : batch.folders)
+	{
+		const HeadlessFolder& f = *fp;
+		anyInvalid = anyInvalid || !f.runnable;
+		anyFailed = anyFailed || f.counts.failed.load() > 0;
+		summary += "  " + WideToUtf8(f.input) + ":  " + f.status;
+		if (f.runnable && manifestOk)
+			summary += " (downloaded " + std::to_string(f.counts.downloaded.load()) + ", updated " + std::to_string(f.counts.updated.load())
+				+ ", deleted " + std::to_string(f.counts.deleted.load()) + ", failed " + std::to_string(f.counts.failed.load()) + ")";
+		summary += "\r\n";
+	}
+	HeadlessWrite(summary);
+	if (IniReadPerfSummary() && manifestOk)
+	{
+		// The batch's own work (manifest download, mirror probe); each folder block has its own.
+		LogCapture perfLog;
+		t_logCapture = &perfLog;
+		PerfLogSummary();
+		t_logCapture = nullptr;
+		HeadlessWrite(perfLog.text);
+	}
+
+	int rc = HeadlessExit::kOk;
+	if (batch.cancel.IsCanceled()) rc = HeadlessExit::kCanceled;
+	else if (!batch.runnable.empty() && !manifestOk) rc = HeadlessExit::kManifestFailed;
+	else if (anyInvalid) rc = HeadlessExit::kFolderInvalid;
+	else if (anyFailed) rc = HeadlessExit::kFilesFailed;
+
+	if (!reportPath.empty() && !WriteHeadlessJsonReport(fs::path(reportPath), batch, rc, GetTickCount64() - batchStart))
+	{
+		HeadlessWrite("ERROR: Failed to write JSON report: " + WideToUtf8(reportPath) + "\r\n");
+		if (rc == HeadlessExit::kOk) rc = HeadlessExit::kReportFailed;
+	}
+	return rc;
+}
+// --------------------------------------------------
 // WinMain
+// - MAPPACKSYNCTOOL_NO_WINMAIN: MapPackSyncBench compiles this file into its own console exe.
 // --------------------------------------------------
+#ifndef MAPPACKSYNCTOOL_NO_WINMAIN
 int WINAPI wWinMain(_In_ HINSTANCE hInst, _In_opt_ HINSTANCE, _In_ PWSTR, _In_ int)
 {
 	static AppState state;
 	g_state = &state;
 	state.uiThreadId = GetCurrentThreadId();
+	TraceLoggingRegister(g_perfProvider);
+	ScopeExit perfProviderGuard{ []() { TraceLoggingUnregister(g_perfProvider); } };
 	// Helper mode: apply an update after the main process exits.
 	int argc = 0;
 	wchar_t** argv = CommandLineToArgvW(GetCommandLineW(), &argc);
@@ -7093,6 +12841,13 @@ int WINAPI wWinMain(_In_ HINSTANCE hInst, _In_opt_ HINSTANCE, _In_ PWSTR, _In_ i
 		LocalFree(argv);
 		return rc;
 	}
+	// Headless batch sync: no window at all (see "Headless batch sync").
+	if (IsHeadlessSyncCommandLine(argc, argv))
+	{
+		int rc = RunHeadlessSync(argc, argv);
+		LocalFree(argv);
+		return rc;
+	}
 	if (argv && argc >= 2 && _wcsicmp(argv[1], L"--accept-terms") == 0)
 	{
 		// No extra setup needed; startup will prompt for terms and write the INI again.
@@ -7412,3 +13167,4 @@ int WINAPI wWinMain(_In_ HINSTANCE hInst, _In_opt_ HINSTANCE, _In_ PWSTR, _In_ i
 	ReleaseSingleInstanceMutex();
 	return 0;
 }
+#endif // MAPPACKSYNCTOOL_NO_WINMAIN
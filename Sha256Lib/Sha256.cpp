@@ -0,0 +1,289 @@
+// Sha256.cpp
+// Implementation of Sha256.h (see the notes there).
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <bcrypt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "Sha256.h"
+
+#pragma comment(lib, "bcrypt.lib")
+
+#ifndef BCRYPT_HASH_REUSABLE_FLAG
+#define BCRYPT_HASH_REUSABLE_FLAG 0x00000020
+#endif
+
+namespace sha256lib
+{
+    namespace
+    {
+        const unsigned long long kMapThresholdBytes = 4ull * 1024ull * 1024ull;
+        const unsigned long long kMapViewBytes = 16ull * 1024ull * 1024ull;   // multiple of allocation granularity
+        const DWORD kReadChunkBytes = 1u * 1024u * 1024u;
+
+        struct Provider
+        {
+            BCRYPT_ALG_HANDLE alg = nullptr;
+            DWORD objLen = 0;
+            bool reusable = false;
+        };
+
+        // Opened once and never closed: worker threads may still be hashing while statics are
+        // torn down, and process exit releases the handle anyway.
+        const Provider& GetProvider()
+        {
+            static const Provider provider = []() {
+                Provider p;
+                if (BCryptOpenAlgorithmProvider(&p.alg, BCRYPT_SHA256_ALGORITHM, nullptr, BCRYPT_HASH_REUSABLE_FLAG) == 0)
+                    p.reusable = true;
+                else if (BCryptOpenAlgorithmProvider(&p.alg, BCRYPT_SHA256_ALGORITHM, nullptr, 0) != 0)
+                    p.alg = nullptr;
+
+                DWORD hashLen = 0, cbData = 0;
+                if (p.alg
+                    && (BCryptGetProperty(p.alg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&p.objLen, sizeof(p.objLen), &cbData, 0) != 0
+                        || BCryptGetProperty(p.alg, BCRYPT_HASH_LENGTH, (PUCHAR)&hashLen, sizeof(hashLen), &cbData, 0) != 0
+                        || hashLen != kDigestBytes))
+                {
+                    BCryptCloseAlgorithmProvider(p.alg, 0);
+                    p.alg = nullptr;
+                }
+                return p;
+            }();
+            return provider;
+        }
+
+        std::vector<char>& ThreadReadBuffer()
+        {
+            static thread_local std::vector<char> buf(kReadChunkBytes);
+            return buf;
+        }
+
+        // Kept free of C++ objects so SEH can be used: a read error inside a mapped view
+        // surfaces as EXCEPTION_IN_PAGE_ERROR rather than a failed ReadFile.
+        NTSTATUS HashMappedViewSeh(BCRYPT_HASH_HANDLE hHash, const UCHAR* data, ULONG size)
+        {
+            __try
+            {
+                return BCryptHashData(hHash, (PUCHAR)data, size, 0);
+            }
+            __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+            {
+                return (NTSTATUS)0xC0000006L; // STATUS_IN_PAGE_ERROR
+            }
+        }
+
+        bool HashByRead(BCRYPT_HASH_HANDLE hHash, HANDLE hFile, unsigned long long bytes)
+        {
+            std::vector<char>& buf = ThreadReadBuffer();
+            while (bytes > 0)
+            {
+                const DWORD want = (DWORD)(std::min)(bytes, (unsigned long long)buf.size());
+                DWORD got = 0;
+                if (!ReadFile(hFile, buf.data(), want, &got, nullptr) || got != want)
+                    return false;
+                if (BCryptHashData(hHash, (PUCHAR)buf.data(), got, 0) != 0)
+                    return false;
+                bytes -= got;
+            }
+            return true;
+        }
+
+        bool HashByMapping(BCRYPT_HASH_HANDLE hHash, HANDLE hFile, unsigned long long bytes)
+        {
+            HANDLE mapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+                return HashByRead(hHash, hFile, bytes);   // some redirectors/filesystems refuse mappings
+
+            bool ok = true;
+            for (unsigned long long off = 0; ok && off < bytes; off += kMapViewBytes)
+            {
+                const SIZE_T viewSize = (SIZE_T)(std::min)(kMapViewBytes, bytes - off);
+                const void* view = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(off >> 32), (DWORD)(off & 0xFFFFFFFFull), viewSize);
+                if (!view)
+                {
+                    ok = false;
+                    break;
+                }
+                ok = HashMappedViewSeh(hHash, (const UCHAR*)view, (ULONG)viewSize) == 0;
+                UnmapViewOfFile(view);
+            }
+            CloseHandle(mapping);
+            return ok;
+        }
+    }
+
+    Hasher::Hasher() : hash_(nullptr), fed_(false)
+    {
+    }
+
+    Hasher::~Hasher()
+    {
+        Destroy();
+    }
+
+    void Hasher::Destroy()
+    {
+        if (hash_)
+            BCryptDestroyHash((BCRYPT_HASH_HANDLE)hash_);
+        hash_ = nullptr;
+        fed_ = false;
+    }
+
+    bool Hasher::Begin()
+    {
+        const Provider& p = GetProvider();
+        if (!p.alg)
+            return false;
+        if (hash_ && p.reusable && !fed_)
+            return true;   // already reset by the previous BCryptFinishHash
+
+        // A partially fed reusable object cannot be reset; drop it and recreate.
+        Destroy();
+        obj_.resize(p.objLen);
+        BCRYPT_HASH_HANDLE raw = nullptr;
+        if (BCryptCreateHash(p.alg, &raw, obj_.data(), (ULONG)obj_.size(), nullptr, 0, p.reusable ? BCRYPT_HASH_REUSABLE_FLAG : 0) != 0)
+            return false;
+        hash_ = raw;
+        return true;
+    }
+
+    bool Hasher::Update(const void* data, size_t size)
+    {
+        if (!hash_ || (!data && size != 0))
+            return false;
+        fed_ = true;
+        const UCHAR* bytes = static_cast<const UCHAR*>(data);
+        while (size > 0)
+        {
+            const ULONG chunk = (ULONG)(std::min)(size, (size_t)kReadChunkBytes);
+            if (BCryptHashData((BCRYPT_HASH_HANDLE)hash_, const_cast<PUCHAR>(bytes), chunk, 0) != 0)
+                return false;
+            bytes += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    bool Hasher::UpdateFile(const std::wstring& path, unsigned long long bytes)
+    {
+        if (!hash_)
+            return false;
+        HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (h == INVALID_HANDLE_VALUE)
+            return false;
+
+        bool ok = false;
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(h, &size))
+        {
+            const unsigned long long have = (unsigned long long)size.QuadPart;
+            if (bytes == kWholeFile)
+                bytes = have;
+            if (bytes <= have)
+            {
+                fed_ = true;
+                ok = (bytes >= kMapThresholdBytes)
+                    ? HashByMapping((BCRYPT_HASH_HANDLE)hash_, h, bytes)
+                    : HashByRead((BCRYPT_HASH_HANDLE)hash_, h, bytes);
+            }
+        }
+        CloseHandle(h);
+        return ok;
+    }
+
+    bool Hasher::Finish(unsigned char digest[kDigestBytes])
+    {
+        if (!hash_)
+            return false;
+        const NTSTATUS st = BCryptFinishHash((BCRYPT_HASH_HANDLE)hash_, digest, (ULONG)kDigestBytes, 0);
+        fed_ = false;
+        if (st != 0 || !GetProvider().reusable)
+            Destroy();
+        return st == 0;
+    }
+
+    bool Hasher::FinishHex(std::string& outHexLower)
+    {
+        outHexLower.clear();
+        unsigned char digest[kDigestBytes] = {};
+        if (!Finish(digest))
+            return false;
+        outHexLower = ToHexLower(digest, sizeof(digest));
+        return true;
+    }
+
+    std::string ToHexLower(const unsigned char* data, size_t size)
+    {
+        static const char* hexd = "0123456789abcdef";
+        std::string out(size * 2, '0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            out[i * 2 + 0] = hexd[(data[i] >> 4) & 0xF];
+            out[i * 2 + 1] = hexd[data[i] & 0xF];
+        }
+        return out;
+    }
+
+    static Hasher& ThreadHasher()
+    {
+        static thread_local Hasher hasher;
+        return hasher;
+    }
+
+    bool HashBytesHex(const void* data, size_t size, std::string& outHexLower)
+    {
+        outHexLower.clear();
+        Hasher& h = ThreadHasher();
+        return h.Begin() && h.Update(data, size) && h.FinishHex(outHexLower);
+    }
+
+    bool HashFileHex(const std::wstring& path, std::string& outHexLower)
+    {
+        outHexLower.clear();
+        Hasher& h = ThreadHasher();
+        return h.Begin() && h.UpdateFile(path) && h.FinishHex(outHexLower);
+    }
+
+    size_t HashFilesHex(std::vector<FileJob>& jobs, unsigned threadCount, bool stopOnFailure)
+    {
+        for (auto& job : jobs)
+        {
+            job.hexLower.clear();
+            job.ok = false;
+        }
+        if (threadCount == 0)
+            threadCount = std::thread::hardware_concurrency();
+        threadCount = (std::max)(1u, (unsigned)(std::min)((size_t)threadCount, jobs.size()));
+
+        std::atomic<size_t> next(0);
+        std::atomic<size_t> failures(0);
+        auto run = [&]() {
+            for (;;)
+            {
+                if (stopOnFailure && failures.load() != 0)
+                    return;
+                const size_t i = next.fetch_add(1);
+                if (i >= jobs.size())
+                    return;
+                jobs[i].ok = HashFileHex(jobs[i].path, jobs[i].hexLower);
+                if (!jobs[i].ok)
+                    failures.fetch_add(1);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threadCount; ++t)
+            workers.emplace_back(run);
+        run();
+        for (auto& w : workers)
+            w.join();
+        return failures.load();
+    }
+}
@@ -0,0 +1,68 @@
+// Sha256.h
+// Shared SHA-256 (Windows CNG / BCrypt) hashing for every tool in MapPackSyncTool.sln:
+// MapPackSyncTool, ManifestSha256, ManifestOld and HashVersionWriter link Sha256Lib.lib.
+//
+// Notes:
+// - One SHA-256 provider per process, opened on first use and shared by all threads (CNG
+//   algorithm handles are thread-safe). It asks for BCRYPT_HASH_REUSABLE_FLAG (Windows 8+) so
+//   a finished hash object resets itself for the next message; Vista/7 reject the flag and the
+//   (cheap) hash object is recreated per message instead.
+// - A Hasher owns one hash object and is reused across messages; it is NOT thread-safe, use one
+//   per thread. The file helpers below keep one per thread internally.
+// - Files >= 4 MB are memory-mapped and hashed view by view; smaller files use a
+//   sequential-scan ReadFile loop into a per-thread 1 MB buffer.
+// - C++11 header (HashVersionWriter and ManifestOld do not build as C++17); no Windows headers pulled in.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sha256lib
+{
+    const size_t kDigestBytes = 32;
+    const unsigned long long kWholeFile = ~0ull;
+
+    // Streaming hasher: Begin, any number of Update/UpdateFile calls, then Finish.
+    class Hasher
+    {
+    public:
+        Hasher();
+        ~Hasher();
+        Hasher(const Hasher&) = delete;
+        Hasher& operator=(const Hasher&) = delete;
+
+        // Starts a new message, discarding any unfinished one.
+        bool Begin();
+        bool Update(const void* data, size_t size);
+        // Feeds the first `bytes` of a file (kWholeFile = all of it). False on a short file or read error.
+        bool UpdateFile(const std::wstring& path, unsigned long long bytes = kWholeFile);
+        bool Finish(unsigned char digest[kDigestBytes]);
+        bool FinishHex(std::string& outHexLower);
+
+    private:
+        void Destroy();
+
+        void* hash_;                        // BCRYPT_HASH_HANDLE
+        std::vector<unsigned char> obj_;    // hash object storage; outlives hash_
+        bool fed_;                          // Update since Begin: a reusable object must be recreated
+    };
+
+    std::string ToHexLower(const unsigned char* data, size_t size);
+
+    bool HashBytesHex(const void* data, size_t size, std::string& outHexLower);
+    bool HashFileHex(const std::wstring& path, std::string& outHexLower);
+
+    // Batch API: hashes many files on a small thread pool.
+    struct FileJob
+    {
+        std::wstring path;
+        std::string hexLower;
+        bool ok = false;
+    };
+
+    // threadCount 0 = one per CPU. Returns the number of failed jobs. With stopOnFailure, jobs not
+    // yet started when the first failure is seen are skipped (left ok == false, not counted).
+    size_t HashFilesHex(std::vector<FileJob>& jobs, unsigned threadCount, bool stopOnFailure);
+}